@@ -1,10 +1,28 @@
 #version 400
 
-uniform sampler2D u_texture;
+// one program per mode, each with only that mode's lines left in: see the shader_features in main.cpp
+
+#define GA_VARYING in
+#include "ga_unlit_texture_io.glsl"
 
-// TODO: Homework 3 - Add any other necessary uniforms or input/output variables here
+layout(location = 0) out vec4 myColor;
+
+#ifdef UNIFORM_COLOR
+uniform vec4 eColor;
+#endif
+#ifdef TEXTURE
+uniform sampler2D u_texture;
+#endif
 
 void main()
 {
-	// TODO: Homework 3
-}
\ No newline at end of file
+#if defined(TEXTURE)
+	myColor = texture(u_texture, fragmentUV);	// this version pulls color from texture
+#elif defined(UNIFORM_COLOR)
+	myColor = eColor;							// this version pulls changing color from uniform
+#elif defined(INTERP_COLOR)
+	myColor = interpColor;						// this version uses an interpolated color
+#else
+	myColor = vec4(1.0, 0.0, 0.0, 1.0);			// this version uses a fixed color
+#endif
+}
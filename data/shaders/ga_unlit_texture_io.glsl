@@ -0,0 +1,4 @@
+// what the vertex stage hands the fragment stage: define GA_VARYING first, as out (vertex) or in (fragment)
+
+GA_VARYING vec2 fragmentUV;
+GA_VARYING vec4 interpColor;
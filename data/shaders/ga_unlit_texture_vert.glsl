@@ -1,10 +1,16 @@
 #version 400
 
-uniform mat4 u_mvp;
+#define GA_VARYING out
+#include "ga_unlit_texture_io.glsl"
+
+layout(location = 0) in vec2 coord2d;
+layout(location = 1) in vec2 vertexUV;
 
-// TODO: Homework 3 - Add any other necessary uniforms or input/output variables here
+uniform mat4 u_mvp;
 
 void main()
 {
-	// TODO: Homework 3
-}
\ No newline at end of file
+	fragmentUV = vertexUV;
+	interpColor = vec4(coord2d, 0.0, 1.0);
+	gl_Position = u_mvp * vec4(coord2d, 0.0, 1.0);
+}
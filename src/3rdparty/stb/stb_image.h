@@ -333,6 +333,8 @@ publish, and distribute this file as you see fit.
 //
 
 
+#include <stddef.h> // size_t, for stbi_convert_func
+
 #ifndef STBI_NO_STDIO
 #include <stdio.h>
 #endif // STBI_NO_STDIO
@@ -467,6 +469,23 @@ extern "C" {
 	// flip the image vertically, so the first pixel in the output array is the bottom left
 	STBIDEF void stbi_set_flip_vertically_on_load(int flag_true_if_should_flip);
 
+	// replace the PNG row unfiltering for 8-bit, 3 or 4 channel images (e.g. with SIMD
+	// kernels). filter is the row's PNG filter type (0..4), prior is NULL on the first
+	// row of an image or interlace pass. cur and prior hold out_n bytes per pixel,
+	// raw holds img_n; when out_n > img_n the extra byte is alpha and must be set to 255.
+	// return 0 to have stb_image unfilter the row itself. pass NULL to remove the hook.
+	typedef int(*stbi_png_unfilter_func)(int filter, stbi_uc *cur, const stbi_uc *raw, const stbi_uc *prior, int width, int img_n, int out_n);
+	STBIDEF void stbi_set_png_unfilter(stbi_png_unfilter_func func);
+
+	// replace the per-pixel conversions done after decoding: channel count changes
+	// (src_bits == 8, img_n -> req_comp components) and 16 to 8 bit reduction (src_bits
+	// == 16, img_n == req_comp, keep the high byte). dst and src are the same buffer,
+	// already large enough for the result: widening must work back to front. gray is
+	// (77 r + 150 g + 29 b) >> 8 as in stb_image. return 0 to have stb_image convert
+	// into a new buffer itself. pass NULL to remove the hook.
+	typedef int(*stbi_convert_func)(stbi_uc *dst, const void *src, int src_bits, int img_n, int req_comp, size_t pixels);
+	STBIDEF void stbi_set_convert(stbi_convert_func func);
+
 	// ZLIB client - used by PNG, available for other purposes
 
 	STBIDEF char *stbi_zlib_decode_malloc_guesssize(const char *buffer, int len, int initial_size, int *outlen);
@@ -477,6 +496,15 @@ extern "C" {
 	STBIDEF char *stbi_zlib_decode_noheader_malloc(const char *buffer, int len, int *outlen);
 	STBIDEF int   stbi_zlib_decode_noheader_buffer(char *obuffer, int olen, const char *ibuffer, int ilen);
 
+	// replace the inflate engine behind all of the above (and so behind PNG loading).
+	// func decodes into *out (*out_size bytes) and returns the bytes produced, or -1 on
+	// corrupt data or when out of room. when grow is not NULL the output may be enlarged
+	// with it (it reallocates with stb_image's allocator); *out and *out_size must then
+	// describe the new buffer on return, success or not. pass NULL to remove the hook.
+	typedef stbi_uc *(*stbi_zlib_grow_func)(stbi_uc *out, int old_size, int new_size);
+	typedef int(*stbi_zlib_inflate_func)(const stbi_uc *in, int in_len, int parse_header, stbi_uc **out, int *out_size, stbi_zlib_grow_func grow);
+	STBIDEF void stbi_set_zlib_inflate(stbi_zlib_inflate_func func);
+
 
 #ifdef __cplusplus
 }
@@ -1030,12 +1058,25 @@ static void *stbi__load_main(stbi__context *s, int *x, int *y, int *comp, int re
 	return stbi__errpuc("unknown image type", "Image not of any known type, or corrupt");
 }
 
+static stbi_convert_func stbi__convert = NULL;
+
+STBIDEF void stbi_set_convert(stbi_convert_func func)
+{
+	stbi__convert = func;
+}
+
 static stbi_uc *stbi__convert_16_to_8(stbi__uint16 *orig, int w, int h, int channels)
 {
 	int i;
 	int img_len = w * h * channels;
 	stbi_uc *reduced;
 
+	// in place through the hook, then give back the upper half
+	if (stbi__convert && stbi__convert((stbi_uc *)orig, orig, 16, channels, channels, (size_t)w * h)) {
+		reduced = (stbi_uc *)STBI_REALLOC_SIZED(orig, img_len * 2, img_len);
+		return reduced ? reduced : (stbi_uc *)orig;
+	}
+
 	reduced = (stbi_uc *)stbi__malloc(img_len);
 	if (reduced == NULL) return stbi__errpuc("outofmem", "Out of memory");
 
@@ -1511,6 +1552,30 @@ static unsigned char *stbi__convert_format(unsigned char *data, int img_n, int r
 	if (req_comp == img_n) return data;
 	STBI_ASSERT(req_comp >= 1 && req_comp <= 4);
 
+	// in place through the hook: grow first when widening (realloc can often extend the
+	// block without copying), shrink after when narrowing
+	if (stbi__convert) {
+		size_t in_size = (size_t)img_n * x * y, out_size = (size_t)req_comp * x * y;
+		STBI_NOTUSED(in_size); // only a user STBI_REALLOC_SIZED reads it
+		if (req_comp > img_n) {
+			if (!stbi__mad3sizes_valid(req_comp, x, y, 0)) {
+				STBI_FREE(data);
+				return stbi__errpuc("too large", "Image too large to decode");
+			}
+			good = (unsigned char *)STBI_REALLOC_SIZED(data, in_size, out_size);
+			if (good == NULL) {
+				STBI_FREE(data);
+				return stbi__errpuc("outofmem", "Out of memory");
+			}
+			data = good;
+		}
+		if (stbi__convert(data, data, 8, img_n, req_comp, (size_t)x * y)) {
+			if (req_comp < img_n && (good = (unsigned char *)STBI_REALLOC_SIZED(data, in_size, out_size)) != NULL)
+				data = good;
+			return data;
+		}
+	}
+
 	good = (unsigned char *)stbi__malloc_mad3(req_comp, x, y, 0);
 	if (good == NULL) {
 		STBI_FREE(data);
@@ -4095,8 +4160,32 @@ static int stbi__parse_zlib(stbi__zbuf *a, int parse_header)
 	return 1;
 }
 
+static stbi_zlib_inflate_func stbi__zlib_inflate = NULL;
+
+STBIDEF void stbi_set_zlib_inflate(stbi_zlib_inflate_func func)
+{
+	stbi__zlib_inflate = func;
+}
+
+static stbi_uc *stbi__zlib_grow(stbi_uc *out, int old_size, int new_size)
+{
+	STBI_NOTUSED(old_size);
+	return (stbi_uc *)STBI_REALLOC_SIZED(out, old_size, new_size);
+}
+
 static int stbi__do_zlib(stbi__zbuf *a, char *obuf, int olen, int exp, int parse_header)
 {
+	if (stbi__zlib_inflate) {
+		stbi_uc *out = (stbi_uc *)obuf;
+		int size = olen;
+		int n = stbi__zlib_inflate(a->zbuffer, (int)(a->zbuffer_end - a->zbuffer), parse_header, &out, &size, exp ? stbi__zlib_grow : NULL);
+		a->zout_start = (char *)out;
+		a->zout = (char *)out + (n > 0 ? n : 0);
+		a->zout_end = (char *)out + size;
+		if (n < 0) return stbi__err("bad zlib", "Corrupt PNG");
+		return 1;
+	}
+
 	a->zout_start = obuf;
 	a->zout = obuf;
 	a->zout_end = obuf + olen;
@@ -4259,6 +4348,13 @@ static int stbi__paeth(int a, int b, int c)
 
 static stbi_uc stbi__depth_scale_table[9] = { 0, 0xff, 0x55, 0, 0x11, 0,0,0, 0x01 };
 
+static stbi_png_unfilter_func stbi__png_unfilter = NULL;
+
+STBIDEF void stbi_set_png_unfilter(stbi_png_unfilter_func func)
+{
+	stbi__png_unfilter = func;
+}
+
 // create the png data from post-deflated data
 static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 raw_len, int out_n, stbi__uint32 x, stbi__uint32 y, int depth, int color)
 {
@@ -4294,6 +4390,13 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
 		if (filter > 4)
 			return stbi__err("invalid filter", "Corrupt PNG");
 
+		// the hook takes whole rows of whole bytes
+		if (stbi__png_unfilter && depth == 8 && img_n >= 3 &&
+			stbi__png_unfilter(filter, cur, raw, j ? prior : NULL, (int)x, img_n, out_n)) {
+			raw += img_n * x;
+			continue;
+		}
+
 		if (depth < 8) {
 			STBI_ASSERT(img_width_bytes <= x);
 			cur += x*out_n - img_width_bytes; // store output to the rightmost img_len bytes, so we can decode in place
@@ -14,13 +14,37 @@
 #define SDL_MAIN_HANDLED
 #define STB_IMAGE_IMPLEMENTATION
 
+// stb's scratch buffers come from per-thread arenas (see myCore/decode_arena.h)
+#include "myCore/decode_arena.h"
+#define STBI_MALLOC(size) decode_arena_malloc(size)
+#define STBI_REALLOC(p, size) decode_arena_realloc(p, size)
+#define STBI_FREE(p) decode_arena_free(p)
+
 #include <stb_image.h>
 #include <string>
+#include <vector>
 
 #include "SDL.h"
 #define GLEW_STATIC
 #include <GL/glew.h>
 
+#include "myAssets/asset_archive.h"
+#include "myCore/file_watch.h"
+#include "myCore/inflate.h"
+#include "myCore/job_pool.h"
+#include "myCore/root_path.h"
+#include "myOpenGL/command_list.h"
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/program_builder.h"
+#include "myOpenGL/program_cache.h"
+#include "myOpenGL/render_queue.h"
+#include "myOpenGL/shader_library.h"
+#include "myOpenGL/shader_reflect.h"
+#include "myOpenGL/shader_permutation.h"
+#include "myTextures/pixel_convert.h"
+#include "myTextures/png_unfilter.h"
+#include "myTextures/texture_stream.h"
+
 static const GLuint WIDTH = 512;
 static const GLuint HEIGHT = 512;
 
@@ -41,33 +65,25 @@ static const GLchar* basic_fragment_shader_source =
 "    myColor = vec4(1.0, 0.0, 0.0, 1.0);\n"     // this version uses a fixed color
 "}\n";
 
-static const GLchar* vertex_shader_source =
-"#version 400\n"
-"layout(location = 0) in vec2 coord2d;\n"
-"layout(location = 1) in vec2 vertexUV;\n"
-"uniform mat4 u_mvp;\n"
-"out vec2 fragmentUV;\n"
-"out vec4 interpColor;\n"
-"void main() {\n"
-"    fragmentUV = vertexUV;\n"
-"    interpColor = vec4(coord2d, 0.0, 1.0);\n"
-"    gl_Position = u_mvp * vec4(coord2d, 0.0, 1.0);\n"
-"}\n";
+// the real shaders live in data/shaders (ga_unlit_texture_*.glsl), the basic one above is built in
+// so there's always something to draw with, even before (or without) those
 
-static const GLchar* fragment_shader_source =
-"#version 400\n"
-"layout(location = 0) out vec4 myColor;\n"
-"uniform vec4 eColor;\n"
-"uniform int mode;\n"
-"uniform sampler2D u_texture;\n"
-"in vec2 fragmentUV;\n"
-"in vec4 interpColor;\n"
-"void main() {\n"
-"    if (mode == 0) myColor = vec4(1.0, 0.0, 0.0, 1.0);\n"     // this version uses a fixed color
-"    if (mode == 1) myColor = interpColor;\n"     // this version uses an interpolated color
-"    if (mode == 2) myColor = eColor;\n"                         // this version pulls changing color from uniform
-"    if (mode == 3) myColor = texture(u_texture, fragmentUV);\n"   // this version pulls color from texture
-"}\n";
+// the fragment shader's features, bit i of a permutation mask is shader_features[i]
+enum shader_feature
+{
+    FEATURE_INTERP_COLOR = 1 << 0,
+    FEATURE_UNIFORM_COLOR = 1 << 1,
+    FEATURE_TEXTURE = 1 << 2
+};
+static const char* shader_features[] = { "INTERP_COLOR", "UNIFORM_COLOR", "TEXTURE" };
+
+// the old "mode" uniform's values, each now a permutation of its own
+static const uint32_t mode_features[4] = {
+    0,                      // mode 0 : fixed color
+    FEATURE_INTERP_COLOR,   // mode 1 : interpolated color
+    FEATURE_UNIFORM_COLOR,  // mode 2 : specified color
+    FEATURE_TEXTURE         // mode 3 : texture
+};
 
 static GLfloat positionCoordinates[] = {
     -0.4,  0.4,
@@ -94,97 +110,6 @@ static GLshort indices[] = {
 GLfloat myMvp[4][4] = { {1,0,0,0},{0,1,0,0},{0,0,1,0} ,{0,0,0,1} };
 GLfloat myMvp90[4][4] = { { 0, 1, 0, 0 }, { -1, 0, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } };
 
-/* load a texture from a file using STB */
-/* it is assumed that the path needs to have the executable's location prepended */
-GLuint texture_from_file(const char* path,GLuint textureUnit)
-{
-    /* first up, resolve the path according to the executable */
-    extern char g_root_path[256];
-    std::string fullpath = g_root_path;
-    fullpath += path;
-    
-    /* next, load the image from the file using stb_image */
-    int width, height, channels_in_file;
-    uint8_t* data = stbi_load(fullpath.c_str(), &width, &height, &channels_in_file, 4);
-    
-    if (!data)
-    {
-        printf("texture load error\n");
-        exit(EXIT_FAILURE);
-    }
-
-    /* finally generate a texture, bind it, describe it, and load the image into it */
-    GLuint handle;
-
-    glActiveTexture(GL_TEXTURE0 + textureUnit);
-
-    glGenTextures(1, &handle);
-    glBindTexture(GL_TEXTURE_2D, handle);
-    
-    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
-    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
-
-    /* no longer need the stb_image */
-    stbi_image_free(data);
-
-    return handle;
-}
-
-/* check the shader logs for errors! */
-void check_shader_errors(GLuint shader, char *name) 
-{  
-    GLchar* log = NULL;
-    GLint log_length, success;
-
-    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
-    log = (GLchar*)malloc(log_length);
-    if (log_length > 0) {
-        glGetShaderInfoLog(shader, log_length, NULL, log);
-        printf("%s log:\n\n%s\n",name, log);
-    }
-    free(log);
-    if (!success) {
-        printf("%s error\n",name);
-        exit(EXIT_FAILURE);
-    }
-}
-
-/* set up vertex and fragment shaders, combine into a program */
-GLuint common_get_shader_program(
-    const char* vertex_shader_source,
-    const char* fragment_shader_source
-) {
-    GLuint program, fragment_shader, vertex_shader;
-
-    /* Vertex shader */
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_source, NULL);
-    glCompileShader(vertex_shader);
-    
-    check_shader_errors(vertex_shader, "vertex shader compile");
-
-    /* Fragment shader */
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment_shader, 1, &fragment_shader_source, NULL);
-    glCompileShader(fragment_shader);
-
-    check_shader_errors(fragment_shader, "fragment shader compile");
-
-    /* Link shaders */
-    program = glCreateProgram();
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glLinkProgram(program);
-
-    check_shader_errors(program, "shader program link");
-
-    /* Cleanup. */
-    glDeleteShader(vertex_shader);
-    glDeleteShader(fragment_shader);
-    return program;
-}
-
 /* a simple recursive callback to help "animate" our demo */
 int foo = 0;
 SDL_TimerID my_timer_id;
@@ -196,6 +121,50 @@ Uint32 my_callbackfunc(Uint32 interval, void* param)
     return interval;
 }
 
+/* what a frame's draw sets in its mode's program, applied by the render queue once that program is bound */
+struct mode_draw
+{
+    shader_reflection* uniforms;
+    uniform_int texture;
+    GLint textureUnit;              // -1 leaves it as it is
+    uniform_vec4 color;
+    GLfloat colorValue[4];
+    bool setColor;
+    uniform_mat4 mvp;
+    const GLfloat* mvpValue;
+};
+
+static void set_mode_uniforms(void* user)
+{
+    mode_draw* draw = (mode_draw*)user;
+    if (draw->textureUnit >= 0)
+        shader_set_int(draw->uniforms, draw->texture, draw->textureUnit);
+    if (draw->setColor)
+        shader_set_vec4(draw->uniforms, draw->color, draw->colorValue);
+    shader_set_mat4(draw->uniforms, draw->mvp, draw->mvpValue);
+}
+
+/* the frame's objects: what they share is resolved on the main thread, workers turn each into a packet */
+struct frame_scene
+{
+    render_packet packet;           // uniforms and user are filled in per object
+    mode_draw draw;
+    std::vector<mode_draw> draws;   // one per object, its packet's user: valid until the render queue has drawn it
+};
+
+static void record_scene(void* user, command_list* list, int begin, int end)
+{
+    frame_scene* scene = (frame_scene*)user;
+    for (int i = begin; i < end; i++) {
+        scene->draws[i] = scene->draw;
+
+        render_packet packet = scene->packet;
+        packet.uniforms = set_mode_uniforms;
+        packet.user = &scene->draws[i];
+        command_list_submit(list, 0, packet, 0.0f);
+    }
+}
+
 static void set_root_path(const char* exepath);
 
 int main(int argc, const char** argv)
@@ -203,13 +172,35 @@ int main(int argc, const char** argv)
 
     set_root_path(argv[0]);
 
-    GLuint program, basicProgram;   // shader program handles
-    GLuint tHandle[2];              // texture handles
+    // if the build packed data/ into one archive, map it once instead of opening files one by one
+    std::string archive_path = g_root_path;
+    archive_path += "data.gapk";
+    asset_archive_mount(archive_path.c_str());
+
+    // fast inflate, SIMD row unfiltering and in-place format conversion for everything stb decodes from here on
+    inflate_install_stb();
+    png_unfilter_install();
+    pixel_convert_install();
+    decode_arena_init();
+
+    shader_permutations* permutations; // one shader source, a program per mode
+    GLuint modeProgram[4], basicProgram; // shader program handles
+    texture_stream_handle tHandle[2]; // texture handles (streamed in the background)
     GLuint textureUnit = GL_TEXTURE0; // just using single texture unit
 
     GLuint vbo[4], vao;             // Vertex Array and Vertex Buffer Object handles
     
-    GLuint eLoc, tLoc, mLoc, mvpLoc; // uniform variable locations (from shader program)
+    shader_reflection* modeUniforms[4]; // each mode program's uniforms, with a copy of what was last sent
+    uniform_vec4 eUniform[4];       // uniform variable handles (from each mode's program)
+    uniform_int tUniform[4];
+    uniform_mat4 mvpUniform[4];
+    int mode = 0;                   // which of them draws this frame
+    render_queue* renderQueue;      // draws are submitted here and sorted by state before they reach GL
+    job_pool* framePool;            // records the frame's draws into command lists, one list per thread
+    std::vector<command_list*> frameLists;
+    frame_scene scene;
+    int sceneObjects = 1;           // just the one quad, for now
+    static const int frame_modes[4] = { 3, 3, 0, 2 }; // the mode each step of the animation shows
     
     SDL_Event event;
     SDL_GLContext gl_context;
@@ -228,32 +219,51 @@ int main(int argc, const char** argv)
         WIDTH, HEIGHT, SDL_WINDOW_OPENGL);
     gl_context = SDL_GL_CreateContext(window);
     glewInit();
+
+    // bindings and draw state go through a shadow copy, so calls that change nothing never reach the driver
+    gl_state_init();
+
+    // linked programs from the last run, keyed by their sources and this driver
+    program_cache_init("cache/shaders");
+
+    // shader compiles are issued up front and checked from the main loop, on the driver's threads if it has them
+    program_builder_init();
     
     my_timer_id = SDL_AddTimer(500, my_callbackfunc, 0); // use an SDL 1 second time to "animate" modes
 
     // done with "global system stuff"
 
-    /* Shader setup. create a program from a vertex and fragment shader combo */
-    program = common_get_shader_program(vertex_shader_source, fragment_shader_source);
-    basicProgram = common_get_shader_program(basic_vertex_shader_source, basic_fragment_shader_source);
+    /* Shader setup. the basic program is tiny and stands in for the others until they are built, so wait for it */
+    basicProgram = program_build_now(basic_vertex_shader_source, basic_fragment_shader_source);
+    if (!basicProgram)
+        exit(EXIT_FAILURE);
+
+    /* create a program from a vertex and fragment shader combo (files, so editing one rebuilds it while we run), */
+    /* once per mode so no fragment branches on it (all started now, finished in the background) */
+    shader_library_init("data/shaders");
+    permutations = shader_library_permutations("ga_unlit_texture_vert.glsl", "ga_unlit_texture_frag.glsl",
+        shader_features, 3, program_build, program_build_status, program_builder_forget);
+    if (!permutations)
+        exit(EXIT_FAILURE);
+    shader_permutations_precompile(permutations, mode_features, 4);
 
     // Hint #1...
 
     /* Vertex Array Object setup. */
     glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    gl_state_bind_vertex_array(vao);
 
     /* Vertex Buffer setup. */
     glGenBuffers(3, vbo);
 
     // first buffer... positions of the vertices
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[0]);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, vbo[0]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(positionCoordinates), positionCoordinates, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(0);
 
     // second buffer... UV coordinates for texturing (or other games)
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[1]);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, vbo[1]);
     glBufferData(GL_ARRAY_BUFFER, sizeof(uv), uv, GL_STATIC_DRAW);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, 0);
     glEnableVertexAttribArray(1);
@@ -261,64 +271,119 @@ int main(int argc, const char** argv)
     // third buffer, indices for the vertices used in the geometry
     // notice that we are creating 3 triangles with only 5 vertices ! (some triangles share vertices)
     // (this means we are likely using glDrawElements, but using glDrawArrays will actually still work, kindof)
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, vbo[2]);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, vbo[2]);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
 
-    // tell OpenGL which shader program to use
-    glUseProgram(program);
-
     /* Global draw state */
-    glViewport(0, 0, WIDTH, HEIGHT);
+    gl_state_viewport(0, 0, WIDTH, HEIGHT);
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     
     // the "uniform variables" are used to send data shared by ALL vertices to the shaders
     // Hint #3...
+    // (uniforms belong to a program, so each mode's program gets its own; a mode that doesn't
+    //  use one has it compiled out, its handle is inactive and setting it does nothing)
+    // (a program can't be asked about its uniforms before it's built: that happens in the main loop)
+
+    for (int m = 0; m < 4; m++) {
+        modeProgram[m] = shader_permutations_get(permutations, mode_features[m]);
+        modeUniforms[m] = NULL;
+        eUniform[m].index = tUniform[m].index = mvpUniform[m].index = -1; // inactive until then
+    }
 
-    /* send the color as a uniform vec4 */
-    eLoc = glGetUniformLocation(program, "eColor");
-    glUniform4fv(eLoc, 1, colorVecBlue); 
-    
-    /* send the mvp matrix as a uniform Matrix4, note we are NOT transposing the matrix */
-    mvpLoc = glGetUniformLocation(program, "u_mvp");
-    glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat *)myMvp);
-
-    // which texture UNIT to use (different from which texture to use)
-    tLoc = glGetUniformLocation(program, "u_texture");
-    glUniform1i(tLoc, 0); // 0: GL_TEXTURE0 <- texture unit #0, GPU has at least one!
+    // set up 2 textures, decoded on worker threads so the first frame doesn't wait for them
+    // (a placeholder is bound to each unit until its texture lands)
 
-    // select between our custom fragment shader modes
-    mLoc = glGetUniformLocation(program, "mode");
-    glUniform1i(mLoc, 0); // "mode 0"
+    texture_stream_init(NULL);
 
-    // set up 2 textures
+    tHandle[0] = texture_stream_request("data/textures/magic.png",0);
+    tHandle[1] = texture_stream_request("data/textures/brillo.png",1);
 
-    tHandle[0] = texture_from_file("data/textures/magic.png",0);
-    tHandle[1] = texture_from_file("data/textures/brillo.png",1);
+    // saving over a texture or a shader in data/ brings it back in without a restart
+    file_watch_start(g_root_path, "data");
+    std::vector<std::string> changed_files;
 
     // set the  fill modes for polygons
-    glPolygonMode(GL_FRONT, GL_FILL);
-    glPolygonMode(GL_BACK, GL_FILL);
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+
+    renderQueue = render_queue_create(64);
+
+    framePool = job_pool_create(0, "frame");
+    for (int i = 0; i <= job_pool_thread_count(framePool); i++) // the workers, and this thread helping out
+        frameLists.push_back(command_list_create(4096));
+    scene.draws.resize(sceneObjects);
 
     /* Main loop. */
     while (1) {
 
-        glClear(GL_COLOR_BUFFER_BIT); // clear the background on each iteration
-
-        // for another quick demo variation, send shader an alternating transformation matrix!
-        if (foo & 1) {
-            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)myMvp);
-        }else{
-            glUniformMatrix4fv(mvpLoc, 1, GL_FALSE, (GLfloat*)myMvp90);
+        changed_files.clear();
+        file_watch_poll(&changed_files);
+        for (size_t i = 0; i < changed_files.size(); i++)
+            texture_stream_reload(changed_files[i].c_str());
+        shader_library_reload(changed_files); // rebuilds, in the background, the programs that used them
+
+        texture_stream_pump(); // upload any textures that finished decoding
+        program_builder_pump(); // and pick up shader programs that finished building
+
+        // rebuilt programs replace the old ones all at once, and get their uniforms looked up (and set) again
+        if (shader_library_update()) {
+            for (int m = 0; m < 4; m++) {
+                GLuint rebuilt = shader_permutations_get(permutations, mode_features[m]);
+                if (rebuilt == modeProgram[m])
+                    continue;
+                modeProgram[m] = rebuilt;
+                if (modeUniforms[m])
+                    shader_reflection_destroy(modeUniforms[m]);
+                modeUniforms[m] = NULL;
+                eUniform[m].index = tUniform[m].index = mvpUniform[m].index = -1;
+            }
         }
 
+        glClear(GL_COLOR_BUFFER_BIT); // clear the background on each iteration
+
         //  I set up a few "modes" to switch between showing off different renders 
         //  based on the same vao and vbos with some tweaks to shader uniforms and glPolygonMode
+        //  (each mode is a shader permutation, so switching modes is switching programs)
+        mode = frame_modes[foo & 3];
+        if (!modeUniforms[mode] && program_ready(modeProgram[mode])) {
+            // tell OpenGL which shader program to use
+            gl_state_use_program(modeProgram[mode]);
+
+            // look the uniforms up by name once; setting one through its handle only reaches GL if the value changed
+            modeUniforms[mode] = shader_reflect(modeProgram[mode]);
+
+            /* send the color as a uniform vec4 */
+            eUniform[mode] = shader_uniform_vec4(modeUniforms[mode], "eColor");
+            shader_set_vec4(modeUniforms[mode], eUniform[mode], colorVecBlue);
+
+            /* send the mvp matrix as a uniform Matrix4, note we are NOT transposing the matrix */
+            mvpUniform[mode] = shader_uniform_mat4(modeUniforms[mode], "u_mvp");
+            shader_set_mat4(modeUniforms[mode], mvpUniform[mode], (GLfloat *)myMvp);
+
+            // which texture UNIT to use (different from which texture to use)
+            tUniform[mode] = shader_uniform_int(modeUniforms[mode], "u_texture");
+            shader_set_int(modeUniforms[mode], tUniform[mode], 0); // 0: GL_TEXTURE0 <- texture unit #0, GPU has at least one!
+        }
+        // still building: the basic program draws instead, and the sets below do nothing
+        mode_draw& draw = scene.draw;
+        draw.uniforms = modeUniforms[mode];
+        draw.texture = tUniform[mode];
+        draw.textureUnit = -1;
+        draw.color = eUniform[mode];
+        draw.setColor = false;
+        draw.mvp = mvpUniform[mode];
+
+        render_packet& packet = scene.packet;
+        packet = render_packet();
+        packet.program = modeUniforms[mode] ? modeProgram[mode] : basicProgram;
+        packet.vao = vao;
+
         switch (foo & 3) {
             case 0:
-                 glUniform1i(mLoc, 3); // mode 3 : use texture
+                 // mode 3 : use texture
 
                  // if using multiple texture units, no need to rebind
-                 glUniform1i(tLoc, 0); // 0: GL_TEXTURE0 <- texture unit #0, GPU has at least one!
+                 draw.textureUnit = 0; // 0: GL_TEXTURE0 <- texture unit #0, GPU has at least one!
+                 texture_stream_touch(tHandle[0]); // sampled this frame, keep it resident
                  
                  // when using a single texture unit...
 
@@ -326,15 +391,15 @@ int main(int argc, const char** argv)
                  //glActiveTexture(textureUnit);
                  //glBindTexture(GL_TEXTURE_2D, tHandle[0]); // partial hint #3 for textures...
 
-                 glPolygonMode(GL_FRONT, GL_FILL);
-                 glPolygonMode(GL_BACK, GL_FILL);
+                 packet.polygon_mode = GL_FILL;
 
                 break;
             case 1:
-                glUniform1i(mLoc, 3); // mode 3 : use texture
+                // mode 3 : use texture
 
                 // if using multiple texture units, no need to rebind
-                glUniform1i(tLoc, 1); // 1: GL_TEXTURE1 <- texture unit #1, GPU has at least one!
+                draw.textureUnit = 1; // 1: GL_TEXTURE1 <- texture unit #1, GPU has at least one!
+                texture_stream_touch(tHandle[1]);
                 
                 // when using a single texture unit...
 
@@ -342,42 +407,57 @@ int main(int argc, const char** argv)
                 //glActiveTexture(textureUnit);
                 //glBindTexture(GL_TEXTURE_2D, tHandle[1]); // partial hint #3 for textures...
                 
-                glPolygonMode(GL_FRONT, GL_FILL);
-                glPolygonMode(GL_BACK, GL_FILL);
+                packet.polygon_mode = GL_FILL;
 
                 break;
             case 2:
-                glUniform1i(mLoc, 0); // mode 0 : use hardcoded color
+                // mode 0 : use hardcoded color
 
-                glPolygonMode(GL_FRONT, GL_LINE);
-                glPolygonMode(GL_BACK, GL_LINE);
+                packet.polygon_mode = GL_LINE;
                 
                 break;
             case 3:
-                glUniform1i(mLoc, 2); // mode 2 : use specified color
-                glUniform4fv(eLoc, 1, colorVecBlue);
+                // mode 2 : use specified color
+                memcpy(draw.colorValue, colorVecBlue, sizeof(draw.colorValue));
+                draw.setColor = true;
 
                 // to get fancy we decrement the blue channel to "pulse"
                 colorVecBlue[2] -= .01;
                 if (colorVecBlue[2] < 0)
                     colorVecBlue[2] = 1.0;
 
-                glPolygonMode(GL_FRONT, GL_FILL);
-                glPolygonMode(GL_BACK, GL_FILL);
+                packet.polygon_mode = GL_FILL;
 
                 break;
             default:
                 break;
         }
 
+        // for another quick demo variation, send shader an alternating transformation matrix!
+        if (foo & 1) {
+            draw.mvpValue = (GLfloat*)myMvp;
+        }else{
+            draw.mvpValue = (GLfloat*)myMvp90;
+        }
+
         // Hint #4...
         /* here's where we actually trigger the rendering, yup, just these few lines! */
-        glBindVertexArray(vao);
-        glDrawElements(GL_TRIANGLES, 9, GL_UNSIGNED_SHORT, (void*)0);
-        //glDrawArrays(GL_TRIANGLES, 0, 6 );
+        packet.primitive = GL_TRIANGLES;
+        packet.count = 9;
+        packet.index_type = GL_UNSIGNED_SHORT;
+        //packet.index_type = 0; packet.count = 6; // glDrawArrays(GL_TRIANGLES, 0, 6 );
+
+        // every object's packet is prepared on the frame pool, then replayed into the render queue in list order
+        command_lists_record(framePool, &frameLists[0], (int)frameLists.size(), sceneObjects, record_scene, &scene);
+        command_lists_execute(&frameLists[0], (int)frameLists.size(), renderQueue);
+
+        // sorts the frame's packets so programs, textures and vaos switch as seldom as possible, then draws them
+        render_queue_execute(renderQueue);
 
         /* SDL needs to do a window buffer swap */
         SDL_GL_SwapWindow(window);
+        shader_uniform_end_frame(); // uniforms sent vs. skipped as unchanged, see shader_uniform_get_stats
+        gl_state_end_frame(); // and the same for binds and draw state, see gl_state_get_stats
 
         /* a bit of user interface housekeeping */
         if (SDL_PollEvent(&event) && event.type == SDL_QUIT)
@@ -388,11 +468,35 @@ int main(int argc, const char** argv)
     glDisableVertexAttribArray(1);
 
     /* Cleanup. */
-    glDeleteTextures(2, tHandle);
-    glDeleteBuffers(2, vbo);
-    glDeleteVertexArrays(1, &vao);
-
-    glDeleteProgram(program);
+    file_watch_stop();
+    texture_stream_shutdown(); // also deletes the streamed textures
+    asset_archive_unmount();
+    decode_arena_shutdown();
+    gl_state_delete_buffers(3, vbo);
+    gl_state_delete_vertex_arrays(1, &vao);
+
+    shader_uniform_stats uniformStats;
+    shader_uniform_get_stats(&uniformStats);
+    printf("uniforms: %d sent, %d skipped as unchanged\n", uniformStats.uploads, uniformStats.skipped);
+    gl_state_stats stateStats;
+    gl_state_get_stats(&stateStats);
+    printf("gl state: %d calls issued, %d filtered as redundant\n", stateStats.issued, stateStats.filtered);
+    render_queue_stats queueStats;
+    render_queue_get_stats(renderQueue, &queueStats);
+    printf("render queue: %d packets, %d program / %d texture / %d vao switches sorted, %d / %d / %d in submission order\n",
+        queueStats.total_packets, queueStats.total_sorted.programs, queueStats.total_sorted.textures, queueStats.total_sorted.vaos,
+        queueStats.total_submitted.programs, queueStats.total_submitted.textures, queueStats.total_submitted.vaos);
+    render_queue_destroy(renderQueue);
+    job_pool_destroy(framePool);
+    for (size_t i = 0; i < frameLists.size(); i++)
+        command_list_destroy(frameLists[i]);
+    for (int m = 0; m < 4; m++)
+        if (modeUniforms[m])
+            shader_reflection_destroy(modeUniforms[m]);
+    shader_library_shutdown();
+    shader_permutations_destroy(permutations); // deletes every mode's program
+    glDeleteProgram(basicProgram);
+    program_builder_forget(basicProgram);
     SDL_RemoveTimer(my_timer_id);
 
     SDL_GL_DeleteContext(gl_context);
@@ -0,0 +1,202 @@
+/*
+    asset loading, from a packed archive when one is mounted
+    ----------------------------
+    the table of contents is validated once at mount time, so lookups are a
+    plain binary search over entries that are known to be in bounds.
+*/
+
+#include "myAssets/asset_archive.h"
+#include "myAssets/asset_archive_format.h"
+#include "myCore/file_map.h"
+#include "myCore/lz_block.h"
+#include "myCore/root_path.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+struct mounted_archive
+{
+    file_map map;
+    const archive_entry* entries;   // in the mapping (the format keeps them 8 byte aligned)
+    uint32_t entry_count;
+    const char* names;
+    bool mounted;
+};
+
+static mounted_archive g_archive;
+
+bool asset_archive_mount(const char* archive_path)
+{
+    asset_archive_unmount();
+
+    file_map map;
+    if (!file_map_open(archive_path, &map))
+        return false;
+
+    archive_header header;
+    if (map.size < sizeof(header))
+    {
+        file_map_close(&map);
+        return false;
+    }
+    memcpy(&header, map.data, sizeof(header));
+
+    bool ok = memcmp(header.magic, ASSET_ARCHIVE_MAGIC, 4) == 0
+        && header.version == ASSET_ARCHIVE_VERSION
+        && header.toc_offset % 8 == 0
+        && header.toc_offset + (uint64_t)header.entry_count * sizeof(archive_entry) <= map.size
+        && header.names_offset + header.names_size <= map.size;
+
+    const archive_entry* entries = (const archive_entry*)(map.data + header.toc_offset);
+    for (uint32_t i = 0; ok && i < header.entry_count; i++)
+    {
+        ok = entries[i].offset + entries[i].stored_size <= map.size
+            && (uint64_t)entries[i].name_offset + entries[i].name_length <= header.names_size
+            && entries[i].compression <= ASSET_COMPRESSION_LZ;
+    }
+
+    if (!ok)
+    {
+        printf("asset archive: %s is not a valid archive\n", archive_path);
+        file_map_close(&map);
+        return false;
+    }
+
+    g_archive.map = map;
+    g_archive.entries = entries;
+    g_archive.entry_count = header.entry_count;
+    g_archive.names = (const char*)map.data + header.names_offset;
+    g_archive.mounted = true;
+    return true;
+}
+
+void asset_archive_unmount()
+{
+    if (!g_archive.mounted)
+        return;
+
+    file_map_close(&g_archive.map);
+    memset(&g_archive, 0, sizeof(g_archive));
+}
+
+bool asset_archive_mounted()
+{
+    return g_archive.mounted;
+}
+
+/* strcmp order between a C string and a (not terminated) archive name */
+static int compare_name(const char* path, size_t length, const archive_entry& entry)
+{
+    size_t n = length < entry.name_length ? length : entry.name_length;
+    int c = memcmp(path, g_archive.names + entry.name_offset, n);
+    if (c != 0)
+        return c;
+    return length < entry.name_length ? -1 : (length > entry.name_length ? 1 : 0);
+}
+
+static const archive_entry* find_entry(const char* path)
+{
+    size_t length = strlen(path);
+    uint32_t lo = 0, hi = g_archive.entry_count;
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int c = compare_name(path, length, g_archive.entries[mid]);
+        if (c == 0)
+            return &g_archive.entries[mid];
+        if (c < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return NULL;
+}
+
+static bool load_loose_file(const char* path, asset_data* out)
+{
+    std::string fullpath = g_root_path;
+    fullpath += path;
+
+    /* no copy through stdio buffers: loaders read the pages as readahead brings them in */
+    if (!file_map_open(fullpath.c_str(), &out->map))
+        return false;
+
+    file_map_advise(&out->map, FILE_MAP_SEQUENTIAL);
+    out->bytes = out->map.data;
+    out->size = out->map.size;
+    return true;
+}
+
+bool asset_load(const char* path, asset_data* out)
+{
+    out->bytes = NULL;
+    out->size = 0;
+    out->storage.clear();
+    memset(&out->map, 0, sizeof(out->map));
+
+    const archive_entry* entry = g_archive.mounted ? find_entry(path) : NULL;
+    if (!entry)
+        return load_loose_file(path, out);
+
+    const uint8_t* stored = g_archive.map.data + entry->offset;
+
+    if (entry->compression == ASSET_COMPRESSION_NONE)
+    {
+        /* zero copy: the caller reads the mapping directly */
+        out->bytes = stored;
+        out->size = (size_t)entry->stored_size;
+        return true;
+    }
+
+    out->storage.resize((size_t)entry->raw_size);
+    if (!lz_decompress(stored, (size_t)entry->stored_size, out->storage.empty() ? NULL : &out->storage[0], out->storage.size()))
+    {
+        printf("asset archive: %s is corrupt\n", path);
+        out->storage.clear();
+        return false;
+    }
+
+    out->bytes = out->storage.empty() ? NULL : &out->storage[0];
+    out->size = out->storage.size();
+    return true;
+}
+
+bool asset_stat(const char* path, asset_info* out)
+{
+    const archive_entry* entry = g_archive.mounted ? find_entry(path) : NULL;
+    if (entry)
+    {
+        out->size = entry->raw_size;
+        out->mtime = 0;
+        out->packed = true;
+        return true;
+    }
+
+    std::string fullpath = g_root_path;
+    fullpath += path;
+
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(fullpath.c_str(), &st) != 0)
+        return false;
+#else
+    struct stat st;
+    if (stat(fullpath.c_str(), &st) != 0)
+        return false;
+#endif
+
+    out->size = (uint64_t)st.st_size;
+    out->mtime = (uint64_t)st.st_mtime;
+    out->packed = false;
+    return true;
+}
+
+void asset_release(asset_data* data)
+{
+    data->bytes = NULL;
+    data->size = 0;
+    std::vector<uint8_t>().swap(data->storage);
+    file_map_close(&data->map);
+}
@@ -0,0 +1,64 @@
+/*
+    asset loading, from a packed archive when one is mounted
+    ----------------------------
+    asset_archive_mount() maps a .gapk file once at startup. from then on
+    asset_load() answers from the mapping: stored entries come back as a
+    pointer straight into it, compressed ones are inflated into storage.
+    anything not in the archive (or with no archive mounted) is read from
+    g_root_path + path as a loose file, memory mapped rather than read: the
+    decoder reads the page cache directly, asset_release() unmaps it.
+
+    mount before any worker thread starts loading, unmount after they stop.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "myCore/file_map.h"
+
+/* holds a mapping for loose files: release it with asset_release, don't copy it */
+struct asset_data
+{
+    const uint8_t* bytes;
+    size_t size;
+    std::vector<uint8_t> storage;   // used when the bytes couldn't be handed out in place
+    file_map map;                   // a loose file's own mapping
+};
+
+bool asset_archive_mount(const char* archive_path);
+void asset_archive_unmount();
+bool asset_archive_mounted();
+
+/* path is relative to the executable, e.g. "data/textures/magic.png" */
+bool asset_load(const char* path, asset_data* out);
+void asset_release(asset_data* data);
+
+struct asset_info
+{
+    uint64_t size;          // uncompressed
+    uint64_t mtime;         // seconds, 0 for archive entries (they only change with the archive)
+    bool packed;
+};
+
+/* size and modification time without loading anything */
+bool asset_stat(const char* path, asset_info* out);
+
+/* packing side, used by tools/asset_packer.cpp */
+struct asset_pack_input
+{
+    std::string path;               // key, '/' separated
+    std::vector<uint8_t> bytes;
+};
+
+struct asset_pack_stats
+{
+    size_t raw_bytes;
+    size_t stored_bytes;
+    int compressed_entries;
+};
+
+bool asset_archive_write(const char* archive_path, std::vector<asset_pack_input>& inputs,
+                         uint32_t alignment, bool compress, asset_pack_stats* stats);
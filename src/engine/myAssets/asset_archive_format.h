@@ -0,0 +1,45 @@
+/*
+    on-disk layout of a packed asset archive (.gapk)
+    ----------------------------
+      header
+      entry data, each entry starting on an `alignment` boundary
+      table of contents: one archive_entry per file, sorted by path (strcmp order)
+      names: every path back to back, no terminators
+
+    all integers little endian. paths use '/' and are relative to the
+    executable, exactly what asset_load and texture_stream_request are given.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define ASSET_ARCHIVE_MAGIC "GAPK"
+#define ASSET_ARCHIVE_VERSION 1
+
+enum asset_compression
+{
+    ASSET_COMPRESSION_NONE = 0,
+    ASSET_COMPRESSION_LZ = 1    // myCore/lz_block
+};
+
+struct archive_header
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t alignment;
+    uint64_t toc_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+};
+
+struct archive_entry
+{
+    uint32_t name_offset;   // into the names block
+    uint32_t name_length;
+    uint32_t compression;   // asset_compression
+    uint32_t reserved;
+    uint64_t offset;        // from the start of the archive
+    uint64_t stored_size;
+    uint64_t raw_size;
+};
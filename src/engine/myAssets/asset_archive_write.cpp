@@ -0,0 +1,119 @@
+/*
+    writing packed asset archives (.gapk)
+    ----------------------------
+    kept apart from the reader so tools can pack without pulling in the
+    runtime's loose file fallback.
+*/
+
+#include "myAssets/asset_archive.h"
+#include "myAssets/asset_archive_format.h"
+#include "myCore/lz_block.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+static bool path_less(const asset_pack_input& a, const asset_pack_input& b)
+{
+    return strcmp(a.path.c_str(), b.path.c_str()) < 0;
+}
+
+static bool write_zeros(FILE* f, uint64_t count)
+{
+    static const uint8_t zeros[256] = { 0 };
+    while (count > 0)
+    {
+        size_t n = count < sizeof(zeros) ? (size_t)count : sizeof(zeros);
+        if (fwrite(zeros, 1, n, f) != n)
+            return false;
+        count -= n;
+    }
+    return true;
+}
+
+static uint64_t align_up(uint64_t v, uint64_t alignment)
+{
+    return (v + alignment - 1) / alignment * alignment;
+}
+
+bool asset_archive_write(const char* archive_path, std::vector<asset_pack_input>& inputs,
+                         uint32_t alignment, bool compress, asset_pack_stats* stats)
+{
+    if (alignment < 8)
+        alignment = 8;
+
+    std::sort(inputs.begin(), inputs.end(), path_less);
+
+    FILE* f = fopen(archive_path, "wb");
+    if (!f)
+        return false;
+
+    memset(stats, 0, sizeof(*stats));
+
+    archive_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASSET_ARCHIVE_MAGIC, 4);
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.entry_count = (uint32_t)inputs.size();
+    header.alignment = alignment;
+
+    /* placeholder header now, the real one once the offsets are known */
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1;
+    uint64_t pos = sizeof(header);
+
+    std::vector<archive_entry> entries(inputs.size());
+    std::string names;
+    std::vector<uint8_t> packed;
+
+    for (size_t i = 0; i < inputs.size() && ok; i++)
+    {
+        const std::vector<uint8_t>& raw = inputs[i].bytes;
+        archive_entry& e = entries[i];
+        memset(&e, 0, sizeof(e));
+
+        e.name_offset = (uint32_t)names.size();
+        e.name_length = (uint32_t)inputs[i].path.size();
+        names += inputs[i].path;
+
+        const uint8_t* data = raw.empty() ? NULL : &raw[0];
+        size_t size = raw.size();
+
+        /* only keep compression that pays for the decode (an eighth smaller or better) */
+        if (compress && size > 64)
+        {
+            packed.resize(lz_compress_bound(size));
+            size_t packed_size = lz_compress(data, size, &packed[0], packed.size());
+            if (packed_size > 0 && packed_size <= size - size / 8)
+            {
+                data = &packed[0];
+                size = packed_size;
+                e.compression = ASSET_COMPRESSION_LZ;
+                stats->compressed_entries++;
+            }
+        }
+
+        uint64_t start = align_up(pos, alignment);
+        ok = write_zeros(f, start - pos) && (size == 0 || fwrite(data, 1, size, f) == size);
+
+        e.offset = start;
+        e.stored_size = size;
+        e.raw_size = raw.size();
+        pos = start + size;
+
+        stats->raw_bytes += raw.size();
+        stats->stored_bytes += size;
+    }
+
+    header.toc_offset = align_up(pos, 8);
+    header.names_offset = header.toc_offset + entries.size() * sizeof(archive_entry);
+    header.names_size = names.size();
+
+    ok = ok && write_zeros(f, header.toc_offset - pos)
+        && (entries.empty() || fwrite(&entries[0], sizeof(archive_entry), entries.size(), f) == entries.size())
+        && (names.empty() || fwrite(names.data(), 1, names.size(), f) == names.size())
+        && fseek(f, 0, SEEK_SET) == 0
+        && fwrite(&header, sizeof(header), 1, f) == 1;
+
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
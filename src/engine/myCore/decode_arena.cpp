@@ -0,0 +1,448 @@
+/*
+    per-thread decode arenas (stb_image's allocator)
+    ----------------------------
+    every block, whatever its kind, starts with a header, so a free or a
+    realloc can tell where the block came from without looking anything up:
+
+      small       bump allocated in an arena chunk, only ever freed by
+                  resetting the arena (or popped, when it was the last one)
+      standalone  a heap block of its own: large blocks made during a
+                  decode, and everything made outside one
+
+    a freed standalone block big enough to be worth keeping goes to the
+    freeing thread's cache if that thread has an arena, so results freed on
+    the worker that decoded them (after staging) come back for the next image.
+
+    counters are kept per thread and added to the totals, under a spinlock,
+    once per image.
+*/
+
+#include "myCore/decode_arena.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "SDL.h"
+
+#define HEADER_SIZE 32              // keeps blocks 16 byte aligned, on 32 bit too
+#define LARGE_BLOCK (64 * 1024)     // from here on blocks are standalone and cached
+#define CHUNK_SIZE (256 * 1024)     // the first arena chunk
+
+enum block_kind
+{
+    BLOCK_SMALL,
+    BLOCK_STANDALONE
+};
+
+struct block_header
+{
+    size_t size;        // as asked for
+    size_t capacity;    // usable bytes after the header
+    int kind;
+};
+
+struct arena_chunk
+{
+    uint8_t* base;
+    size_t capacity, used;
+};
+
+struct thread_arena
+{
+    int depth;                          // nested begins, 0 outside a decode
+    std::vector<arena_chunk> chunks;    // bump allocation goes into the last one
+    std::vector<block_header*> cache;   // freed standalone blocks, for reuse
+    size_t cached_bytes, reported_cached;
+    size_t small_bytes, large_bytes;    // in use by the current decode
+    size_t peak_small, peak;
+    decode_arena_stats counts;          // not yet added to the totals
+};
+
+static struct
+{
+    bool enabled;
+    size_t cache_limit;
+    SDL_TLSID tls;
+    SDL_SpinLock lock;
+    decode_arena_stats totals;
+} g_arenas;
+
+static block_header* header_of(void* p)
+{
+    return (block_header*)((uint8_t*)p - HEADER_SIZE);
+}
+
+static void* data_of(block_header* h)
+{
+    return (uint8_t*)h + HEADER_SIZE;
+}
+
+static size_t round_up(size_t size)
+{
+    return (size + 15) & ~(size_t)15;
+}
+
+static thread_arena* current_arena()
+{
+    return g_arenas.enabled ? (thread_arena*)SDL_TLSGet(g_arenas.tls) : NULL;
+}
+
+static bool in_decode(const thread_arena* a)
+{
+    return a && a->depth > 0;
+}
+
+static void note_peak(thread_arena* a)
+{
+    if (a->small_bytes > a->peak_small)
+        a->peak_small = a->small_bytes;
+    if (a->small_bytes + a->large_bytes > a->peak)
+        a->peak = a->small_bytes + a->large_bytes;
+}
+
+/* adds what this thread counted since last time to the totals */
+static void flush_counts(thread_arena* a)
+{
+    SDL_AtomicLock(&g_arenas.lock);
+    decode_arena_stats& t = g_arenas.totals;
+    t.images += a->counts.images;
+    t.peak_bytes = a->counts.peak_bytes > t.peak_bytes ? a->counts.peak_bytes : t.peak_bytes;
+    t.peak_small_bytes = a->counts.peak_small_bytes > t.peak_small_bytes ? a->counts.peak_small_bytes : t.peak_small_bytes;
+    t.cached_bytes = t.cached_bytes + a->cached_bytes - a->reported_cached;
+    t.heap_allocs += a->counts.heap_allocs;
+    t.heap_frees += a->counts.heap_frees;
+    t.reuses += a->counts.reuses;
+    t.promotions += a->counts.promotions;
+    SDL_AtomicUnlock(&g_arenas.lock);
+
+    a->reported_cached = a->cached_bytes;
+    memset(&a->counts, 0, sizeof(a->counts));
+}
+
+static void SDLCALL destroy_arena(void* data)
+{
+    thread_arena* a = (thread_arena*)data;
+    for (size_t i = 0; i < a->chunks.size(); i++)
+        free(a->chunks[i].base);
+    for (size_t i = 0; i < a->cache.size(); i++)
+        free(a->cache[i]);
+    a->cached_bytes = 0;
+    flush_counts(a);
+    delete a;
+}
+
+/* ------------------------------------------------------------------------ */
+/* standalone blocks */
+
+static void* heap_block(thread_arena* a, size_t size)
+{
+    block_header* h = (block_header*)malloc(HEADER_SIZE + size);
+    if (!h)
+        return NULL;
+    h->size = size;
+    h->capacity = size;
+    h->kind = BLOCK_STANDALONE;
+    if (in_decode(a))
+        a->counts.heap_allocs++;
+    return data_of(h);
+}
+
+/* the smallest cached block that fits, if it isn't more than twice the size */
+static block_header* take_cached(thread_arena* a, size_t size)
+{
+    size_t best = a->cache.size();
+    for (size_t i = 0; i < a->cache.size(); i++)
+    {
+        size_t capacity = a->cache[i]->capacity;
+        if (capacity >= size && capacity / 2 <= size && (best == a->cache.size() || capacity < a->cache[best]->capacity))
+            best = i;
+    }
+    if (best == a->cache.size())
+        return NULL;
+
+    block_header* h = a->cache[best];
+    a->cache[best] = a->cache.back();
+    a->cache.pop_back();
+    a->cached_bytes -= h->capacity;
+    a->counts.reuses++;
+    h->size = size;
+    return h;
+}
+
+static void release_standalone(thread_arena* a, block_header* h)
+{
+    if (in_decode(a))
+        a->large_bytes -= a->large_bytes >= h->capacity ? h->capacity : a->large_bytes;
+
+    if (a && h->capacity >= LARGE_BLOCK && a->cached_bytes + h->capacity <= g_arenas.cache_limit)
+    {
+        a->cache.push_back(h);
+        a->cached_bytes += h->capacity;
+        return;
+    }
+
+    if (in_decode(a))
+        a->counts.heap_frees++;
+    free(h);
+}
+
+/* ------------------------------------------------------------------------ */
+/* small blocks */
+
+static bool is_top(const thread_arena* a, const block_header* h)
+{
+    const arena_chunk& c = a->chunks.back();
+    const uint8_t* start = (const uint8_t*)h;
+    return start >= c.base && start + HEADER_SIZE + h->capacity == c.base + c.used;
+}
+
+static void* small_block(thread_arena* a, size_t size)
+{
+    size_t capacity = round_up(size);
+    size_t need = HEADER_SIZE + capacity;
+
+    if (a->chunks.empty() || a->chunks.back().capacity - a->chunks.back().used < need)
+    {
+        arena_chunk chunk;
+        chunk.capacity = a->chunks.empty() ? CHUNK_SIZE : a->chunks.back().capacity * 2;
+        chunk.capacity = chunk.capacity < need ? need : chunk.capacity;
+        chunk.base = (uint8_t*)malloc(chunk.capacity);
+        chunk.used = 0;
+        if (!chunk.base)
+            return NULL;
+        a->chunks.push_back(chunk);
+        a->counts.heap_allocs++;
+    }
+
+    arena_chunk& c = a->chunks.back();
+    block_header* h = (block_header*)(c.base + c.used);
+    h->size = size;
+    h->capacity = capacity;
+    h->kind = BLOCK_SMALL;
+    c.used += need;
+
+    a->small_bytes += need;
+    note_peak(a);
+    return data_of(h);
+}
+
+/* the last block can grow (or be given back) in place, anything else waits for the reset */
+static bool resize_top(thread_arena* a, block_header* h, size_t size)
+{
+    if (!is_top(a, h))
+        return false;
+
+    arena_chunk& c = a->chunks.back();
+    size_t capacity = round_up(size);
+    size_t end = (size_t)((uint8_t*)data_of(h) - c.base);
+    if (end + capacity > c.capacity)
+        return false;
+
+    a->small_bytes = a->small_bytes - h->capacity + capacity;
+    c.used = end + capacity;
+    h->size = size;
+    h->capacity = capacity;
+    note_peak(a);
+    return true;
+}
+
+/* back to a single chunk as big as this image needed, so the next one bumps through one block */
+static void reset(thread_arena* a)
+{
+    if (a->chunks.size() > 1)
+    {
+        size_t total = 0;
+        for (size_t i = 0; i < a->chunks.size(); i++)
+        {
+            total += a->chunks[i].capacity;
+            free(a->chunks[i].base);
+            a->counts.heap_frees++;
+        }
+        a->chunks.clear();
+
+        arena_chunk chunk;
+        chunk.base = (uint8_t*)malloc(total);
+        chunk.capacity = total;
+        chunk.used = 0;
+        if (chunk.base)
+        {
+            a->chunks.push_back(chunk);
+            a->counts.heap_allocs++;
+        }
+    }
+    else if (!a->chunks.empty())
+        a->chunks[0].used = 0;
+
+    a->small_bytes = a->large_bytes = 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+void decode_arena_init(size_t cache_bytes)
+{
+    memset(&g_arenas.totals, 0, sizeof(g_arenas.totals));
+    g_arenas.cache_limit = cache_bytes;
+    g_arenas.lock = 0;
+    g_arenas.tls = SDL_TLSCreate();
+    g_arenas.enabled = g_arenas.tls != 0;
+}
+
+void decode_arena_shutdown()
+{
+    thread_arena* a = current_arena();
+    if (a)
+    {
+        destroy_arena(a);
+        SDL_TLSSet(g_arenas.tls, NULL, NULL);
+    }
+}
+
+void decode_arena_begin()
+{
+    if (!g_arenas.enabled)
+        return;
+
+    thread_arena* a = current_arena();
+    if (!a)
+    {
+        a = new thread_arena;
+        a->depth = 0;
+        a->cached_bytes = a->reported_cached = 0;
+        a->small_bytes = a->large_bytes = 0;
+        memset(&a->counts, 0, sizeof(a->counts));
+        SDL_TLSSet(g_arenas.tls, a, destroy_arena);
+    }
+
+    if (a->depth++ == 0)
+    {
+        a->small_bytes = a->large_bytes = 0;
+        a->peak_small = a->peak = 0;
+    }
+}
+
+void* decode_arena_end(void* result)
+{
+    thread_arena* a = current_arena();
+    if (!in_decode(a) || --a->depth > 0)
+        return result;
+
+    /* the only block that outlives the arena */
+    if (result && header_of(result)->kind == BLOCK_SMALL)
+    {
+        block_header* h = header_of(result);
+        void* copy = heap_block(NULL, h->size);
+        if (copy)
+            memcpy(copy, result, h->size);
+        result = copy;
+        a->counts.promotions++;
+    }
+
+    a->counts.images++;
+    a->counts.peak_bytes = a->peak > a->counts.peak_bytes ? a->peak : a->counts.peak_bytes;
+    a->counts.peak_small_bytes = a->peak_small > a->counts.peak_small_bytes ? a->peak_small : a->counts.peak_small_bytes;
+
+    reset(a);
+    flush_counts(a);
+    return result;
+}
+
+void* decode_arena_malloc(size_t size)
+{
+    thread_arena* a = current_arena();
+    if (!in_decode(a))
+        return heap_block(NULL, size);
+
+    if (size < LARGE_BLOCK)
+        return small_block(a, size);
+
+    block_header* h = take_cached(a, size);
+    void* p = h ? data_of(h) : heap_block(a, size);
+    if (p)
+    {
+        a->large_bytes += header_of(p)->capacity;
+        note_peak(a);
+    }
+    return p;
+}
+
+void* decode_arena_realloc(void* p, size_t size)
+{
+    if (!p)
+        return decode_arena_malloc(size);
+
+    thread_arena* a = current_arena();
+    block_header* h = header_of(p);
+    size_t keep = h->size < size ? h->size : size;
+
+    if (size <= h->capacity)
+    {
+        h->size = size;
+        return p;
+    }
+
+    if (h->kind == BLOCK_SMALL)
+    {
+        if (size < LARGE_BLOCK && resize_top(a, h, size))
+            return p;
+
+        void* moved = decode_arena_malloc(size);
+        if (moved)
+        {
+            memcpy(moved, p, keep);
+            decode_arena_free(p);
+        }
+        return moved;
+    }
+
+    block_header* cached = in_decode(a) && size >= LARGE_BLOCK ? take_cached(a, size) : NULL;
+    if (cached)
+    {
+        memcpy(data_of(cached), p, keep);
+        a->large_bytes += cached->capacity;
+        release_standalone(a, h);
+        note_peak(a);
+        return data_of(cached);
+    }
+
+    /* nothing cached fits: let the heap try to extend it in place */
+    size_t old_capacity = h->capacity;
+    block_header* grown = (block_header*)realloc(h, HEADER_SIZE + size);
+    if (!grown)
+        return NULL;
+    grown->size = size;
+    grown->capacity = size;
+    if (in_decode(a))
+    {
+        a->counts.heap_allocs++;
+        a->large_bytes = a->large_bytes - (a->large_bytes >= old_capacity ? old_capacity : a->large_bytes) + size;
+        note_peak(a);
+    }
+    return data_of(grown);
+}
+
+void decode_arena_free(void* p)
+{
+    if (!p)
+        return;
+
+    thread_arena* a = current_arena();
+    block_header* h = header_of(p);
+
+    if (h->kind == BLOCK_STANDALONE)
+        release_standalone(a, h);
+    else if (a && !a->chunks.empty() && is_top(a, h))
+    {
+        /* the last block: give its bytes back now */
+        a->chunks.back().used -= HEADER_SIZE + h->capacity;
+        a->small_bytes -= HEADER_SIZE + h->capacity;
+    }
+}
+
+void decode_arena_get_stats(decode_arena_stats* stats)
+{
+    SDL_AtomicLock(&g_arenas.lock);
+    *stats = g_arenas.totals;
+    SDL_AtomicUnlock(&g_arenas.lock);
+}
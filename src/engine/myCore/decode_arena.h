@@ -0,0 +1,55 @@
+/*
+    per-thread decode arenas (stb_image's allocator)
+    ----------------------------
+    stb_image allocates a handful of short lived buffers per image (the
+    concatenated IDAT data, the inflated rows, JPEG component planes, the
+    format conversion) and frees all but the result before returning. on the
+    general heap, several threads doing that at once fragment it badly.
+
+    main.cpp points STBI_MALLOC / STBI_REALLOC / STBI_FREE here. between
+    decode_arena_begin() and decode_arena_end() on a thread:
+      - small blocks are bump allocated from the thread's arena, and the
+        whole arena is reset by decode_arena_end()
+      - large blocks come from (and go back to) a per-thread cache of
+        blocks earlier images freed, so a run of similar images stops
+        reaching the heap after the first one
+
+    the decoded image survives the arena: a small result is copied out to
+    the heap, a large one is a block of its own already. either way it is
+    freed with stbi_image_free, from any thread. outside a begin / end pair
+    (or before decode_arena_init) every call goes to the heap as usual.
+*/
+#pragma once
+
+#include <stddef.h>
+
+struct decode_arena_stats
+{
+    int images;                 // decodes run between begin and end
+    size_t peak_bytes;          // most any one of them had allocated at once
+    size_t peak_small_bytes;    // of that, bump allocated
+    size_t cached_bytes;        // large blocks kept for reuse, every thread
+    int heap_allocs;            // mallocs and reallocs that reached the heap during decodes
+    int heap_frees;             // frees that did
+    int reuses;                 // large blocks served from the cache instead
+    int promotions;             // small results copied out of an arena
+};
+
+/*
+    once, before any thread decodes, and only in a program whose stb_image
+    implementation routes its macros here: begin / end read block headers
+*/
+void decode_arena_init(size_t cache_bytes = 32 * 1024 * 1024);
+
+/* frees the calling thread's arena; worker threads free theirs when they exit */
+void decode_arena_shutdown();
+
+/* brackets one decode on the calling thread; end returns result, moved out of the arena if need be */
+void decode_arena_begin();
+void* decode_arena_end(void* result);
+
+void* decode_arena_malloc(size_t size);
+void* decode_arena_realloc(void* p, size_t size);
+void decode_arena_free(void* p);
+
+void decode_arena_get_stats(decode_arena_stats* stats);
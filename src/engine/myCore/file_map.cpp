@@ -0,0 +1,143 @@
+/*
+    read-only memory mapped files
+    ----------------------------
+    win32: CreateFileMapping / MapViewOfFile, everything else: mmap.
+    readahead is madvise / PrefetchVirtualMemory (windows 8 and up).
+*/
+
+#include "myCore/file_map.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool file_map_open(const char* path, file_map* out)
+{
+    memset(out, 0, sizeof(*out));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    out->file = file;
+    out->size = (size_t)size.QuadPart;
+    if (out->size == 0)
+        return true; // nothing to map, but not an error
+
+    out->mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (out->mapping)
+        out->data = (const uint8_t*)MapViewOfFile(out->mapping, FILE_MAP_READ, 0, 0, 0);
+
+    if (!out->data)
+    {
+        file_map_close(out);
+        return false;
+    }
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    out->size = (size_t)st.st_size;
+    if (out->size > 0)
+    {
+        void* p = mmap(NULL, out->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+        {
+            close(fd);
+            out->size = 0;
+            return false;
+        }
+        out->data = (const uint8_t*)p;
+    }
+
+    close(fd); // the mapping keeps the file alive
+    return true;
+#endif
+}
+
+void file_map_close(file_map* map)
+{
+#ifdef _WIN32
+    if (map->data)
+        UnmapViewOfFile(map->data);
+    if (map->mapping)
+        CloseHandle(map->mapping);
+    if (map->file)
+        CloseHandle(map->file);
+#else
+    if (map->data)
+        munmap((void*)map->data, map->size);
+#endif
+    memset(map, 0, sizeof(*map));
+}
+
+void file_map_advise(const file_map* map, file_map_access access)
+{
+    if (!map->data)
+        return;
+
+#ifdef _WIN32
+#if _WIN32_WINNT >= 0x0602
+    if (access == FILE_MAP_SEQUENTIAL)
+    {
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = (void*)map->data;
+        range.NumberOfBytes = map->size;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    (void)access;
+#endif
+#else
+    int advice = access == FILE_MAP_SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM;
+    madvise((void*)map->data, map->size, advice);
+    if (access == FILE_MAP_SEQUENTIAL)
+        madvise((void*)map->data, map->size, MADV_WILLNEED);
+#endif
+}
+
+void file_map_read_faults(file_map_faults* out)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    counters.cb = sizeof(counters);
+    out->minor = GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PageFaultCount : 0;
+    out->major = 0;
+#else
+    struct rusage usage;
+#ifdef RUSAGE_THREAD
+    getrusage(RUSAGE_THREAD, &usage);
+#else
+    getrusage(RUSAGE_SELF, &usage);
+#endif
+    out->minor = (uint64_t)usage.ru_minflt;
+    out->major = (uint64_t)usage.ru_majflt;
+#endif
+}
@@ -0,0 +1,42 @@
+/*
+    read-only memory mapped files
+    ----------------------------
+    the whole file is mapped once, pages come in as they are touched.
+    file_map_advise() tells the OS how they will be touched, and the fault
+    counters show what touching them cost.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct file_map
+{
+    const uint8_t* data;
+    size_t size;
+
+#ifdef _WIN32
+    void* file;
+    void* mapping;
+#endif
+};
+
+enum file_map_access
+{
+    FILE_MAP_SEQUENTIAL,    // read front to back soon: start reading ahead now
+    FILE_MAP_RANDOM         // a few scattered reads: don't read ahead at all
+};
+
+struct file_map_faults
+{
+    uint64_t minor;         // page already in memory, only the mapping was missing
+    uint64_t major;         // had to wait for the disk (0 where the OS doesn't say)
+};
+
+bool file_map_open(const char* path, file_map* out);
+void file_map_close(file_map* map);
+
+void file_map_advise(const file_map* map, file_map_access access);
+
+/* so far: for the calling thread on linux, the whole process elsewhere */
+void file_map_read_faults(file_map_faults* out);
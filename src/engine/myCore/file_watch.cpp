@@ -0,0 +1,290 @@
+/*
+    file change notifications
+    ----------------------------
+    changes first go into a settling table (path -> time of its latest
+    event); the poll hands out the ones that have had no event for
+    SETTLE_MS. both backends are read without blocking: inotify through a
+    non-blocking descriptor, win32 through an overlapped read that is only
+    ever checked, never waited on.
+*/
+
+#include "myCore/file_watch.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+
+#include "SDL.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <dirent.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SETTLE_MS 100
+
+static struct
+{
+    bool running;
+    std::string root;                                   // with a trailing slash
+    std::string subdir;                                 // what is watched, relative to root, with a trailing slash
+    std::unordered_map<std::string, Uint32> settling;   // relative path -> ticks of its latest event
+#ifdef _WIN32
+    HANDLE dir;
+    OVERLAPPED overlapped;
+    DWORD buffer[16 * 1024];                            // FILE_NOTIFY_INFORMATION wants DWORD alignment
+#elif defined(__linux__)
+    int fd;
+    std::unordered_map<int, std::string> dirs;          // watch descriptor -> directory relative to root, with a trailing slash
+#endif
+} g_watch;
+
+static void note_change(const std::string& path)
+{
+    g_watch.settling[path] = SDL_GetTicks();
+}
+
+#ifdef _WIN32
+
+static bool issue_read()
+{
+    DWORD filter = FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE;
+    ResetEvent(g_watch.overlapped.hEvent);
+    return ReadDirectoryChangesW(g_watch.dir, g_watch.buffer, sizeof(g_watch.buffer), TRUE, filter,
+                                 NULL, &g_watch.overlapped, NULL) != 0;
+}
+
+static bool start_backend()
+{
+    std::string path = g_watch.root + g_watch.subdir;
+    g_watch.dir = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+    if (g_watch.dir == INVALID_HANDLE_VALUE)
+        return false;
+
+    memset(&g_watch.overlapped, 0, sizeof(g_watch.overlapped));
+    g_watch.overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!g_watch.overlapped.hEvent || !issue_read())
+    {
+        if (g_watch.overlapped.hEvent)
+            CloseHandle(g_watch.overlapped.hEvent);
+        CloseHandle(g_watch.dir);
+        return false;
+    }
+    return true;
+}
+
+static void stop_backend()
+{
+    CancelIo(g_watch.dir);
+    CloseHandle(g_watch.dir);
+    CloseHandle(g_watch.overlapped.hEvent);
+}
+
+static void read_events()
+{
+    DWORD bytes;
+    while (GetOverlappedResult(g_watch.dir, &g_watch.overlapped, &bytes, FALSE))
+    {
+        /* 0 bytes: the buffer overflowed and the details are lost, nothing to do but carry on */
+        const uint8_t* at = (const uint8_t*)g_watch.buffer;
+        while (bytes > 0)
+        {
+            const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)at;
+            if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED ||
+                info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+            {
+                char name[MAX_PATH * 3];
+                int n = WideCharToMultiByte(CP_UTF8, 0, info->FileName, (int)(info->FileNameLength / sizeof(WCHAR)),
+                                            name, sizeof(name) - 1, NULL, NULL);
+                name[n > 0 ? n : 0] = '\0';
+                for (char* c = name; *c; c++)
+                    *c = *c == '\\' ? '/' : *c;
+                if (n > 0)
+                    note_change(g_watch.subdir + name);
+            }
+
+            if (!info->NextEntryOffset)
+                break;
+            at += info->NextEntryOffset;
+        }
+
+        if (!issue_read())
+        {
+            printf("file watch: lost the watch on %s%s\n", g_watch.root.c_str(), g_watch.subdir.c_str());
+            break;
+        }
+    }
+}
+
+#elif defined(__linux__)
+
+/* a watch on dir (relative to root), then on every directory below it */
+static void watch_tree(const std::string& dir)
+{
+    std::string path = g_watch.root + dir;
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ONLYDIR;
+    int wd = inotify_add_watch(g_watch.fd, path.c_str(), mask);
+    if (wd < 0)
+    {
+        printf("file watch: can't watch %s\n", path.c_str());
+        return;
+    }
+    g_watch.dirs[wd] = dir;
+
+    DIR* d = opendir(path.c_str());
+    if (!d)
+        return;
+    while (struct dirent* entry = readdir(d))
+    {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+            continue;
+
+        struct stat st;
+        std::string child = dir + entry->d_name;
+        if (stat((g_watch.root + child).c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+            watch_tree(child + "/");
+    }
+    closedir(d);
+}
+
+static bool start_backend()
+{
+    g_watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (g_watch.fd < 0)
+        return false;
+
+    g_watch.dirs.clear();
+    watch_tree(g_watch.subdir);
+    if (g_watch.dirs.empty())
+    {
+        close(g_watch.fd);
+        return false;
+    }
+    return true;
+}
+
+static void stop_backend()
+{
+    close(g_watch.fd);
+    g_watch.fd = -1;
+    g_watch.dirs.clear();
+}
+
+static void read_events()
+{
+    /* inotify_event is followed by its name: keep the buffer aligned for it */
+    union
+    {
+        struct inotify_event align;
+        char bytes[16 * 1024];
+    } buffer;
+
+    while (1)
+    {
+        ssize_t n = read(g_watch.fd, buffer.bytes, sizeof(buffer.bytes));
+        if (n <= 0)
+            break; // EAGAIN: drained
+
+        for (char* at = buffer.bytes; at < buffer.bytes + n; )
+        {
+            const struct inotify_event* event = (const struct inotify_event*)at;
+            at += sizeof(struct inotify_event) + event->len;
+
+            std::unordered_map<int, std::string>::iterator dir = g_watch.dirs.find(event->wd);
+            if (event->mask & IN_IGNORED)
+            {
+                if (dir != g_watch.dirs.end())
+                    g_watch.dirs.erase(dir);
+                continue;
+            }
+            if (dir == g_watch.dirs.end() || event->len == 0)
+                continue;
+
+            std::string path = dir->second + event->name;
+            if (event->mask & IN_ISDIR)
+            {
+                /* a new directory: whatever gets written into it counts too */
+                if (event->mask & (IN_CREATE | IN_MOVED_TO))
+                    watch_tree(path + "/");
+            }
+            else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                note_change(path);
+        }
+    }
+}
+
+#else
+
+static bool start_backend()
+{
+    return false;
+}
+
+static void stop_backend()
+{
+}
+
+static void read_events()
+{
+}
+
+#endif
+
+bool file_watch_start(const char* root, const char* subdir)
+{
+    if (g_watch.running)
+        file_watch_stop();
+
+    g_watch.root = root;
+    if (!g_watch.root.empty() && g_watch.root[g_watch.root.size() - 1] != '/' && g_watch.root[g_watch.root.size() - 1] != '\\')
+        g_watch.root += '/';
+    g_watch.settling.clear();
+
+    g_watch.subdir = subdir ? subdir : "";
+    if (!g_watch.subdir.empty() && g_watch.subdir[g_watch.subdir.size() - 1] != '/')
+        g_watch.subdir += '/';
+
+    g_watch.running = start_backend();
+    if (!g_watch.running)
+        printf("file watch: can't watch %s%s\n", g_watch.root.c_str(), g_watch.subdir.c_str());
+    return g_watch.running;
+}
+
+void file_watch_stop()
+{
+    if (g_watch.running)
+        stop_backend();
+    g_watch.running = false;
+    g_watch.settling.clear();
+}
+
+int file_watch_poll(std::vector<std::string>* changed)
+{
+    if (!g_watch.running)
+        return 0;
+
+    read_events();
+
+    Uint32 now = SDL_GetTicks();
+    int count = 0;
+    std::unordered_map<std::string, Uint32>::iterator it = g_watch.settling.begin();
+    while (it != g_watch.settling.end())
+    {
+        if (now - it->second < SETTLE_MS)
+        {
+            ++it;
+            continue;
+        }
+        changed->push_back(it->first);
+        it = g_watch.settling.erase(it);
+        count++;
+    }
+    return count;
+}
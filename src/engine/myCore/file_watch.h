@@ -0,0 +1,24 @@
+/*
+    file change notifications
+    ----------------------------
+    watches a directory tree for files that were written (or moved into
+    place) and hands out their paths, relative to the root given to start.
+    linux: inotify, one watch per directory, new directories picked up as
+    they appear. win32: ReadDirectoryChangesW over the whole subtree.
+
+    nothing blocks: the poll drains whatever the OS queued since the last
+    one. a path is only reported once it has been quiet for a moment, so an
+    editor saving in several writes (or writing a temp file and renaming it)
+    produces one change, after the file is complete.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* watches root + subdir and everything below it; false (and polls find nothing) when it can't */
+bool file_watch_start(const char* root, const char* subdir);
+void file_watch_stop();
+
+/* appends the paths (relative to root, '/' separated) that changed and settled; returns how many */
+int file_watch_poll(std::vector<std::string>* changed);
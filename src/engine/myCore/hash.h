@@ -0,0 +1,46 @@
+/*
+    a small, fast 64 bit hash for content keys (pixels, files, shader sources)
+    ----------------------------
+    eats 8 bytes per step with a multiply/rotate mix, not cryptographic,
+    just good enough that equal hashes (plus equal sizes) mean equal data.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+static inline uint64_t hash64_mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static inline uint64_t hash64(const void* data, size_t size, uint64_t seed = 0)
+{
+    const uint8_t* p = (const uint8_t*)data;
+    const uint64_t m = 0x9e3779b97f4a7c15ULL;
+    uint64_t h = seed ^ (size * m);
+
+    while (size >= 8)
+    {
+        uint64_t k;
+        memcpy(&k, p, 8);
+        k *= m;
+        k = (k << 31) | (k >> 33);
+        h = (h ^ k) * 0x87c37b91114253d5ULL;
+        h = (h << 27) | (h >> 37);
+        p += 8;
+        size -= 8;
+    }
+
+    uint64_t tail = 0;
+    memcpy(&tail, p, size);
+    h ^= tail * m;
+
+    return hash64_mix(h);
+}
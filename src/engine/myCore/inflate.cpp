@@ -0,0 +1,621 @@
+/*
+    fast inflate (DEFLATE / zlib decoding)
+    ----------------------------
+    table entries are 32 bits:
+
+      bits  0..7    code length to consume (the whole code, subtables included)
+      bits  8..10   what it decodes to (entry_type)
+      bit   11      a second literal follows the first
+      bits 12..15   extra bits of a length / distance, or a subtable's index bits
+      bits 16..31   literal(s), length / distance base, or subtable offset
+
+    codes longer than the primary index go through a fixed size subtable
+    per prefix. code sets are checked and built exactly like stb_image's, so
+    the same streams are accepted; the only difference is that the symbols
+    the format reserves (lengths 286 / 287, distances 30 / 31) are errors
+    here, where stb quietly decodes them to nonsense.
+
+    input past the end reads as zeros, as in stb, so a stream missing its
+    last byte or so decodes the same way. unlike stb, running more than 16
+    bytes past the end is an error rather than an endless run of whatever
+    symbol all zero bits happen to decode to.
+*/
+
+#include "myCore/inflate.h"
+
+#include <string.h>
+
+#include <stb_image.h>
+
+#define LITLEN_BITS 11
+#define LITLEN_SUB_BITS 4   // codes are 15 bits at most
+#define DIST_BITS 10
+#define DIST_SUB_BITS 5
+
+#define LITLEN_TABLE_SIZE ((1 << LITLEN_BITS) + 288 * (1 << LITLEN_SUB_BITS))
+#define DIST_TABLE_SIZE ((1 << DIST_BITS) + 32 * (1 << DIST_SUB_BITS))
+
+/* room left at the end of the output for the wide match copy to overshoot into */
+#define COPY_SLACK 16
+
+/* how far past the end of the input a stream may read zeros */
+#define OVERRUN_LIMIT 16
+
+enum entry_type
+{
+    ENTRY_LITERAL,
+    ENTRY_LENGTH,   // also distances in the distance table
+    ENTRY_END,
+    ENTRY_SUBTABLE,
+    ENTRY_INVALID
+};
+
+#define ENTRY_BITS(e) ((e) & 0xff)
+#define ENTRY_TYPE(e) (((e) >> 8) & 7)
+#define ENTRY_PAIR(e) ((e) & 0x800)
+#define ENTRY_EXTRA(e) (((e) >> 12) & 15)
+#define ENTRY_VALUE(e) ((e) >> 16)
+
+static inline uint32_t make_entry(int type, int extra, uint32_t value)
+{
+    return ((uint32_t)type << 8) | ((uint32_t)extra << 12) | (value << 16);
+}
+
+static const uint16_t s_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t s_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t s_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t s_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+/* what each symbol decodes to, code length not filled in yet */
+static uint32_t litlen_symbol(int symbol)
+{
+    if (symbol < 256)
+        return make_entry(ENTRY_LITERAL, 0, (uint32_t)symbol);
+    if (symbol == 256)
+        return make_entry(ENTRY_END, 0, 0);
+    if (symbol < 286)
+        return make_entry(ENTRY_LENGTH, s_length_extra[symbol - 257], s_length_base[symbol - 257]);
+    return make_entry(ENTRY_INVALID, 0, 0);
+}
+
+static uint32_t dist_symbol(int symbol)
+{
+    if (symbol < 30)
+        return make_entry(ENTRY_LENGTH, s_dist_extra[symbol], s_dist_base[symbol]);
+    return make_entry(ENTRY_INVALID, 0, 0);
+}
+
+/* the code length alphabet's symbols stand for themselves */
+static uint32_t code_length_symbol(int symbol)
+{
+    return make_entry(ENTRY_LITERAL, 0, (uint32_t)symbol);
+}
+
+static inline uint32_t reverse_bits(uint32_t v, int bits)
+{
+    v = ((v & 0xAAAA) >> 1) | ((v & 0x5555) << 1);
+    v = ((v & 0xCCCC) >> 2) | ((v & 0x3333) << 2);
+    v = ((v & 0xF0F0) >> 4) | ((v & 0x0F0F) << 4);
+    v = ((v & 0xFF00) >> 8) | ((v & 0x00FF) << 8);
+    return v >> (16 - bits);
+}
+
+/*
+    canonical codes from code lengths (RFC 1951 3.2.2), refusing the same
+    over-subscribed sets stb_image does. anything no code reaches stays invalid.
+*/
+static bool build_table(uint32_t* table, int primary_bits, int sub_bits, const uint8_t* lengths, int count,
+                        uint32_t (*symbol_entry)(int))
+{
+    int sizes[17], next_code[16];
+    memset(sizes, 0, sizeof(sizes));
+    for (int i = 0; i < count; i++)
+        sizes[lengths[i]]++;
+    sizes[0] = 0;
+
+    for (int i = 1; i < 16; i++)
+    {
+        if (sizes[i] > (1 << i))
+            return false;
+    }
+
+    int code = 0;
+    for (int i = 1; i < 16; i++)
+    {
+        next_code[i] = code;
+        code += sizes[i];
+        if (sizes[i] && code - 1 >= (1 << i))
+            return false;
+        code <<= 1;
+    }
+
+    int primary_size = 1 << primary_bits;
+    int sub_size = 1 << sub_bits;
+    int subtables = 0;
+
+    uint32_t invalid = make_entry(ENTRY_INVALID, 0, 0);
+    for (int i = 0; i < primary_size; i++)
+        table[i] = invalid;
+
+    for (int symbol = 0; symbol < count; symbol++)
+    {
+        int length = lengths[symbol];
+        if (!length)
+            continue;
+
+        uint32_t reversed = reverse_bits((uint32_t)next_code[length]++, length);
+        uint32_t entry = symbol_entry(symbol) | (uint32_t)length;
+
+        if (length <= primary_bits)
+        {
+            for (uint32_t j = reversed; j < (uint32_t)primary_size; j += 1u << length)
+                table[j] = entry;
+            continue;
+        }
+
+        /* a table built without subtables (the code length code's) has no room for one */
+        if (sub_bits == 0)
+            return false;
+
+        /* long code: the low primary_bits pick a subtable, the rest index it */
+        uint32_t prefix = reversed & (primary_size - 1);
+        if (ENTRY_TYPE(table[prefix]) != ENTRY_SUBTABLE)
+        {
+            uint32_t offset = primary_size + subtables++ * sub_size;
+            table[prefix] = make_entry(ENTRY_SUBTABLE, sub_bits, offset) | (uint32_t)primary_bits;
+            for (int j = 0; j < sub_size; j++)
+                table[offset + j] = invalid;
+        }
+
+        uint32_t* sub = table + ENTRY_VALUE(table[prefix]);
+        int rest = length - primary_bits;
+        for (uint32_t j = reversed >> primary_bits; j < (uint32_t)sub_size; j += 1u << rest)
+            sub[j] = entry;
+    }
+
+    return true;
+}
+
+/* where a first literal's code leaves room, fold the following literal into the same entry */
+static void pair_literals(uint32_t* table)
+{
+    uint32_t single[1 << LITLEN_BITS];
+    memcpy(single, table, sizeof(single));
+
+    for (uint32_t i = 0; i < (1u << LITLEN_BITS); i++)
+    {
+        uint32_t first = single[i];
+        int first_bits = ENTRY_BITS(first);
+        if (ENTRY_TYPE(first) != ENTRY_LITERAL || first_bits >= LITLEN_BITS)
+            continue;
+
+        /* the bits after the first code, with zeros where we can't see */
+        uint32_t second = single[i >> first_bits];
+        int second_bits = ENTRY_BITS(second);
+        if (ENTRY_TYPE(second) != ENTRY_LITERAL || first_bits + second_bits > LITLEN_BITS)
+            continue;
+
+        table[i] = make_entry(ENTRY_LITERAL, 0, ENTRY_VALUE(first) | (ENTRY_VALUE(second) << 8))
+            | 0x800 | (uint32_t)(first_bits + second_bits);
+    }
+}
+
+struct inflate_state
+{
+    const uint8_t* in;
+    size_t in_size;
+    size_t in_pos;          // may run past in_size: those bytes read as zero
+
+    uint64_t bits;
+    int bit_count;
+
+    uint8_t* out;
+    size_t out_pos;
+    size_t capacity;
+    inflate_grow_func grow;
+    void* user;
+
+    uint32_t litlen[LITLEN_TABLE_SIZE];
+    uint32_t dist[DIST_TABLE_SIZE];
+};
+
+/* at least 56 bits afterwards; on a bit buffer held outside the state (decode_block keeps it in locals) */
+static inline void refill_bits(const inflate_state& s, size_t& in_pos, uint64_t& bits, int& bit_count)
+{
+    if (in_pos + 8 <= s.in_size)
+    {
+        /* whole bytes that don't fit are loaded again next time, harmlessly */
+        uint64_t v;
+        memcpy(&v, s.in + in_pos, 8);
+        bits |= v << bit_count;
+        in_pos += (63 - bit_count) >> 3;
+        bit_count |= 56;
+        return;
+    }
+
+    while (bit_count <= 56)
+    {
+        uint64_t byte = in_pos < s.in_size ? s.in[in_pos] : 0;
+        bits |= byte << bit_count;
+        in_pos++;
+        bit_count += 8;
+    }
+}
+
+static inline void refill(inflate_state& s)
+{
+    refill_bits(s, s.in_pos, s.bits, s.bit_count);
+}
+
+static inline uint32_t take(inflate_state& s, int n)
+{
+    if (s.bit_count < n)
+        refill(s);
+    uint32_t v = (uint32_t)(s.bits & ((1ull << n) - 1));
+    s.bits >>= n;
+    s.bit_count -= n;
+    return v;
+}
+
+static bool make_room(inflate_state& s, size_t needed)
+{
+    if (s.out_pos + needed <= s.capacity)
+        return true;
+    if (!s.grow)
+        return false;
+
+    size_t capacity = s.capacity ? s.capacity : 1;
+    while (s.out_pos + needed > capacity)
+        capacity *= 2;
+
+    uint8_t* grown = s.grow(s.out, s.capacity, capacity, s.user);
+    if (!grown)
+        return false;
+
+    s.out = grown;
+    s.capacity = capacity;
+    return true;
+}
+
+/* lookups go through a subtable when the primary entry says so */
+static inline uint32_t lookup(const uint32_t* table, int primary_bits, uint64_t bits)
+{
+    uint32_t e = table[bits & ((1u << primary_bits) - 1)];
+    if (ENTRY_TYPE(e) == ENTRY_SUBTABLE)
+        e = table[ENTRY_VALUE(e) + ((bits >> primary_bits) & ((1u << ENTRY_EXTRA(e)) - 1))];
+    return e;
+}
+
+static inline void copy_match(uint8_t* dst, size_t dist, size_t length, bool wide)
+{
+    const uint8_t* src = dst - dist;
+
+    if (wide && dist >= 16)
+    {
+        /* 16 byte stores, may overshoot by up to 15 (there is slack for that) */
+        uint8_t* end = dst + length;
+        do
+        {
+            memcpy(dst, src, 16);
+            dst += 16;
+            src += 16;
+        } while (dst < end);
+        return;
+    }
+
+    if (wide && dist >= 8)
+    {
+        uint8_t* end = dst + length;
+        do
+        {
+            memcpy(dst, src, 8);
+            dst += 8;
+            src += 8;
+        } while (dst < end);
+        return;
+    }
+
+    if (dist == 1)
+    {
+        memset(dst, *src, length);
+        return;
+    }
+
+    while (length--)
+        *dst++ = *src++;
+}
+
+/*
+    the hot loop works on locals, written back on the way out: stores into
+    the output are byte stores, which the compiler must assume can alias
+    anything in the state, so leaving the bit buffer there reloads it per byte.
+*/
+static bool decode_block(inflate_state& s)
+{
+    uint64_t bits = s.bits;
+    int bit_count = s.bit_count;
+    size_t in_pos = s.in_pos;
+    uint8_t* out = s.out;
+    size_t out_pos = s.out_pos;
+    size_t capacity = s.capacity;
+    const uint32_t* litlen = s.litlen;
+    const uint32_t* dist_table = s.dist;
+    bool ok = false;
+
+    for (;;)
+    {
+        /* a code, its extra bits, a distance code and its extra bits: 48 bits at most */
+        if (bit_count < 48)
+        {
+            refill_bits(s, in_pos, bits, bit_count);
+            if (in_pos > s.in_size + OVERRUN_LIMIT)
+                break;
+        }
+
+        uint32_t e = lookup(litlen, LITLEN_BITS, bits);
+        int n = ENTRY_BITS(e);
+        bits >>= n;
+        bit_count -= n;
+        int type = ENTRY_TYPE(e);
+
+        if (type == ENTRY_LITERAL)
+        {
+            /* pairs and singles are mixed about evenly in photo-like data, so no branch on which:
+               both bytes are stored (a single's second is zero, overwritten next) and the position moves 1 or 2 */
+            if (out_pos + 2 <= capacity)
+            {
+                out[out_pos] = (uint8_t)ENTRY_VALUE(e);
+                out[out_pos + 1] = (uint8_t)(ENTRY_VALUE(e) >> 8);
+                out_pos += 1 + (ENTRY_PAIR(e) >> 11);
+                continue;
+            }
+
+            s.out_pos = out_pos;
+            if (!make_room(s, ENTRY_PAIR(e) ? 2 : 1))
+                break;
+            out = s.out;
+            capacity = s.capacity;
+            out[out_pos++] = (uint8_t)ENTRY_VALUE(e);
+            if (ENTRY_PAIR(e))
+                out[out_pos++] = (uint8_t)(ENTRY_VALUE(e) >> 8);
+            continue;
+        }
+
+        if (type == ENTRY_END)
+        {
+            ok = true;
+            break;
+        }
+        if (type != ENTRY_LENGTH)
+            break;
+
+        int extra = ENTRY_EXTRA(e);
+        size_t length = ENTRY_VALUE(e) + (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        bit_count -= extra;
+
+        uint32_t d = lookup(dist_table, DIST_BITS, bits);
+        if (ENTRY_TYPE(d) != ENTRY_LENGTH)
+            break;
+        n = ENTRY_BITS(d);
+        bits >>= n;
+        bit_count -= n;
+
+        extra = ENTRY_EXTRA(d);
+        size_t dist = ENTRY_VALUE(d) + (size_t)(bits & ((1u << extra) - 1));
+        bits >>= extra;
+        bit_count -= extra;
+
+        if (dist > out_pos)
+            break;
+        if (out_pos + length > capacity)
+        {
+            s.out_pos = out_pos;
+            if (!make_room(s, length))
+                break;
+            out = s.out;
+            capacity = s.capacity;
+        }
+
+        copy_match(out + out_pos, dist, length, out_pos + length + COPY_SLACK <= capacity);
+        out_pos += length;
+    }
+
+    s.bits = bits;
+    s.bit_count = bit_count;
+    s.in_pos = in_pos;
+    s.out_pos = out_pos;
+    return ok;
+}
+
+static bool stored_block(inflate_state& s)
+{
+    /* back to a byte boundary, then hand the whole bytes still buffered back to the input */
+    take(s, s.bit_count & 7);
+    s.in_pos -= s.bit_count >> 3;
+    s.bits = 0;
+    s.bit_count = 0;
+
+    uint8_t header[4];
+    for (int i = 0; i < 4; i++, s.in_pos++)
+        header[i] = s.in_pos < s.in_size ? s.in[s.in_pos] : 0;
+
+    size_t length = header[0] | (header[1] << 8);
+    size_t inverse = header[2] | (header[3] << 8);
+    if (inverse != (length ^ 0xffff) || s.in_pos + length > s.in_size || !make_room(s, length))
+        return false;
+
+    memcpy(s.out + s.out_pos, s.in + s.in_pos, length);
+    s.out_pos += length;
+    s.in_pos += length;
+    return true;
+}
+
+static bool dynamic_tables(inflate_state& s)
+{
+    static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    int hlit = (int)take(s, 5) + 257;
+    int hdist = (int)take(s, 5) + 1;
+    int hclen = (int)take(s, 4) + 4;
+
+    uint8_t code_lengths[19];
+    memset(code_lengths, 0, sizeof(code_lengths));
+    for (int i = 0; i < hclen; i++)
+        code_lengths[order[i]] = (uint8_t)take(s, 3);
+
+    /* the code length code is 7 bits at most, a primary table covers it */
+    uint32_t lengths_table[1 << 7];
+    if (!build_table(lengths_table, 7, 0, code_lengths, 19, code_length_symbol))
+        return false;
+
+    uint8_t lengths[286 + 32 + 137];
+    int n = 0, total = hlit + hdist;
+    while (n < total)
+    {
+        if (s.bit_count < 16)
+            refill(s);
+        if (s.in_pos > s.in_size + OVERRUN_LIMIT)
+            return false;
+
+        uint32_t e = lengths_table[s.bits & 127];
+        if (ENTRY_TYPE(e) == ENTRY_INVALID)
+            return false;
+        int bits = ENTRY_BITS(e);
+        s.bits >>= bits;
+        s.bit_count -= bits;
+
+        int c = (int)ENTRY_VALUE(e);
+        if (c < 16)
+        {
+            lengths[n++] = (uint8_t)c;
+            continue;
+        }
+
+        uint8_t fill = 0;
+        int repeat;
+        if (c == 16)
+        {
+            if (n == 0)
+                return false;
+            repeat = (int)take(s, 2) + 3;
+            fill = lengths[n - 1];
+        }
+        else if (c == 17)
+            repeat = (int)take(s, 3) + 3;
+        else
+            repeat = (int)take(s, 7) + 11;
+
+        if (total - n < repeat)
+            return false;
+        memset(lengths + n, fill, repeat);
+        n += repeat;
+    }
+
+    return build_table(s.litlen, LITLEN_BITS, LITLEN_SUB_BITS, lengths, hlit, litlen_symbol)
+        && build_table(s.dist, DIST_BITS, DIST_SUB_BITS, lengths + hlit, hdist, dist_symbol);
+}
+
+static bool fixed_tables(inflate_state& s)
+{
+    uint8_t lengths[288 + 32];
+    int i = 0;
+    for (; i <= 143; i++) lengths[i] = 8;
+    for (; i <= 255; i++) lengths[i] = 9;
+    for (; i <= 279; i++) lengths[i] = 7;
+    for (; i <= 287; i++) lengths[i] = 8;
+    for (; i < 288 + 32; i++) lengths[i] = 5;
+
+    return build_table(s.litlen, LITLEN_BITS, LITLEN_SUB_BITS, lengths, 288, litlen_symbol)
+        && build_table(s.dist, DIST_BITS, DIST_SUB_BITS, lengths + 288, 32, dist_symbol);
+}
+
+bool inflate_decode(const uint8_t* in, size_t in_size, bool zlib_header,
+                    uint8_t** out, size_t* capacity, size_t* written,
+                    inflate_grow_func grow, void* user)
+{
+    /* the tables are ~40KB, too much for a worker thread's stack */
+    inflate_state* state = new inflate_state;
+    inflate_state& s = *state;
+    s.in = in;
+    s.in_size = in_size;
+    s.in_pos = 0;
+    s.bits = 0;
+    s.bit_count = 0;
+    s.out = *out;
+    s.out_pos = 0;
+    s.capacity = *capacity;
+    s.grow = grow;
+    s.user = user;
+
+    bool ok = true;
+    if (zlib_header)
+    {
+        int cmf = in_size > 0 ? in[0] : 0;
+        int flg = in_size > 1 ? in[1] : 0;
+        ok = (cmf * 256 + flg) % 31 == 0 && !(flg & 32) && (cmf & 15) == 8;
+        s.in_pos = 2;
+    }
+
+    bool final_block = false;
+    while (ok && !final_block && s.in_pos <= s.in_size + OVERRUN_LIMIT)
+    {
+        final_block = take(s, 1) != 0;
+        switch (take(s, 2))
+        {
+        case 0:
+            ok = stored_block(s);
+            break;
+        case 1:
+            ok = fixed_tables(s) && (pair_literals(s.litlen), decode_block(s));
+            break;
+        case 2:
+            ok = dynamic_tables(s) && (pair_literals(s.litlen), decode_block(s));
+            break;
+        default:
+            ok = false;
+        }
+    }
+    ok = ok && final_block;
+
+    *out = s.out;
+    *capacity = s.capacity;
+    *written = s.out_pos;
+
+    delete state;
+    return ok;
+}
+
+/* ------------------------------------------------------------------------ */
+/* stb_image hook */
+
+static uint8_t* stb_grow(uint8_t* out, size_t old_size, size_t new_size, void* user)
+{
+    stbi_zlib_grow_func grow = *(stbi_zlib_grow_func*)user;
+    if (new_size > 0x7fffffff)
+        return NULL;
+    return grow(out, (int)old_size, (int)new_size);
+}
+
+static int stb_inflate(const stbi_uc* in, int in_len, int parse_header, stbi_uc** out, int* out_size, stbi_zlib_grow_func grow)
+{
+    size_t capacity = (size_t)*out_size;
+    size_t written = 0;
+    bool ok = inflate_decode(in, (size_t)in_len, parse_header != 0, out, &capacity, &written,
+                             grow ? stb_grow : NULL, &grow);
+    *out_size = (int)capacity;
+    return ok ? (int)written : -1;
+}
+
+void inflate_install_stb(bool enable)
+{
+    stbi_set_zlib_inflate(enable ? stb_inflate : NULL);
+}
@@ -0,0 +1,32 @@
+/*
+    fast inflate (DEFLATE / zlib decoding)
+    ----------------------------
+    a drop-in engine for stb_image's zlib decoder: same output for every
+    valid stream, faster getting there. 11 bit literal/length tables that
+    hold two literals per entry when both codes fit, a 64 bit bit buffer
+    refilled 8 bytes at a time, and matches copied 16 bytes per store.
+
+    inflate_install_stb() puts it behind the stbi_zlib_decode_* functions,
+    which is where stb's PNG loader inflates image data. call it once at
+    startup, before any thread decodes.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* reallocate out to new_size bytes keeping the first old_size; NULL on failure */
+typedef uint8_t* (*inflate_grow_func)(uint8_t* out, size_t old_size, size_t new_size, void* user);
+
+/*
+    decodes into *out (*capacity bytes). when a stream needs more room and
+    grow is not NULL, the buffer is grown (doubling) and *out / *capacity
+    updated. returns false on corrupt data or when out of room; *written is
+    what was produced either way.
+*/
+bool inflate_decode(const uint8_t* in, size_t in_size, bool zlib_header,
+                    uint8_t** out, size_t* capacity, size_t* written,
+                    inflate_grow_func grow, void* user);
+
+/* route stbi_zlib_decode_* (and so PNG loading) through inflate_decode; false puts stb's own back */
+void inflate_install_stb(bool enable = true);
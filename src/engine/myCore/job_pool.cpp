@@ -0,0 +1,216 @@
+/*
+    a tiny pool of SDL worker threads
+    ----------------------------
+    one mutex guards the queue and every job_counter, which keeps the
+    bookkeeping simple; jobs are expected to be coarse (an image, a band of rows)
+*/
+
+#include "myCore/job_pool.h"
+
+#include <stdio.h>
+#include <deque>
+#include <vector>
+
+struct job
+{
+    job_func func;
+    void* user;
+    job_counter* counter;
+};
+
+struct job_pool
+{
+    SDL_mutex* lock;
+    SDL_cond* work_ready;   // signalled when a job is queued (or on shutdown)
+    SDL_cond* work_done;    // signalled when a counted job finishes
+    std::deque<job> queue;
+    std::vector<SDL_Thread*> threads;
+    bool quit;
+};
+
+/* runs one job and settles its counter, called with the lock NOT held */
+static void run_job(job_pool* pool, const job& j)
+{
+    j.func(j.user);
+
+    if (j.counter)
+    {
+        SDL_LockMutex(pool->lock);
+        j.counter->pending--;
+        SDL_CondBroadcast(pool->work_done);
+        SDL_UnlockMutex(pool->lock);
+    }
+}
+
+static int worker_main(void* data)
+{
+    job_pool* pool = (job_pool*)data;
+
+    SDL_LockMutex(pool->lock);
+    while (1)
+    {
+        while (pool->queue.empty() && !pool->quit)
+            SDL_CondWait(pool->work_ready, pool->lock);
+
+        if (pool->queue.empty())
+            break; // quit requested and nothing left to do
+
+        job j = pool->queue.front();
+        pool->queue.pop_front();
+
+        SDL_UnlockMutex(pool->lock);
+        run_job(pool, j);
+        SDL_LockMutex(pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+
+    return 0;
+}
+
+job_pool* job_pool_create(int thread_count, const char* name)
+{
+    if (thread_count <= 0)
+    {
+        thread_count = SDL_GetCPUCount() - 1;
+        if (thread_count < 1)
+            thread_count = 1;
+    }
+
+    job_pool* pool = new job_pool;
+    pool->lock = SDL_CreateMutex();
+    pool->work_ready = SDL_CreateCond();
+    pool->work_done = SDL_CreateCond();
+    pool->quit = false;
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        SDL_Thread* thread = SDL_CreateThread(worker_main, name ? name : "job_pool", pool);
+        if (!thread)
+        {
+            printf("job pool: unable to create worker thread: %s\n", SDL_GetError());
+            break;
+        }
+        pool->threads.push_back(thread);
+    }
+
+    return pool;
+}
+
+void job_pool_destroy(job_pool* pool)
+{
+    if (!pool)
+        return;
+
+    /* workers drain whatever is still queued before they exit */
+    SDL_LockMutex(pool->lock);
+    pool->quit = true;
+    SDL_CondBroadcast(pool->work_ready);
+    SDL_UnlockMutex(pool->lock);
+
+    for (size_t i = 0; i < pool->threads.size(); i++)
+        SDL_WaitThread(pool->threads[i], NULL);
+
+    SDL_DestroyCond(pool->work_done);
+    SDL_DestroyCond(pool->work_ready);
+    SDL_DestroyMutex(pool->lock);
+    delete pool;
+}
+
+int job_pool_thread_count(const job_pool* pool)
+{
+    return pool ? (int)pool->threads.size() : 0;
+}
+
+void job_pool_submit(job_pool* pool, job_func func, void* user, job_counter* counter)
+{
+    /* no pool (or no threads), just do the work right here */
+    if (!pool || pool->threads.empty())
+    {
+        func(user);
+        return;
+    }
+
+    job j = { func, user, counter };
+
+    SDL_LockMutex(pool->lock);
+    if (counter)
+        counter->pending++;
+    pool->queue.push_back(j);
+    SDL_CondSignal(pool->work_ready);
+    SDL_UnlockMutex(pool->lock);
+}
+
+void job_pool_wait(job_pool* pool, job_counter* counter)
+{
+    if (!pool || !counter)
+        return;
+
+    SDL_LockMutex(pool->lock);
+    while (counter->pending > 0)
+    {
+        /* rather than idle, steal queued work (ours or anyone's) */
+        if (!pool->queue.empty())
+        {
+            job j = pool->queue.front();
+            pool->queue.pop_front();
+
+            SDL_UnlockMutex(pool->lock);
+            run_job(pool, j);
+            SDL_LockMutex(pool->lock);
+            continue;
+        }
+
+        SDL_CondWait(pool->work_done, pool->lock);
+    }
+    SDL_UnlockMutex(pool->lock);
+}
+
+struct range_job
+{
+    job_range_func func;
+    void* user;
+    int begin, end;
+};
+
+static void run_range_job(void* data)
+{
+    range_job* r = (range_job*)data;
+    r->func(r->user, r->begin, r->end);
+}
+
+void job_pool_parallel_for(job_pool* pool, int count, int min_band, job_range_func func, void* user)
+{
+    if (count <= 0)
+        return;
+    if (min_band < 1)
+        min_band = 1;
+
+    /* one band per worker plus one for the calling thread */
+    int bands = job_pool_thread_count(pool) + 1;
+    if (bands > (count + min_band - 1) / min_band)
+        bands = (count + min_band - 1) / min_band;
+
+    if (bands <= 1)
+    {
+        func(user, 0, count);
+        return;
+    }
+
+    std::vector<range_job> jobs(bands);
+    job_counter counter = { 0 };
+
+    for (int i = 0; i < bands; i++)
+    {
+        jobs[i].func = func;
+        jobs[i].user = user;
+        jobs[i].begin = (int)((long long)count * i / bands);
+        jobs[i].end = (int)((long long)count * (i + 1) / bands);
+    }
+
+    /* hand out all but the first band, then chew on that one ourselves */
+    for (int i = 1; i < bands; i++)
+        job_pool_submit(pool, run_range_job, &jobs[i], &counter);
+
+    run_range_job(&jobs[0]);
+    job_pool_wait(pool, &counter);
+}
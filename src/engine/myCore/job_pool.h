@@ -0,0 +1,37 @@
+/*
+    a tiny pool of SDL worker threads
+    ----------------------------
+    jobs are plain function pointers plus a user pointer, run in FIFO order.
+    a job_counter lets the submitting thread wait for a batch of jobs, and
+    the waiting thread helps out by running queued jobs instead of sleeping.
+*/
+#pragma once
+
+#include "SDL.h"
+
+typedef void (*job_func)(void* user);
+typedef void (*job_range_func)(void* user, int begin, int end);
+
+struct job_pool;
+
+/* tracks how many submitted jobs of a batch are still outstanding */
+struct job_counter
+{
+    int pending;
+};
+
+/* thread_count <= 0 picks one worker per logical core, minus the caller's */
+job_pool* job_pool_create(int thread_count, const char* name);
+void job_pool_destroy(job_pool* pool);
+
+int job_pool_thread_count(const job_pool* pool);
+
+/* queue a job; counter may be NULL for fire-and-forget work */
+void job_pool_submit(job_pool* pool, job_func func, void* user, job_counter* counter);
+
+/* block until every job tied to the counter has finished, running queued jobs (anyone's) meanwhile:
+   from inside a job, only wait on a pool whose jobs never block on something that job holds up */
+void job_pool_wait(job_pool* pool, job_counter* counter);
+
+/* split [0, count) into roughly even bands and run them across the pool */
+void job_pool_parallel_for(job_pool* pool, int count, int min_band, job_range_func func, void* user);
@@ -0,0 +1,193 @@
+/*
+    small byte-oriented LZ77 block codec
+    ----------------------------
+    sequence: token (literal count << 4 | match length - 4), extra literal
+    count bytes, literals, 2 byte offset, extra match length bytes.
+    the last 5 bytes are always literals and no match starts in the last 12,
+    which is what LZ4 decoders expect.
+*/
+
+#include "myCore/lz_block.h"
+
+#include <string.h>
+
+#define LZ_MIN_MATCH 4
+#define LZ_LAST_LITERALS 5
+#define LZ_MATCH_LIMIT 12
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+static inline uint32_t read32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* 15 in the token, then 255s, then the remainder */
+static bool put_length(uint8_t*& op, const uint8_t* end, size_t length)
+{
+    while (length >= 255)
+    {
+        if (op >= end)
+            return false;
+        *op++ = 255;
+        length -= 255;
+    }
+    if (op >= end)
+        return false;
+    *op++ = (uint8_t)length;
+    return true;
+}
+
+static bool put_sequence(uint8_t*& op, const uint8_t* end, const uint8_t* literals, size_t literal_count,
+                         size_t offset, size_t match_length)
+{
+    if (op >= end)
+        return false;
+
+    uint8_t* token = op++;
+    *token = (uint8_t)((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15 && !put_length(op, end, literal_count - 15))
+        return false;
+
+    if ((size_t)(end - op) < literal_count)
+        return false;
+    memcpy(op, literals, literal_count);
+    op += literal_count;
+
+    if (match_length == 0)
+        return true; // final, literals-only sequence
+
+    if (end - op < 2)
+        return false;
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+
+    size_t m = match_length - LZ_MIN_MATCH;
+    *token |= (uint8_t)(m < 15 ? m : 15);
+    if (m >= 15 && !put_length(op, end, m - 15))
+        return false;
+
+    return true;
+}
+
+size_t lz_compress_bound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t lz_compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity)
+{
+    uint32_t table[1 << LZ_HASH_BITS];
+    memset(table, 0, sizeof(table));
+
+    uint8_t* op = dst;
+    const uint8_t* end = dst + capacity;
+    size_t anchor = 0;
+    size_t ip = 0;
+
+    if (size > LZ_MATCH_LIMIT)
+    {
+        size_t limit = size - LZ_MATCH_LIMIT;
+        while (ip < limit)
+        {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = hash4(seq);
+            size_t ref = table[h];
+            table[h] = (uint32_t)ip;
+
+            if (ref < ip && ip - ref <= LZ_MAX_OFFSET && read32(src + ref) == seq)
+            {
+                size_t length = LZ_MIN_MATCH;
+                while (ip + length < size - LZ_LAST_LITERALS && src[ref + length] == src[ip + length])
+                    length++;
+
+                if (!put_sequence(op, end, src + anchor, ip - anchor, ip - ref, length))
+                    return 0;
+
+                ip += length;
+                anchor = ip;
+                continue;
+            }
+            ip++;
+        }
+    }
+
+    if (!put_sequence(op, end, src + anchor, size - anchor, 0, 0))
+        return 0;
+
+    return (size_t)(op - dst);
+}
+
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size)
+{
+    const uint8_t* ip = src;
+    const uint8_t* in_end = src + size;
+    uint8_t* op = dst;
+    uint8_t* out_end = dst + raw_size;
+
+    while (ip < in_end)
+    {
+        uint8_t token = *ip++;
+
+        size_t literal_count = token >> 4;
+        if (literal_count == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= in_end)
+                    return false;
+                b = *ip++;
+                literal_count += b;
+            } while (b == 255);
+        }
+
+        if ((size_t)(in_end - ip) < literal_count || (size_t)(out_end - op) < literal_count)
+            return false;
+        memcpy(op, ip, literal_count);
+        ip += literal_count;
+        op += literal_count;
+
+        if (ip >= in_end)
+            break; // the last sequence has no match
+
+        if (in_end - ip < 2)
+            return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst))
+            return false;
+
+        size_t match_length = (token & 15);
+        if (match_length == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (ip >= in_end)
+                    return false;
+                b = *ip++;
+                match_length += b;
+            } while (b == 255);
+        }
+        match_length += LZ_MIN_MATCH;
+
+        if ((size_t)(out_end - op) < match_length)
+            return false;
+
+        /* matches may overlap their own output, so copy forwards byte by byte */
+        const uint8_t* match = op - offset;
+        for (size_t i = 0; i < match_length; i++)
+            op[i] = match[i];
+        op += match_length;
+    }
+
+    return op == out_end;
+}
@@ -0,0 +1,21 @@
+/*
+    small byte-oriented LZ77 block codec
+    ----------------------------
+    the block layout is LZ4's (token, literals, 16 bit offset, match length),
+    so any LZ4 block decoder can read what this writes. the compressor is a
+    single-probe greedy matcher: quick, not tight. meant for packing assets
+    that aren't already compressed (shaders, raw texels, text).
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* worst case output size for size input bytes */
+size_t lz_compress_bound(size_t size);
+
+/* returns the compressed size, 0 if it didn't fit in capacity */
+size_t lz_compress(const uint8_t* src, size_t size, uint8_t* dst, size_t capacity);
+
+/* raw_size must be the exact original size; false on corrupt input */
+bool lz_decompress(const uint8_t* src, size_t size, uint8_t* dst, size_t raw_size);
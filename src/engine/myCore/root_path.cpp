@@ -0,0 +1,40 @@
+/*
+    paths under the executable
+    ----------------------------
+    mkdir one component at a time; it fails harmlessly on the ones that are
+    already there, so nothing is checked first.
+*/
+
+#include "myCore/root_path.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static void make_directory(const std::string& path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0755);
+#endif
+}
+
+std::string root_path_make_directory(const char* dir)
+{
+    std::string full = g_root_path;
+    full += dir;
+    if (full[full.size() - 1] != '/' && full[full.size() - 1] != '\\')
+        full += '/';
+
+    for (size_t i = strlen(g_root_path); i < full.size(); i++)
+    {
+        if (full[i] == '/' || full[i] == '\\')
+            make_directory(full.substr(0, i));
+    }
+    return full;
+}
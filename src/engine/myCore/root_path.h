@@ -0,0 +1,17 @@
+/*
+    paths under the executable
+    ----------------------------
+    data, caches and the archive all live next to the executable: every
+    relative path the engine opens is appended to g_root_path (with its
+    trailing separator), which main fills in from argv[0]. tools without
+    such a root define it empty, so their paths land in the working
+    directory.
+*/
+#pragma once
+
+#include <string>
+
+extern char g_root_path[256];
+
+/* g_root_path + dir with a trailing '/', every directory along it created (existing ones are fine) */
+std::string root_path_make_directory(const char* dir);
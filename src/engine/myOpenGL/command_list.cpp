@@ -0,0 +1,411 @@
+/*
+    command lists
+    ----------------------------
+    a command is a header (type, size in bytes, itself included) followed
+    by its fixed fields and, for uniforms, the values. sizes are rounded up
+    to 8 so every command starts aligned for the pointers and 64 bit
+    fields it carries, and zeroed first, so padding never holds stale
+    bytes and equal recordings are equal byte for byte. replay walks the
+    buffer header to header.
+*/
+
+#include "myOpenGL/command_list.h"
+#include "myOpenGL/gl_state.h"
+#include "myCore/hash.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+enum command_type
+{
+    COMMAND_USE_PROGRAM,
+    COMMAND_BIND_VERTEX_ARRAY,
+    COMMAND_BIND_TEXTURE,
+    COMMAND_POLYGON_MODE,
+    COMMAND_UNIFORM,
+    COMMAND_DRAW_ELEMENTS,
+    COMMAND_DRAW_ARRAYS,
+    COMMAND_PACKET
+};
+
+enum uniform_kind
+{
+    UNIFORM_INT,
+    UNIFORM_FLOAT,
+    UNIFORM_VEC2,
+    UNIFORM_VEC3,
+    UNIFORM_VEC4,
+    UNIFORM_MAT4
+};
+
+struct command_header
+{
+    uint32_t type;
+    uint32_t size;
+};
+
+struct command_bind
+{
+    command_header header;
+    GLuint name;
+};
+
+struct command_bind_texture
+{
+    command_header header;
+    GLuint unit;
+    GLenum target;
+    GLuint texture;
+};
+
+struct command_polygon_mode
+{
+    command_header header;
+    GLenum mode;
+};
+
+struct command_uniform
+{
+    command_header header;
+    shader_reflection* reflection;
+    int index;
+    int kind;
+    int count;
+    // the values follow
+};
+
+struct command_draw
+{
+    command_header header;
+    GLenum primitive;
+    GLsizei count;
+    GLenum index_type;
+    GLint first;
+    uintptr_t offset;
+};
+
+struct command_packet
+{
+    command_header header;
+    int pass;
+    float depth;
+    render_packet packet;
+};
+
+struct command_list
+{
+    std::vector<uint8_t> buffer;
+    size_t used;
+    int count;
+};
+
+command_list* command_list_create(size_t capacity)
+{
+    command_list* list = new command_list;
+    list->buffer.resize(capacity > 0 ? capacity : 4096);
+    list->used = 0;
+    list->count = 0;
+    return list;
+}
+
+void command_list_destroy(command_list* list)
+{
+    delete list;
+}
+
+void command_list_reset(command_list* list)
+{
+    list->used = 0;
+    list->count = 0;
+}
+
+int command_list_count(const command_list* list)
+{
+    return list->count;
+}
+
+size_t command_list_bytes(const command_list* list)
+{
+    return list->used;
+}
+
+uint64_t command_list_hash(const command_list* list)
+{
+    return list->used ? hash64(&list->buffer[0], list->used) : 0;
+}
+
+/* room for a command of size bytes (plus extra after its fields), header filled in */
+static void* append(command_list* list, command_type type, size_t size, size_t extra = 0)
+{
+    size_t total = (size + extra + 7) & ~(size_t)7;
+    if (list->used + total > list->buffer.size())
+        list->buffer.resize((list->used + total) * 2);
+
+    command_header* header = (command_header*)&list->buffer[list->used];
+    memset(header, 0, total);
+    header->type = type;
+    header->size = (uint32_t)total;
+    list->used += total;
+    list->count++;
+    return header;
+}
+
+void command_list_use_program(command_list* list, GLuint program)
+{
+    command_bind* command = (command_bind*)append(list, COMMAND_USE_PROGRAM, sizeof(command_bind));
+    command->name = program;
+}
+
+void command_list_bind_vertex_array(command_list* list, GLuint vao)
+{
+    command_bind* command = (command_bind*)append(list, COMMAND_BIND_VERTEX_ARRAY, sizeof(command_bind));
+    command->name = vao;
+}
+
+void command_list_bind_texture(command_list* list, GLuint unit, GLenum target, GLuint texture)
+{
+    command_bind_texture* command = (command_bind_texture*)append(list, COMMAND_BIND_TEXTURE, sizeof(command_bind_texture));
+    command->unit = unit;
+    command->target = target;
+    command->texture = texture;
+}
+
+void command_list_polygon_mode(command_list* list, GLenum mode)
+{
+    command_polygon_mode* command = (command_polygon_mode*)append(list, COMMAND_POLYGON_MODE, sizeof(command_polygon_mode));
+    command->mode = mode;
+}
+
+static void record_uniform(command_list* list, shader_reflection* reflection, int index, uniform_kind kind,
+                           const void* v, size_t bytes, int count)
+{
+    if (index < 0 || count < 1)
+        return;
+
+    command_uniform* command = (command_uniform*)append(list, COMMAND_UNIFORM, sizeof(command_uniform), bytes * count);
+    command->reflection = reflection;
+    command->index = index;
+    command->kind = kind;
+    command->count = count;
+    memcpy(command + 1, v, bytes * count);
+}
+
+void command_list_set_int(command_list* list, shader_reflection* reflection, uniform_int handle, const GLint* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_INT, v, sizeof(GLint), count);
+}
+
+void command_list_set_int(command_list* list, shader_reflection* reflection, uniform_int handle, GLint v)
+{
+    command_list_set_int(list, reflection, handle, &v, 1);
+}
+
+void command_list_set_float(command_list* list, shader_reflection* reflection, uniform_float handle, const GLfloat* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_FLOAT, v, sizeof(GLfloat), count);
+}
+
+void command_list_set_float(command_list* list, shader_reflection* reflection, uniform_float handle, GLfloat v)
+{
+    command_list_set_float(list, reflection, handle, &v, 1);
+}
+
+void command_list_set_vec2(command_list* list, shader_reflection* reflection, uniform_vec2 handle, const GLfloat* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_VEC2, v, 2 * sizeof(GLfloat), count);
+}
+
+void command_list_set_vec3(command_list* list, shader_reflection* reflection, uniform_vec3 handle, const GLfloat* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_VEC3, v, 3 * sizeof(GLfloat), count);
+}
+
+void command_list_set_vec4(command_list* list, shader_reflection* reflection, uniform_vec4 handle, const GLfloat* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_VEC4, v, 4 * sizeof(GLfloat), count);
+}
+
+void command_list_set_mat4(command_list* list, shader_reflection* reflection, uniform_mat4 handle, const GLfloat* v, int count)
+{
+    record_uniform(list, reflection, handle.index, UNIFORM_MAT4, v, 16 * sizeof(GLfloat), count);
+}
+
+void command_list_draw_elements(command_list* list, GLenum primitive, GLsizei count, GLenum index_type, uintptr_t offset)
+{
+    command_draw* command = (command_draw*)append(list, COMMAND_DRAW_ELEMENTS, sizeof(command_draw));
+    command->primitive = primitive;
+    command->count = count;
+    command->index_type = index_type;
+    command->first = 0;
+    command->offset = offset;
+}
+
+void command_list_draw_arrays(command_list* list, GLenum primitive, GLint first, GLsizei count)
+{
+    command_draw* command = (command_draw*)append(list, COMMAND_DRAW_ARRAYS, sizeof(command_draw));
+    command->primitive = primitive;
+    command->count = count;
+    command->index_type = 0;
+    command->first = first;
+    command->offset = 0;
+}
+
+void command_list_submit(command_list* list, int pass, const render_packet& packet, float depth)
+{
+    command_packet* command = (command_packet*)append(list, COMMAND_PACKET, sizeof(command_packet));
+    command->pass = pass;
+    command->depth = depth;
+    command->packet = packet;
+}
+
+struct record_band
+{
+    command_record_func func;
+    void* user;
+    command_list* list;
+    int begin;
+    int end;
+};
+
+static void record_job(void* user)
+{
+    record_band* band = (record_band*)user;
+    band->func(band->user, band->list, band->begin, band->end);
+}
+
+void command_lists_record(job_pool* pool, command_list* const* lists, int list_count, int item_count,
+                          command_record_func func, void* user)
+{
+    std::vector<record_band> bands(list_count);
+    job_counter counter = { 0 };
+
+    /* the bands depend on the counts alone, so each list gets the same items whichever thread records it */
+    for (int i = 0; i < list_count; i++)
+    {
+        record_band& band = bands[i];
+        band.func = func;
+        band.user = user;
+        band.list = lists[i];
+        band.begin = (int)((int64_t)item_count * i / list_count);
+        band.end = (int)((int64_t)item_count * (i + 1) / list_count);
+
+        command_list_reset(band.list);
+        if (pool)
+            job_pool_submit(pool, record_job, &band, &counter);
+        else
+            record_job(&band);
+    }
+
+    if (pool)
+        job_pool_wait(pool, &counter);
+}
+
+static void replay_uniform(const command_uniform* command)
+{
+    const void* v = command + 1;
+    switch (command->kind)
+    {
+    case UNIFORM_INT:
+    {
+        uniform_int handle = { command->index };
+        shader_set_int(command->reflection, handle, (const GLint*)v, command->count);
+        break;
+    }
+    case UNIFORM_FLOAT:
+    {
+        uniform_float handle = { command->index };
+        shader_set_float(command->reflection, handle, (const GLfloat*)v, command->count);
+        break;
+    }
+    case UNIFORM_VEC2:
+    {
+        uniform_vec2 handle = { command->index };
+        shader_set_vec2(command->reflection, handle, (const GLfloat*)v, command->count);
+        break;
+    }
+    case UNIFORM_VEC3:
+    {
+        uniform_vec3 handle = { command->index };
+        shader_set_vec3(command->reflection, handle, (const GLfloat*)v, command->count);
+        break;
+    }
+    case UNIFORM_VEC4:
+    {
+        uniform_vec4 handle = { command->index };
+        shader_set_vec4(command->reflection, handle, (const GLfloat*)v, command->count);
+        break;
+    }
+    case UNIFORM_MAT4:
+    {
+        uniform_mat4 handle = { command->index };
+        shader_set_mat4(command->reflection, handle, (const GLfloat*)v, command->count);
+        break;
+    }
+    }
+}
+
+void command_list_execute(const command_list* list, render_queue* queue)
+{
+    int dropped = 0;
+    for (size_t at = 0; at < list->used; )
+    {
+        const command_header* header = (const command_header*)&list->buffer[at];
+        at += header->size;
+
+        switch (header->type)
+        {
+        case COMMAND_USE_PROGRAM:
+            gl_state_use_program(((const command_bind*)header)->name);
+            break;
+        case COMMAND_BIND_VERTEX_ARRAY:
+            gl_state_bind_vertex_array(((const command_bind*)header)->name);
+            break;
+        case COMMAND_BIND_TEXTURE:
+        {
+            const command_bind_texture* command = (const command_bind_texture*)header;
+            gl_state_active_texture(GL_TEXTURE0 + command->unit);
+            gl_state_bind_texture(command->target, command->texture);
+            break;
+        }
+        case COMMAND_POLYGON_MODE:
+            gl_state_polygon_mode(GL_FRONT_AND_BACK, ((const command_polygon_mode*)header)->mode);
+            break;
+        case COMMAND_UNIFORM:
+            replay_uniform((const command_uniform*)header);
+            break;
+        case COMMAND_DRAW_ELEMENTS:
+        {
+            const command_draw* command = (const command_draw*)header;
+            glDrawElements(command->primitive, command->count, command->index_type, (const void*)command->offset);
+            break;
+        }
+        case COMMAND_DRAW_ARRAYS:
+        {
+            const command_draw* command = (const command_draw*)header;
+            glDrawArrays(command->primitive, command->first, command->count);
+            break;
+        }
+        case COMMAND_PACKET:
+        {
+            const command_packet* command = (const command_packet*)header;
+            if (!queue)
+            {
+                dropped++;
+                break;
+            }
+            render_queue_submit(queue, render_queue_key(queue, command->pass, command->packet, command->depth), command->packet);
+            break;
+        }
+        }
+    }
+
+    if (dropped)
+        printf("command list: %d render packets replayed without a render queue, dropped\n", dropped);
+}
+
+void command_lists_execute(command_list* const* lists, int list_count, render_queue* queue)
+{
+    for (int i = 0; i < list_count; i++)
+        command_list_execute(lists[i], queue);
+}
@@ -0,0 +1,83 @@
+/*
+    command lists: record anywhere, replay on the GL thread
+    ----------------------------
+    only the thread that owns the context can call GL, but deciding what
+    to call (walking the scene, culling, picking programs, filling in
+    uniforms) needs no context. a command_list is a linear buffer of small
+    POD commands (binds, uniform sets, draws, render packets) that any one
+    thread fills without locks or GL; the render thread replays it later.
+
+    give each worker its own list. command_lists_record() splits a range
+    of items into one band per list and records the bands across a
+    job_pool. command_lists_execute() replays the lists in array order,
+    so the GL calls come out the same however the bands were scheduled.
+
+    binds go through the GL state cache and uniform sets through their
+    reflection's shadow, as if they had been made on the render thread.
+    render packets go into a render_queue instead, and draw when it does.
+    pointers a list holds (reflections, a packet's user) have to stay
+    valid until it has been replayed.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "myCore/job_pool.h"
+#include "myOpenGL/render_queue.h"
+#include "myOpenGL/shader_reflect.h"
+
+struct command_list;
+
+/* capacity is a first guess in bytes, the buffer grows past it (and keeps what it grew to) */
+command_list* command_list_create(size_t capacity);
+void command_list_destroy(command_list* list);
+
+/* empties the list for recording again, keeping its memory */
+void command_list_reset(command_list* list);
+
+int command_list_count(const command_list* list);
+size_t command_list_bytes(const command_list* list);
+
+/* of the recorded bytes: lists with equal hashes (and sizes) replay the same calls */
+uint64_t command_list_hash(const command_list* list);
+
+/* recording: any thread, one thread per list at a time */
+void command_list_use_program(command_list* list, GLuint program);
+void command_list_bind_vertex_array(command_list* list, GLuint vao);
+void command_list_bind_texture(command_list* list, GLuint unit, GLenum target, GLuint texture);
+void command_list_polygon_mode(command_list* list, GLenum mode);     // GL_FRONT_AND_BACK
+
+/* the values are copied; an inactive handle records nothing */
+void command_list_set_int(command_list* list, shader_reflection* reflection, uniform_int handle, const GLint* v, int count = 1);
+void command_list_set_int(command_list* list, shader_reflection* reflection, uniform_int handle, GLint v);
+void command_list_set_float(command_list* list, shader_reflection* reflection, uniform_float handle, const GLfloat* v, int count = 1);
+void command_list_set_float(command_list* list, shader_reflection* reflection, uniform_float handle, GLfloat v);
+void command_list_set_vec2(command_list* list, shader_reflection* reflection, uniform_vec2 handle, const GLfloat* v, int count = 1);
+void command_list_set_vec3(command_list* list, shader_reflection* reflection, uniform_vec3 handle, const GLfloat* v, int count = 1);
+void command_list_set_vec4(command_list* list, shader_reflection* reflection, uniform_vec4 handle, const GLfloat* v, int count = 1);
+void command_list_set_mat4(command_list* list, shader_reflection* reflection, uniform_mat4 handle, const GLfloat* v, int count = 1);
+
+void command_list_draw_elements(command_list* list, GLenum primitive, GLsizei count, GLenum index_type, uintptr_t offset);
+void command_list_draw_arrays(command_list* list, GLenum primitive, GLint first, GLsizei count);
+
+/* on replay, render_queue_submit with render_queue_key(queue, pass, packet, depth): keys are numbered on the render thread */
+void command_list_submit(command_list* list, int pass, const render_packet& packet, float depth);
+
+/* records [begin, end) of a range into list */
+typedef void (*command_record_func)(void* user, command_list* list, int begin, int end);
+
+/*
+    resets every list and fills them in parallel, band i of [0, item_count)
+    into lists[i]; returns once all are recorded. pool may be NULL to record
+    them in turn on the calling thread.
+*/
+void command_lists_record(job_pool* pool, command_list* const* lists, int list_count, int item_count,
+                          command_record_func func, void* user);
+
+/* render thread: replays the lists in order (packets into queue, dropped with a message if it's NULL) */
+void command_list_execute(const command_list* list, render_queue* queue = NULL);
+void command_lists_execute(command_list* const* lists, int list_count, render_queue* queue = NULL);
@@ -0,0 +1,353 @@
+/*
+    GL state cache
+    ----------------------------
+    UNKNOWN never matches a real name or enum (GL hands out neither), so a
+    forgotten shadow makes the next call go through whatever it sets.
+    per-unit textures are a fixed table; units past it, and targets not in
+    it, are never filtered.
+*/
+
+#include "myOpenGL/gl_state.h"
+
+#include <string.h>
+
+#define UNKNOWN 0xFFFFFFFFu
+#define MAX_UNITS 32
+
+enum texture_target
+{
+    TARGET_2D,
+    TARGET_2D_ARRAY,
+    TARGET_CUBE_MAP,
+    TARGET_3D,
+    TARGET_COUNT
+};
+
+enum tracked_cap
+{
+    CAP_BLEND,
+    CAP_DEPTH_TEST,
+    CAP_CULL_FACE,
+    CAP_COUNT
+};
+
+static struct
+{
+    gl_state_gl gl;
+
+    GLuint program;
+    GLuint vao;
+    GLuint array_buffer;
+    GLuint element_buffer;          // the bound vertex array's
+    GLuint uniform_buffer;
+
+    GLenum active_texture;
+    GLuint textures[MAX_UNITS][TARGET_COUNT];
+
+    GLenum polygon_front;
+    GLenum polygon_back;
+    bool viewport_known;
+    GLint viewport[4];
+    GLenum caps[CAP_COUNT];         // GL_TRUE, GL_FALSE or UNKNOWN
+    GLenum blend_source;
+    GLenum blend_destination;
+    GLenum depth_func;
+    GLenum depth_mask;
+
+    int issued;
+    int filtered;
+    int frame_issued;               // so far this frame
+    int frame_filtered;
+    int last_frame_issued;
+    int last_frame_filtered;
+} g_state;
+
+void gl_state_init(const gl_state_gl* gl)
+{
+    memset(&g_state, 0, sizeof(g_state));
+
+    if (gl)
+        g_state.gl = *gl;
+    else
+    {
+        g_state.gl.use_program = glUseProgram;
+        g_state.gl.bind_vertex_array = glBindVertexArray;
+        g_state.gl.delete_vertex_arrays = glDeleteVertexArrays;
+        g_state.gl.bind_buffer = glBindBuffer;
+        g_state.gl.delete_buffers = glDeleteBuffers;
+        g_state.gl.active_texture = glActiveTexture;
+        g_state.gl.bind_texture = glBindTexture;
+        g_state.gl.delete_textures = glDeleteTextures;
+        g_state.gl.polygon_mode = glPolygonMode;
+        g_state.gl.viewport = glViewport;
+        g_state.gl.enable = glEnable;
+        g_state.gl.disable = glDisable;
+        g_state.gl.blend_func = glBlendFunc;
+        g_state.gl.depth_func = glDepthFunc;
+        g_state.gl.depth_mask = glDepthMask;
+    }
+
+    gl_state_invalidate();
+}
+
+void gl_state_invalidate()
+{
+    g_state.program = UNKNOWN;
+    g_state.vao = UNKNOWN;
+    g_state.array_buffer = UNKNOWN;
+    g_state.element_buffer = UNKNOWN;
+    g_state.uniform_buffer = UNKNOWN;
+
+    g_state.active_texture = UNKNOWN;
+    for (int unit = 0; unit < MAX_UNITS; unit++)
+        for (int target = 0; target < TARGET_COUNT; target++)
+            g_state.textures[unit][target] = UNKNOWN;
+
+    g_state.polygon_front = UNKNOWN;
+    g_state.polygon_back = UNKNOWN;
+    g_state.viewport_known = false;
+    for (int cap = 0; cap < CAP_COUNT; cap++)
+        g_state.caps[cap] = UNKNOWN;
+    g_state.blend_source = UNKNOWN;
+    g_state.blend_destination = UNKNOWN;
+    g_state.depth_func = UNKNOWN;
+    g_state.depth_mask = UNKNOWN;
+}
+
+/* counts the call, true if it has to be issued (and the shadow then takes the new value) */
+static bool changes(GLuint* shadow, GLuint value)
+{
+    if (*shadow == value)
+    {
+        g_state.filtered++;
+        g_state.frame_filtered++;
+        return false;
+    }
+
+    *shadow = value;
+    g_state.issued++;
+    g_state.frame_issued++;
+    return true;
+}
+
+/* an untracked call: always issued, still counted */
+static void passes()
+{
+    g_state.issued++;
+    g_state.frame_issued++;
+}
+
+void gl_state_use_program(GLuint program)
+{
+    if (changes(&g_state.program, program))
+        g_state.gl.use_program(program);
+}
+
+void gl_state_bind_vertex_array(GLuint vao)
+{
+    if (changes(&g_state.vao, vao))
+    {
+        g_state.gl.bind_vertex_array(vao);
+        g_state.element_buffer = UNKNOWN;
+    }
+}
+
+static GLuint* buffer_shadow(GLenum target)
+{
+    switch (target)
+    {
+    case GL_ARRAY_BUFFER:           return &g_state.array_buffer;
+    case GL_ELEMENT_ARRAY_BUFFER:   return &g_state.element_buffer;
+    case GL_UNIFORM_BUFFER:         return &g_state.uniform_buffer;
+    default:                        return NULL;
+    }
+}
+
+void gl_state_bind_buffer(GLenum target, GLuint buffer)
+{
+    GLuint* shadow = buffer_shadow(target);
+    if (!shadow)
+        passes();
+    else if (!changes(shadow, buffer))
+        return;
+
+    g_state.gl.bind_buffer(target, buffer);
+}
+
+void gl_state_active_texture(GLenum texture)
+{
+    if (changes(&g_state.active_texture, texture))
+        g_state.gl.active_texture(texture);
+}
+
+static GLuint* texture_shadow(GLenum target)
+{
+    GLuint unit = g_state.active_texture - GL_TEXTURE0;
+    if (g_state.active_texture == UNKNOWN || unit >= MAX_UNITS)
+        return NULL;
+
+    switch (target)
+    {
+    case GL_TEXTURE_2D:             return &g_state.textures[unit][TARGET_2D];
+    case GL_TEXTURE_2D_ARRAY:       return &g_state.textures[unit][TARGET_2D_ARRAY];
+    case GL_TEXTURE_CUBE_MAP:       return &g_state.textures[unit][TARGET_CUBE_MAP];
+    case GL_TEXTURE_3D:             return &g_state.textures[unit][TARGET_3D];
+    default:                        return NULL;
+    }
+}
+
+void gl_state_bind_texture(GLenum target, GLuint texture)
+{
+    GLuint* shadow = texture_shadow(target);
+    if (!shadow)
+        passes();
+    else if (!changes(shadow, texture))
+        return;
+
+    g_state.gl.bind_texture(target, texture);
+}
+
+void gl_state_polygon_mode(GLenum face, GLenum mode)
+{
+    bool front = face == GL_FRONT || face == GL_FRONT_AND_BACK;
+    bool back = face == GL_BACK || face == GL_FRONT_AND_BACK;
+    if (!front && !back)
+    {
+        passes();
+        g_state.gl.polygon_mode(face, mode);
+        return;
+    }
+
+    if ((!front || g_state.polygon_front == mode) && (!back || g_state.polygon_back == mode))
+    {
+        g_state.filtered++;
+        g_state.frame_filtered++;
+        return;
+    }
+
+    if (front)
+        g_state.polygon_front = mode;
+    if (back)
+        g_state.polygon_back = mode;
+    passes();
+    g_state.gl.polygon_mode(face, mode);
+}
+
+void gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    GLint viewport[4] = { x, y, width, height };
+    if (g_state.viewport_known && memcmp(viewport, g_state.viewport, sizeof(viewport)) == 0)
+    {
+        g_state.filtered++;
+        g_state.frame_filtered++;
+        return;
+    }
+
+    memcpy(g_state.viewport, viewport, sizeof(viewport));
+    g_state.viewport_known = true;
+    passes();
+    g_state.gl.viewport(x, y, width, height);
+}
+
+void gl_state_enable(GLenum cap, bool enabled)
+{
+    int tracked = cap == GL_BLEND ? CAP_BLEND : cap == GL_DEPTH_TEST ? CAP_DEPTH_TEST : cap == GL_CULL_FACE ? CAP_CULL_FACE : -1;
+    if (tracked < 0)
+        passes();
+    else if (!changes(&g_state.caps[tracked], enabled ? GL_TRUE : GL_FALSE))
+        return;
+
+    if (enabled)
+        g_state.gl.enable(cap);
+    else
+        g_state.gl.disable(cap);
+}
+
+void gl_state_blend_func(GLenum source, GLenum destination)
+{
+    if (g_state.blend_source == source && g_state.blend_destination == destination)
+    {
+        g_state.filtered++;
+        g_state.frame_filtered++;
+        return;
+    }
+
+    g_state.blend_source = source;
+    g_state.blend_destination = destination;
+    passes();
+    g_state.gl.blend_func(source, destination);
+}
+
+void gl_state_depth_func(GLenum func)
+{
+    if (changes(&g_state.depth_func, func))
+        g_state.gl.depth_func(func);
+}
+
+void gl_state_depth_mask(GLboolean write)
+{
+    if (changes(&g_state.depth_mask, write ? GL_TRUE : GL_FALSE))
+        g_state.gl.depth_mask(write);
+}
+
+/* GL binds 0 wherever a deleted name was bound */
+static void unbind(GLuint* shadow, GLuint name)
+{
+    if (*shadow == name)
+        *shadow = 0;
+}
+
+void gl_state_delete_textures(GLsizei count, const GLuint* textures)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (!textures[i])
+            continue;
+        for (int unit = 0; unit < MAX_UNITS; unit++)
+            for (int target = 0; target < TARGET_COUNT; target++)
+                unbind(&g_state.textures[unit][target], textures[i]);
+    }
+    g_state.gl.delete_textures(count, textures);
+}
+
+void gl_state_delete_buffers(GLsizei count, const GLuint* buffers)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (!buffers[i])
+            continue;
+        unbind(&g_state.array_buffer, buffers[i]);
+        unbind(&g_state.element_buffer, buffers[i]);
+        unbind(&g_state.uniform_buffer, buffers[i]);
+    }
+    g_state.gl.delete_buffers(count, buffers);
+}
+
+void gl_state_delete_vertex_arrays(GLsizei count, const GLuint* arrays)
+{
+    for (GLsizei i = 0; i < count; i++)
+    {
+        if (arrays[i] && g_state.vao == arrays[i])
+        {
+            g_state.vao = 0;
+            g_state.element_buffer = UNKNOWN;
+        }
+    }
+    g_state.gl.delete_vertex_arrays(count, arrays);
+}
+
+void gl_state_end_frame()
+{
+    g_state.last_frame_issued = g_state.frame_issued;
+    g_state.last_frame_filtered = g_state.frame_filtered;
+    g_state.frame_issued = 0;
+    g_state.frame_filtered = 0;
+}
+
+void gl_state_get_stats(gl_state_stats* stats)
+{
+    stats->issued = g_state.issued;
+    stats->filtered = g_state.filtered;
+    stats->frame_issued = g_state.last_frame_issued;
+    stats->frame_filtered = g_state.last_frame_filtered;
+}
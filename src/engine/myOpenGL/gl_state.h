@@ -0,0 +1,108 @@
+/*
+    GL state cache
+    ----------------------------
+    a shadow of the binding and render state the frame loop keeps setting:
+    program, vertex array, array / element / uniform buffers, the texture
+    bound to each target of each unit, the active unit, polygon mode,
+    viewport, blend and depth state. a call that would set what the shadow
+    already holds never reaches the driver.
+
+    the shadow starts out unknown, so the first call of each kind is always
+    issued. anything that changes state behind the cache's back (a plain
+    gl* call, a context loss, a library that binds its own things) has to
+    be followed by gl_state_invalidate, or the cache will skip a call that
+    was needed. GL_PIXEL_UNPACK_BUFFER is the upload ring's, so buffer
+    targets other than the three tracked ones are passed straight through.
+
+    deleting through the cache matters as much as binding through it: GL
+    unbinds a deleted name, and a later glGen* can hand the same name back.
+
+    every GL call goes through a gl_state_gl table: pass NULL to use the
+    real entry points, or a recording stub to check the filtering without
+    a GPU.
+*/
+#pragma once
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+/* GLEW declares the GL 1.1 entry points as functions, without pointer types for them */
+typedef void (GLAPIENTRY *gl_state_bind_texture_proc)(GLenum target, GLuint texture);
+typedef void (GLAPIENTRY *gl_state_delete_textures_proc)(GLsizei n, const GLuint* textures);
+typedef void (GLAPIENTRY *gl_state_polygon_mode_proc)(GLenum face, GLenum mode);
+typedef void (GLAPIENTRY *gl_state_viewport_proc)(GLint x, GLint y, GLsizei width, GLsizei height);
+typedef void (GLAPIENTRY *gl_state_cap_proc)(GLenum cap);
+typedef void (GLAPIENTRY *gl_state_blend_func_proc)(GLenum sfactor, GLenum dfactor);
+typedef void (GLAPIENTRY *gl_state_depth_func_proc)(GLenum func);
+typedef void (GLAPIENTRY *gl_state_depth_mask_proc)(GLboolean flag);
+
+struct gl_state_gl
+{
+    PFNGLUSEPROGRAMPROC use_program;
+    PFNGLBINDVERTEXARRAYPROC bind_vertex_array;
+    PFNGLDELETEVERTEXARRAYSPROC delete_vertex_arrays;
+    PFNGLBINDBUFFERPROC bind_buffer;
+    PFNGLDELETEBUFFERSPROC delete_buffers;
+    PFNGLACTIVETEXTUREPROC active_texture;
+    gl_state_bind_texture_proc bind_texture;
+    gl_state_delete_textures_proc delete_textures;
+    gl_state_polygon_mode_proc polygon_mode;
+    gl_state_viewport_proc viewport;
+    gl_state_cap_proc enable;
+    gl_state_cap_proc disable;
+    gl_state_blend_func_proc blend_func;
+    gl_state_depth_func_proc depth_func;
+    gl_state_depth_mask_proc depth_mask;
+};
+
+struct gl_state_stats
+{
+    int issued;             // calls that reached GL
+    int filtered;           // calls dropped because the shadow already matched
+
+    /* the same, for the last frame only (set by every gl_state_end_frame) */
+    int frame_issued;
+    int frame_filtered;
+};
+
+/* main thread, after glewInit (or with a stub table, without one) */
+void gl_state_init(const gl_state_gl* gl = NULL);
+
+/* forget the shadow: the next call of every kind is issued */
+void gl_state_invalidate();
+
+void gl_state_use_program(GLuint program);
+
+/* a vertex array carries its own element buffer, so binding one forgets that shadow */
+void gl_state_bind_vertex_array(GLuint vao);
+
+/* GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER and GL_UNIFORM_BUFFER are tracked, other targets always issued */
+void gl_state_bind_buffer(GLenum target, GLuint buffer);
+
+/* GL_TEXTURE0 + unit, as glActiveTexture */
+void gl_state_active_texture(GLenum texture);
+
+/* on the active unit; 2D, 2D array, cube map and 3D targets of the first 32 units are tracked */
+void gl_state_bind_texture(GLenum target, GLuint texture);
+
+/* GL_FRONT, GL_BACK or GL_FRONT_AND_BACK */
+void gl_state_polygon_mode(GLenum face, GLenum mode);
+
+void gl_state_viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+/* glEnable / glDisable: GL_BLEND, GL_DEPTH_TEST and GL_CULL_FACE are tracked, other caps always issued */
+void gl_state_enable(GLenum cap, bool enabled);
+
+void gl_state_blend_func(GLenum source, GLenum destination);
+void gl_state_depth_func(GLenum func);
+void gl_state_depth_mask(GLboolean write);
+
+/* delete, and drop the names from the shadow wherever they were bound */
+void gl_state_delete_textures(GLsizei count, const GLuint* textures);
+void gl_state_delete_buffers(GLsizei count, const GLuint* buffers);
+void gl_state_delete_vertex_arrays(GLsizei count, const GLuint* arrays);
+
+/* once a frame, after its last draw: what the frame issued and filtered becomes the frame_ counters */
+void gl_state_end_frame();
+
+void gl_state_get_stats(gl_state_stats* stats);
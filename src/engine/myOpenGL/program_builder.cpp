@@ -0,0 +1,235 @@
+/*
+    non-blocking shader program builds
+    ----------------------------
+    every program the builder made has a state, until it is forgotten; the
+    ones still going also sit in a pending list with their shaders (kept
+    until the link has been checked, their logs are what tells a compile
+    error from a link error).
+
+    GLEW 2.0 knows the ARB spelling of the extension but not the KHR one, so
+    the KHR entry point comes from SDL. both share the token, behaviour and
+    signature.
+*/
+
+#include "myOpenGL/program_builder.h"
+#include "myOpenGL/program_cache.h"
+
+#include <stdio.h>
+#include <unordered_map>
+#include <vector>
+
+#include "SDL.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+enum build_state
+{
+    BUILD_PENDING,
+    BUILD_READY,
+    BUILD_FAILED
+};
+
+struct pending_build
+{
+    GLuint program;
+    GLuint vertex_shader;
+    GLuint fragment_shader;
+    uint64_t cache_key;
+};
+
+static struct
+{
+    bool parallel;
+    std::vector<pending_build> pending;
+    std::unordered_map<GLuint, build_state> states;
+} g_builder;
+
+void program_builder_init()
+{
+    PFNGLMAXSHADERCOMPILERTHREADSARBPROC max_threads = NULL;
+    if (SDL_GL_ExtensionSupported("GL_KHR_parallel_shader_compile"))
+        max_threads = (PFNGLMAXSHADERCOMPILERTHREADSARBPROC)SDL_GL_GetProcAddress("glMaxShaderCompilerThreadsKHR");
+    else if (GLEW_ARB_parallel_shader_compile)
+        max_threads = (PFNGLMAXSHADERCOMPILERTHREADSARBPROC)glMaxShaderCompilerThreadsARB;
+
+    g_builder.parallel = max_threads != NULL;
+    if (max_threads)
+        max_threads(0xFFFFFFFF); // as many as the driver wants
+}
+
+bool program_builder_parallel()
+{
+    return g_builder.parallel;
+}
+
+static void print_shader_log(GLuint shader, const char* name)
+{
+    GLint success = GL_FALSE, log_length = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length > 1)
+    {
+        std::vector<GLchar> log(log_length);
+        glGetShaderInfoLog(shader, log_length, NULL, &log[0]);
+        printf("%s log:\n\n%s\n", name, &log[0]);
+    }
+    if (!success)
+        printf("%s error\n", name);
+}
+
+static void print_program_log(GLuint program)
+{
+    GLint log_length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &log_length);
+    if (log_length > 1)
+    {
+        std::vector<GLchar> log(log_length);
+        glGetProgramInfoLog(program, log_length, NULL, &log[0]);
+        printf("shader program link log:\n\n%s\n", &log[0]);
+    }
+    printf("shader program link error\n");
+}
+
+GLuint program_build(const char* vertex_source, const char* fragment_source)
+{
+    /* linked on an earlier run: the driver takes its own binary back, no compile at all */
+    uint64_t cache_key = program_cache_key(vertex_source, fragment_source);
+    GLuint program = program_cache_load(cache_key);
+    if (program)
+    {
+        g_builder.states[program] = BUILD_READY;
+        return program;
+    }
+
+    pending_build build;
+    build.cache_key = cache_key;
+
+    build.vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(build.vertex_shader, 1, &vertex_source, NULL);
+    glCompileShader(build.vertex_shader);
+
+    build.fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(build.fragment_shader, 1, &fragment_source, NULL);
+    glCompileShader(build.fragment_shader);
+
+    /* no need to wait for the compiles: the link waits for them, on the driver's side */
+    build.program = glCreateProgram();
+    glAttachShader(build.program, build.vertex_shader);
+    glAttachShader(build.program, build.fragment_shader);
+    program_cache_prepare(build.program);
+    glLinkProgram(build.program);
+
+    g_builder.pending.push_back(build);
+    g_builder.states[build.program] = BUILD_PENDING;
+    return build.program;
+}
+
+/* the link status (waiting for it if need be), logs on failure, then the shaders go */
+static void finish(const pending_build& build)
+{
+    GLint linked = GL_FALSE;
+    glGetProgramiv(build.program, GL_LINK_STATUS, &linked);
+    if (linked)
+        program_cache_store(build.program, build.cache_key);
+    else
+    {
+        print_shader_log(build.vertex_shader, "vertex shader compile");
+        print_shader_log(build.fragment_shader, "fragment shader compile");
+        print_program_log(build.program);
+    }
+
+    glDetachShader(build.program, build.vertex_shader);
+    glDetachShader(build.program, build.fragment_shader);
+    glDeleteShader(build.vertex_shader);
+    glDeleteShader(build.fragment_shader);
+
+    g_builder.states[build.program] = linked ? BUILD_READY : BUILD_FAILED;
+}
+
+int program_builder_pump()
+{
+    int finished = 0;
+    for (size_t i = 0; i < g_builder.pending.size(); )
+    {
+        GLint done = GL_TRUE;
+        if (g_builder.parallel)
+            glGetProgramiv(g_builder.pending[i].program, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done)
+        {
+            i++;
+            continue;
+        }
+
+        finish(g_builder.pending[i]);
+        g_builder.pending.erase(g_builder.pending.begin() + i);
+        finished++;
+    }
+    return finished;
+}
+
+bool program_builder_wait(GLuint program)
+{
+    for (size_t i = 0; i < g_builder.pending.size(); i++)
+    {
+        if (g_builder.pending[i].program == program)
+        {
+            finish(g_builder.pending[i]);
+            g_builder.pending.erase(g_builder.pending.begin() + i);
+            break;
+        }
+    }
+    return program_ready(program);
+}
+
+GLuint program_build_now(const char* vertex_source, const char* fragment_source)
+{
+    GLuint program = program_build(vertex_source, fragment_source);
+    if (program_builder_wait(program))
+        return program;
+
+    glDeleteProgram(program);
+    program_builder_forget(program);
+    return 0;
+}
+
+void program_builder_forget(GLuint program)
+{
+    for (size_t i = 0; i < g_builder.pending.size(); i++)
+    {
+        if (g_builder.pending[i].program == program)
+        {
+            glDeleteShader(g_builder.pending[i].vertex_shader);
+            glDeleteShader(g_builder.pending[i].fragment_shader);
+            g_builder.pending.erase(g_builder.pending.begin() + i);
+            break;
+        }
+    }
+    g_builder.states.erase(program);
+}
+
+bool program_ready(GLuint program)
+{
+    std::unordered_map<GLuint, build_state>::const_iterator it = g_builder.states.find(program);
+    return it != g_builder.states.end() && it->second == BUILD_READY;
+}
+
+bool program_failed(GLuint program)
+{
+    std::unordered_map<GLuint, build_state>::const_iterator it = g_builder.states.find(program);
+    return it != g_builder.states.end() && it->second == BUILD_FAILED;
+}
+
+int program_build_status(GLuint program)
+{
+    std::unordered_map<GLuint, build_state>::const_iterator it = g_builder.states.find(program);
+    if (it == g_builder.states.end())
+        return -1;
+    return it->second == BUILD_READY ? 1 : it->second == BUILD_PENDING ? 0 : -1;
+}
+
+bool program_builder_busy()
+{
+    return !g_builder.pending.empty();
+}
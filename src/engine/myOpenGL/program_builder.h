@@ -0,0 +1,56 @@
+/*
+    non-blocking shader program builds
+    ----------------------------
+    program_build() issues both compiles and the link and returns the
+    program's name straight away, without asking GL how any of it went:
+    every status query waits for the compiler, so asking right after each
+    call serializes the driver's work with ours. builds are checked from
+    the frame loop instead, by program_builder_pump().
+
+    with GL_KHR_parallel_shader_compile (or the ARB version) the driver
+    compiles on its own threads and GL_COMPLETION_STATUS_KHR tells the pump
+    which programs are done without waiting on any. without it, the pump
+    waits on each build in turn, but only once everything has been issued.
+
+    until a program is ready, draw with something cheap in its place (a
+    program built with program_build_now, say). info logs are only read for
+    builds that failed. hits in the program cache (myOpenGL/program_cache.h)
+    are ready at once.
+*/
+#pragma once
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+/* after glewInit: hands the driver as many compile threads as it likes, if it takes them */
+void program_builder_init();
+
+/* a program name, usable right away; check program_ready before drawing with it */
+GLuint program_build(const char* vertex_source, const char* fragment_source);
+
+/* program_build, then program_builder_wait: returns 0 if it failed */
+GLuint program_build_now(const char* vertex_source, const char* fragment_source);
+
+/* once a frame: checks the builds still going, returns how many finished */
+int program_builder_pump();
+
+/* waits for one build to finish (no-op if it has); true if it linked */
+bool program_builder_wait(GLuint program);
+
+/* linked and done: fine to draw with, and to reflect */
+bool program_ready(GLuint program);
+
+/* finished but failed to compile or link (the logs have been printed) */
+bool program_failed(GLuint program);
+
+/* 1 linked, 0 still building, -1 failed (or not one of the builder's): a shader_status_func */
+int program_build_status(GLuint program);
+
+/* drops what the builder knows of a program (and a build still going), once it has been deleted: a shader_forget_func */
+void program_builder_forget(GLuint program);
+
+/* true while builds are in flight */
+bool program_builder_busy();
+
+/* the driver compiles on its own threads */
+bool program_builder_parallel();
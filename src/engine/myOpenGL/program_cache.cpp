@@ -0,0 +1,183 @@
+/*
+    on-disk cache of linked shader programs
+    ----------------------------
+    one file per program, named after its key: a fixed header (which
+    repeats the key, so a renamed or truncated file can't pass) followed by
+    the driver's binary. written to a temporary name and renamed, like the
+    texture cache, so a reader never sees half a file.
+*/
+
+#include "myOpenGL/program_cache.h"
+#include "myCore/file_map.h"
+#include "myCore/hash.h"
+#include "myCore/root_path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+/* bump when the header changes, old files then just miss */
+#define PROGRAM_CACHE_VERSION 1
+
+struct program_cache_header
+{
+    char magic[4];          // "GAPB"
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;        // the GLenum glGetProgramBinary returned
+    uint32_t size;          // bytes of binary after the header
+};
+
+static std::string g_cache_dir;     // full path with a trailing '/', empty when off
+static uint64_t g_driver_hash;      // vendor, renderer and version strings
+
+static uint64_t hash_string(const GLubyte* text, uint64_t seed)
+{
+    const char* s = text ? (const char*)text : "";
+    return hash64(s, strlen(s), seed);
+}
+
+void program_cache_init(const char* dir)
+{
+    g_cache_dir.clear();
+    if (!dir || !dir[0])
+        return;
+
+    GLint formats = 0;
+    if (GLEW_ARB_get_program_binary)
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0)
+    {
+        printf("program cache: the driver offers no program binary formats, shaders always compile\n");
+        return;
+    }
+
+    g_driver_hash = hash_string(glGetString(GL_VENDOR), 0);
+    g_driver_hash = hash_string(glGetString(GL_RENDERER), g_driver_hash);
+    g_driver_hash = hash_string(glGetString(GL_VERSION), g_driver_hash);
+
+    g_cache_dir = root_path_make_directory(dir);
+}
+
+bool program_cache_enabled()
+{
+    return !g_cache_dir.empty();
+}
+
+uint64_t program_cache_key(const char* vertex_source, const char* fragment_source)
+{
+    uint64_t key = hash64(vertex_source, strlen(vertex_source), g_driver_hash);
+    return hash64(fragment_source, strlen(fragment_source), key);
+}
+
+static std::string cache_file(uint64_t key)
+{
+    char name[32];
+    sprintf(name, "%016llx.bin", (unsigned long long)key);
+    return g_cache_dir + name;
+}
+
+GLuint program_cache_load(uint64_t key)
+{
+    if (g_cache_dir.empty())
+        return 0;
+
+    std::string name = cache_file(key);
+    file_map map;
+    if (!file_map_open(name.c_str(), &map))
+        return 0;
+
+    program_cache_header header;
+    bool ok = map.size >= sizeof(header);
+    if (ok)
+    {
+        memcpy(&header, map.data, sizeof(header));
+        ok = memcmp(header.magic, "GAPB", 4) == 0
+            && header.version == PROGRAM_CACHE_VERSION
+            && header.key == key
+            && header.size == map.size - sizeof(header);
+    }
+
+    GLuint program = 0;
+    if (ok)
+    {
+        program = glCreateProgram();
+        glProgramBinary(program, header.format, map.data + sizeof(header), header.size);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    file_map_close(&map);
+
+    /* stale or refused: the source compile that follows writes a fresh one */
+    if (!program)
+    {
+        printf("program cache: %s is stale, compiling from source\n", name.c_str());
+        remove(name.c_str());
+    }
+    return program;
+}
+
+void program_cache_prepare(GLuint program)
+{
+    if (!g_cache_dir.empty())
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool program_cache_store(GLuint program, uint64_t key)
+{
+    if (g_cache_dir.empty())
+        return false;
+
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return false;
+
+    std::vector<uint8_t> binary(length);
+    GLenum format = 0;
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, &binary[0]);
+    if (written <= 0)
+        return false;
+
+    program_cache_header header;
+    memcpy(header.magic, "GAPB", 4);
+    header.version = PROGRAM_CACHE_VERSION;
+    header.key = key;
+    header.format = format;
+    header.size = (uint32_t)written;
+
+    std::string final_name = cache_file(key);
+    std::string temp_name = final_name + ".tmp";
+
+    FILE* f = fopen(temp_name.c_str(), "wb");
+    if (!f)
+        return false;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+        && fwrite(&binary[0], 1, written, f) == (size_t)written;
+    ok = fclose(f) == 0 && ok;
+
+    if (!ok)
+    {
+        remove(temp_name.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    remove(final_name.c_str()); // rename won't replace on windows
+#endif
+    if (rename(temp_name.c_str(), final_name.c_str()) != 0)
+    {
+        remove(temp_name.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,38 @@
+/*
+    on-disk cache of linked shader programs
+    ----------------------------
+    a program linked from source is saved with glGetProgramBinary, and the
+    next run hands the same bytes to glProgramBinary instead of compiling.
+    entries are keyed by a hash of the vertex and fragment sources and the
+    driver's vendor / renderer / version strings, so an edited shader or a
+    driver update simply misses.
+
+    a driver may still reject a binary it wrote itself (after an update that
+    kept its version string, say): load then deletes the file and returns 0,
+    and the caller compiles from source as if the cache were empty.
+
+    needs a current GL context. without GL_ARB_get_program_binary (or with no
+    binary formats offered) the cache stays off and every call is a miss.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+/* dir is relative to the executable and created if missing; NULL turns the cache off */
+void program_cache_init(const char* dir);
+bool program_cache_enabled();
+
+/* what identifies a program's binary: both sources and the driver */
+uint64_t program_cache_key(const char* vertex_source, const char* fragment_source);
+
+/* a linked program, or 0 on a miss (or a binary the driver refused) */
+GLuint program_cache_load(uint64_t key);
+
+/* before glLinkProgram: asks the driver to keep the binary retrievable */
+void program_cache_prepare(GLuint program);
+
+/* after a successful link */
+bool program_cache_store(GLuint program, uint64_t key);
@@ -0,0 +1,289 @@
+/*
+    sort-keyed render queue
+    ----------------------------
+    the sort is an LSD radix sort over (key, packet index) pairs, a byte per
+    pass: stable, so equal keys keep their submission order, and linear in
+    the packet count. all eight histograms come out of one read of the keys,
+    and a byte every key shares (the pass, usually, and the high bytes of
+    ids in a small scene) is skipped. arrays are kept between frames, so a
+    steady scene sorts without allocating.
+*/
+
+#include "myOpenGL/render_queue.h"
+#include "myOpenGL/gl_state.h"
+#include "myCore/hash.h"
+
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+#define PASS_BITS 4
+#define PROGRAM_BITS 16
+#define TEXTURE_BITS 16
+#define VAO_BITS 12
+#define DEPTH_BITS 16
+
+#define DEPTH_SHIFT 0
+#define VAO_SHIFT (DEPTH_SHIFT + DEPTH_BITS)
+#define TEXTURE_SHIFT (VAO_SHIFT + VAO_BITS)
+#define PROGRAM_SHIFT (TEXTURE_SHIFT + TEXTURE_BITS)
+#define PASS_SHIFT (PROGRAM_SHIFT + PROGRAM_BITS)
+
+struct render_queue
+{
+    std::vector<render_packet> packets;
+    std::vector<uint64_t> keys;
+
+    /* sort passes ping-pong between these, order ends up with the result */
+    std::vector<uint64_t> sort_keys[2];
+    std::vector<uint32_t> sort_order[2];
+    uint32_t histograms[8][256];
+    const uint32_t* order;
+    bool sorted;
+
+    /* what each program, texture set and vertex array is numbered in keys */
+    std::unordered_map<GLuint, uint32_t> program_ids;
+    std::unordered_map<uint64_t, uint32_t> texture_ids;
+    std::unordered_map<GLuint, uint32_t> vao_ids;
+
+    render_queue_stats stats;
+};
+
+render_queue* render_queue_create(int capacity)
+{
+    render_queue* queue = new render_queue;
+    if (capacity > 0)
+    {
+        queue->packets.reserve(capacity);
+        queue->keys.reserve(capacity);
+    }
+    queue->order = NULL;
+    queue->sorted = false;
+    memset(&queue->stats, 0, sizeof(queue->stats));
+    return queue;
+}
+
+void render_queue_destroy(render_queue* queue)
+{
+    delete queue;
+}
+
+/* numbered in order of first sight; a number past what the key holds wraps (and sorts less well, nothing worse) until trim */
+template <typename T>
+static uint64_t intern(std::unordered_map<T, uint32_t>& ids, T value, int bits)
+{
+    typename std::unordered_map<T, uint32_t>::iterator found = ids.find(value);
+    uint32_t id;
+    if (found != ids.end())
+        id = found->second;
+    else
+    {
+        id = (uint32_t)ids.size();
+        ids[value] = id;
+    }
+    return id & ((1u << bits) - 1);
+}
+
+/*
+    numbers stay put across frames, so a steady scene keys the same every
+    frame. once a map holds more than its field can tell apart, it starts
+    over: by then its numbers wrap anyway, and names deleted long ago would
+    otherwise sit in it forever. only from an empty queue, so no key still
+    in it refers to the old numbering.
+*/
+template <typename T>
+static void trim(std::unordered_map<T, uint32_t>& ids, int bits)
+{
+    if (ids.size() > ((size_t)1 << bits))
+        ids.clear();
+}
+
+uint64_t render_queue_key(render_queue* queue, int pass, const render_packet& packet, float depth)
+{
+    int texture_count = packet.texture_count < RENDER_MAX_TEXTURES ? packet.texture_count : RENDER_MAX_TEXTURES;
+    uint64_t texture_set = hash64(packet.textures, texture_count * sizeof(GLuint), (uint64_t)texture_count);
+
+    if (!(depth > 0.0f))    // NaN too
+        depth = 0.0f;
+    if (depth > 1.0f)
+        depth = 1.0f;
+
+    uint64_t key = (uint64_t)(pass & (RENDER_MAX_PASSES - 1)) << PASS_SHIFT;
+    key |= intern(queue->program_ids, packet.program, PROGRAM_BITS) << PROGRAM_SHIFT;
+    key |= intern(queue->texture_ids, texture_set, TEXTURE_BITS) << TEXTURE_SHIFT;
+    key |= intern(queue->vao_ids, packet.vao, VAO_BITS) << VAO_SHIFT;
+    key |= (uint64_t)(depth * ((1 << DEPTH_BITS) - 1) + 0.5f) << DEPTH_SHIFT;
+    return key;
+}
+
+void render_queue_submit(render_queue* queue, uint64_t key, const render_packet& packet)
+{
+    queue->packets.push_back(packet);
+    queue->keys.push_back(key);
+    queue->sorted = false;
+
+    render_packet& copy = queue->packets.back();
+    if (copy.texture_count > RENDER_MAX_TEXTURES)
+        copy.texture_count = RENDER_MAX_TEXTURES;
+}
+
+static void radix_sort(render_queue* queue)
+{
+    uint32_t count = (uint32_t)queue->keys.size();
+    for (int i = 0; i < 2; i++)
+    {
+        queue->sort_keys[i].resize(count);
+        queue->sort_order[i].resize(count);
+    }
+
+    uint64_t* keys = &queue->sort_keys[0][0];
+    uint32_t* order = &queue->sort_order[0][0];
+    uint64_t* other_keys = &queue->sort_keys[1][0];
+    uint32_t* other_order = &queue->sort_order[1][0];
+
+    uint32_t (*histograms)[256] = queue->histograms;
+    memset(queue->histograms, 0, sizeof(queue->histograms));
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t key = queue->keys[i];
+        keys[i] = key;
+        order[i] = i;
+        for (int digit = 0; digit < 8; digit++)
+            histograms[digit][(key >> (digit * 8)) & 0xFF]++;
+    }
+
+    for (int digit = 0; digit < 8; digit++)
+    {
+        uint32_t* histogram = histograms[digit];
+        int shift = digit * 8;
+        if (histogram[(keys[0] >> shift) & 0xFF] == count)
+            continue;
+
+        uint32_t offset = 0;
+        for (int b = 0; b < 256; b++)
+        {
+            uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+
+        for (uint32_t i = 0; i < count; i++)
+        {
+            uint32_t to = histogram[(keys[i] >> shift) & 0xFF]++;
+            other_keys[to] = keys[i];
+            other_order[to] = order[i];
+        }
+
+        uint64_t* swap_keys = keys;
+        keys = other_keys;
+        other_keys = swap_keys;
+        uint32_t* swap_order = order;
+        order = other_order;
+        other_order = swap_order;
+    }
+
+    queue->order = order;
+}
+
+/* what drawing the packets in this order switches; order NULL is submission order */
+static void count_changes(const render_queue* queue, const uint32_t* order, render_state_changes* changes)
+{
+    memset(changes, 0, sizeof(*changes));
+
+    const render_packet* previous = NULL;
+    GLuint textures[RENDER_MAX_TEXTURES];
+    bool textures_known[RENDER_MAX_TEXTURES] = {};
+
+    for (size_t i = 0; i < queue->packets.size(); i++)
+    {
+        const render_packet& packet = queue->packets[order ? order[i] : i];
+        if (!previous || packet.program != previous->program)
+            changes->programs++;
+        if (!previous || packet.vao != previous->vao)
+            changes->vaos++;
+
+        for (int unit = 0; unit < packet.texture_count; unit++)
+        {
+            if (textures_known[unit] && textures[unit] == packet.textures[unit])
+                continue;
+            textures[unit] = packet.textures[unit];
+            textures_known[unit] = true;
+            changes->textures++;
+        }
+        previous = &packet;
+    }
+}
+
+void render_queue_sort(render_queue* queue)
+{
+    if (queue->sorted)
+        return;
+
+    queue->order = NULL;
+    if (!queue->packets.empty())
+        radix_sort(queue);
+    queue->sorted = true;
+
+    queue->stats.packets = (int)queue->packets.size();
+    count_changes(queue, NULL, &queue->stats.submitted);
+    count_changes(queue, queue->order, &queue->stats.sorted);
+}
+
+static void draw(const render_packet& packet)
+{
+    gl_state_use_program(packet.program);
+    for (int unit = 0; unit < packet.texture_count; unit++)
+    {
+        gl_state_active_texture(GL_TEXTURE0 + unit);
+        gl_state_bind_texture(GL_TEXTURE_2D, packet.textures[unit]);
+    }
+    gl_state_bind_vertex_array(packet.vao);
+    if (packet.polygon_mode)
+        gl_state_polygon_mode(GL_FRONT_AND_BACK, packet.polygon_mode);
+
+    if (packet.uniforms)
+        packet.uniforms(packet.user);
+
+    if (packet.index_type)
+        glDrawElements(packet.primitive, packet.count, packet.index_type, (const void*)packet.offset);
+    else
+        glDrawArrays(packet.primitive, packet.first, packet.count);
+}
+
+static void add_changes(render_state_changes* total, const render_state_changes& frame)
+{
+    total->programs += frame.programs;
+    total->textures += frame.textures;
+    total->vaos += frame.vaos;
+}
+
+void render_queue_execute(render_queue* queue)
+{
+    render_queue_sort(queue);
+
+    for (size_t i = 0; i < queue->packets.size(); i++)
+        draw(queue->packets[queue->order[i]]);
+
+    queue->stats.total_packets += queue->stats.packets;
+    add_changes(&queue->stats.total_submitted, queue->stats.submitted);
+    add_changes(&queue->stats.total_sorted, queue->stats.sorted);
+
+    render_queue_clear(queue);
+}
+
+void render_queue_clear(render_queue* queue)
+{
+    queue->packets.clear();
+    queue->keys.clear();
+    queue->order = NULL;
+    queue->sorted = false;
+
+    trim(queue->program_ids, PROGRAM_BITS);
+    trim(queue->texture_ids, TEXTURE_BITS);
+    trim(queue->vao_ids, VAO_BITS);
+}
+
+void render_queue_get_stats(const render_queue* queue, render_queue_stats* stats)
+{
+    *stats = queue->stats;
+}
@@ -0,0 +1,102 @@
+/*
+    sort-keyed render queue
+    ----------------------------
+    systems submit draw packets instead of drawing; render_queue_execute()
+    sorts the frame's packets by a 64 bit key and draws them in that order,
+    so packets sharing a program, textures and vertex array end up next to
+    each other and the switches between them happen once per run instead
+    of once per packet.
+
+    the key, high bits first (so it sorts by them in this order):
+
+        pass      4 bits    opaque before transparent, overlays last...
+        program  16 bits
+        textures 16 bits    the packet's whole texture set
+        vao      12 bits
+        depth    16 bits    0 near, 1 far: front to back within a run
+
+    program, texture set and vertex array are numbered by the queue in the
+    order it first sees them (render_queue_key). the numbers only steer the
+    sort: two things sharing one (a texture set hash collision, or more
+    programs than 16 bits) still draw right, just with an extra switch.
+    numbers last across frames until more have been handed out than a field
+    holds; then the next clear (or execute) renumbers that field from 0, so
+    the maps stay bounded at the cost of one frame whose keys differ from
+    the last. for back to front (blending), pass 1 - depth.
+
+    binds go through the GL state cache (myOpenGL/gl_state.h), which drops
+    whatever the sorted order made redundant. main thread only.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#define RENDER_MAX_TEXTURES 4
+#define RENDER_MAX_PASSES 16
+
+/* set the packet's uniforms: called with its program bound, right before its draw */
+typedef void (*render_uniforms_func)(void* user);
+
+struct render_packet
+{
+    GLuint program;
+    GLuint vao;
+    GLuint textures[RENDER_MAX_TEXTURES];   // GL_TEXTURE_2D on unit i
+    int texture_count;                      // units from 0 the packet binds, the rest are left alone
+    GLenum polygon_mode;                    // GL_FILL, GL_LINE... 0 leaves it as it is
+
+    GLenum primitive;                       // GL_TRIANGLES...
+    GLsizei count;
+    GLenum index_type;                      // 0 for glDrawArrays
+    GLint first;                            // glDrawArrays: first vertex
+    uintptr_t offset;                       // glDrawElements: byte offset into the element buffer
+
+    render_uniforms_func uniforms;          // may be NULL
+    void* user;
+};
+
+/* program, texture and vertex array switches between consecutive packets (the first packet's count too) */
+struct render_state_changes
+{
+    int programs;
+    int textures;           // units whose texture changed
+    int vaos;
+};
+
+struct render_queue_stats
+{
+    int packets;                        // last frame
+    render_state_changes submitted;     // what drawing in submission order would have switched
+    render_state_changes sorted;        // what the sorted order switched
+
+    /* the same, over every frame */
+    int total_packets;
+    render_state_changes total_submitted;
+    render_state_changes total_sorted;
+};
+
+struct render_queue;
+
+/* capacity is a first guess at packets per frame, the queue grows past it */
+render_queue* render_queue_create(int capacity);
+void render_queue_destroy(render_queue* queue);
+
+/* a key for packet in pass (0 to RENDER_MAX_PASSES - 1), depth from 0 to 1 (clamped) */
+uint64_t render_queue_key(render_queue* queue, int pass, const render_packet& packet, float depth);
+
+/* the packet is copied; packets with equal keys draw in submission order */
+void render_queue_submit(render_queue* queue, uint64_t key, const render_packet& packet);
+
+/* sorts what was submitted and counts its state changes, without drawing (no GL calls) */
+void render_queue_sort(render_queue* queue);
+
+/* sorts (if render_queue_sort hasn't), draws everything and empties the queue */
+void render_queue_execute(render_queue* queue);
+
+/* drops the packets without drawing them */
+void render_queue_clear(render_queue* queue);
+
+void render_queue_get_stats(const render_queue* queue, render_queue_stats* stats);
@@ -0,0 +1,251 @@
+/*
+    shader library (data/shaders)
+    ----------------------------
+    the cache maps a file's path (relative to the executable) to its
+    expansion. a set remembers which two files it came from; one whose
+    files no longer expand (a missing include, say) isn't reloaded and
+    stays on its old programs until a later change fixes them.
+*/
+
+#include "myOpenGL/shader_library.h"
+#include "myAssets/asset_archive.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+#define MAX_INCLUDE_DEPTH 16
+
+struct library_file
+{
+    std::string text;                   // expanded
+    std::vector<std::string> deps;      // every file the expansion read, this one first
+};
+
+struct library_set
+{
+    shader_permutations* set;
+    std::string vertex_path;
+    std::string fragment_path;
+};
+
+static struct
+{
+    std::string dir;                                        // with a trailing slash
+    std::unordered_map<std::string, library_file> files;
+    std::unordered_map<std::string, int> ids;               // path -> #line source string number
+    std::vector<std::string> names;                         // and back
+    std::vector<library_set> sets;
+} g_library;
+
+void shader_library_init(const char* dir)
+{
+    shader_library_shutdown();
+    g_library.dir = dir ? dir : "";
+    if (!g_library.dir.empty() && g_library.dir[g_library.dir.size() - 1] != '/')
+        g_library.dir += '/';
+}
+
+void shader_library_shutdown()
+{
+    g_library.files.clear();
+    g_library.ids.clear();
+    g_library.names.clear();
+    g_library.sets.clear();
+}
+
+const char* shader_library_file_name(int id)
+{
+    return id >= 0 && id < (int)g_library.names.size() ? g_library.names[id].c_str() : "";
+}
+
+static int file_id(const std::string& path)
+{
+    std::unordered_map<std::string, int>::iterator found = g_library.ids.find(path);
+    if (found != g_library.ids.end())
+        return found->second;
+
+    int id = (int)g_library.names.size();
+    g_library.ids[path] = id;
+    g_library.names.push_back(path);
+    return id;
+}
+
+/* the quoted name of an #include line, false if the line is something else */
+static bool include_name(const std::string& line, std::string* name)
+{
+    size_t at = line.find_first_not_of(" \t");
+    if (at == std::string::npos || line.compare(at, 8, "#include") != 0)
+        return false;
+
+    size_t open = line.find('"', at + 8);
+    size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+    if (close == std::string::npos)
+        return false;
+
+    *name = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+static bool expand(const std::string& path, int depth, library_file* out, std::vector<std::string>* stack)
+{
+    if (depth > MAX_INCLUDE_DEPTH || std::find(stack->begin(), stack->end(), path) != stack->end())
+    {
+        printf("shader library: %s includes itself\n", path.c_str());
+        return false;
+    }
+
+    asset_data data;
+    if (!asset_load(path.c_str(), &data))
+    {
+        printf("shader library: can't read %s\n", path.c_str());
+        return false;
+    }
+    std::string source((const char*)data.bytes, data.size);
+    asset_release(&data);
+
+    out->deps.push_back(path);
+    stack->push_back(path);
+
+    int id = file_id(path);
+    int line_number = 0;
+    bool ok = true;
+    for (size_t at = 0; at < source.size() && ok; )
+    {
+        size_t end = source.find('\n', at);
+        end = end == std::string::npos ? source.size() : end + 1;
+        std::string line = source.substr(at, end - at);
+        at = end;
+        line_number++;
+
+        std::string name;
+        if (!include_name(line, &name))
+        {
+            out->text += line;
+            if (line[line.size() - 1] != '\n')
+                out->text += '\n';
+
+            /* #version has to come first, so the file's own number can only start after it */
+            if (depth == 0 && line_number == 1 && line.compare(0, 8, "#version") == 0)
+            {
+                char directive[32];
+                sprintf(directive, "#line 2 %d\n", id);
+                out->text += directive;
+            }
+            continue;
+        }
+
+        /* once per expansion: a second #include of the same file is dropped, unless
+           it is still being expanded (a cycle), which expand reports */
+        std::string child = g_library.dir + name;
+        bool seen = std::find(out->deps.begin(), out->deps.end(), child) != out->deps.end();
+        if (seen && std::find(stack->begin(), stack->end(), child) == stack->end())
+            continue;
+
+        char directive[32];
+        sprintf(directive, "#line 1 %d\n", file_id(child));
+        out->text += directive;
+        ok = expand(child, depth + 1, out, stack);
+        sprintf(directive, "#line %d %d\n", line_number + 1, id);
+        out->text += directive;
+
+        if (!ok)
+            printf("shader library: included from %s:%d\n", path.c_str(), line_number);
+    }
+
+    stack->pop_back();
+    return ok;
+}
+
+static bool load(const std::string& path, std::string* out)
+{
+    std::unordered_map<std::string, library_file>::iterator cached = g_library.files.find(path);
+    if (cached != g_library.files.end())
+    {
+        *out = cached->second.text;
+        return true;
+    }
+
+    library_file file;
+    std::vector<std::string> stack;
+    if (!expand(path, 0, &file, &stack))
+        return false;
+
+    *out = file.text;
+    g_library.files[path] = file;
+    return true;
+}
+
+bool shader_library_source(const char* name, std::string* out)
+{
+    return load(g_library.dir + name, out);
+}
+
+shader_permutations* shader_library_permutations(const char* vertex_name, const char* fragment_name,
+                                                 const char* const* features, int feature_count,
+                                                 shader_compile_func compile, shader_status_func status,
+                                                 shader_forget_func forget)
+{
+    library_set entry;
+    entry.vertex_path = g_library.dir + vertex_name;
+    entry.fragment_path = g_library.dir + fragment_name;
+
+    std::string vertex, fragment;
+    if (!load(entry.vertex_path, &vertex) || !load(entry.fragment_path, &fragment))
+        return NULL;
+
+    entry.set = shader_permutations_create(vertex.c_str(), fragment.c_str(), features, feature_count, compile, status, forget);
+    if (entry.set)
+        g_library.sets.push_back(entry);
+    return entry.set;
+}
+
+int shader_library_reload(const std::vector<std::string>& changed)
+{
+    if (changed.empty() || g_library.sets.empty())
+        return 0;
+
+    /* drop every expansion that read a changed file */
+    std::unordered_map<std::string, library_file>::iterator it = g_library.files.begin();
+    while (it != g_library.files.end())
+    {
+        const std::vector<std::string>& deps = it->second.deps;
+        bool stale = false;
+        for (size_t i = 0; i < changed.size() && !stale; i++)
+            stale = std::find(deps.begin(), deps.end(), changed[i]) != deps.end();
+
+        if (stale)
+            it = g_library.files.erase(it);
+        else
+            ++it;
+    }
+
+    /* and rebuild the sets made from them (the rest still have both expansions cached) */
+    int reloaded = 0;
+    for (size_t i = 0; i < g_library.sets.size(); i++)
+    {
+        library_set& entry = g_library.sets[i];
+        if (g_library.files.count(entry.vertex_path) && g_library.files.count(entry.fragment_path))
+            continue;
+
+        std::string vertex, fragment;
+        if (!load(entry.vertex_path, &vertex) || !load(entry.fragment_path, &fragment))
+        {
+            printf("shader library: keeping the old programs for %s + %s\n", entry.vertex_path.c_str(), entry.fragment_path.c_str());
+            continue;
+        }
+
+        shader_permutations_reload(entry.set, vertex.c_str(), fragment.c_str());
+        reloaded++;
+    }
+    return reloaded;
+}
+
+int shader_library_update()
+{
+    int swapped = 0;
+    for (size_t i = 0; i < g_library.sets.size(); i++)
+        swapped += shader_permutations_update(g_library.sets[i].set);
+    return swapped;
+}
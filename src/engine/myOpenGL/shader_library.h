@@ -0,0 +1,45 @@
+/*
+    shader library (data/shaders)
+    ----------------------------
+    shader sources are files, loaded through asset_load (so from data.gapk
+    when one is mounted) with their #include "name" lines expanded. names
+    are relative to the library directory, for includes too. a file is
+    only included once per expansion, and #line directives keep the
+    driver's error positions pointing at the right file and line: the
+    source string number is shader_library_file_name()'s id.
+
+    expansions are cached, each with the list of files it read. when any
+    of those changes, shader_library_reload() drops the expansion and
+    rebuilds the permutation sets made from it, in the background (see
+    shader_permutations_reload). shader_library_update() swaps them in.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "myOpenGL/shader_permutation.h"
+
+/* dir is relative to the executable, e.g. "data/shaders" */
+void shader_library_init(const char* dir);
+
+/* forgets every set (without destroying them: they belong to whoever made them) and the cache */
+void shader_library_shutdown();
+
+/* a file with its includes expanded; false (and a message) if it or anything it includes can't be read */
+bool shader_library_source(const char* name, std::string* out);
+
+/* which file a #line source string number means, "" if none */
+const char* shader_library_file_name(int id);
+
+/* a permutation set from two library files, rebuilt whenever either changes; NULL if they can't be read */
+shader_permutations* shader_library_permutations(const char* vertex_name, const char* fragment_name,
+                                                 const char* const* features, int feature_count,
+                                                 shader_compile_func compile, shader_status_func status = NULL,
+                                                 shader_forget_func forget = NULL);
+
+/* paths that changed (relative to the executable, as file_watch reports them): returns how many sets started rebuilding */
+int shader_library_reload(const std::vector<std::string>& changed);
+
+/* once a frame, before drawing: returns how many programs were swapped for rebuilt ones */
+int shader_library_update();
@@ -0,0 +1,220 @@
+/*
+    shader permutations
+    ----------------------------
+    the defines go after the #version line (which has to stay first) and
+    ahead of everything else, followed by a #line that puts the numbering
+    in driver logs back where the source had it. variants live in a map from mask to
+    program; a program of 0 (the compile failed) is remembered as well, so
+    a broken variant isn't recompiled every draw.
+
+    a reload builds into a second map, swapped into the first by the update
+    that finds all of it finished. sources that arrive while one is in
+    flight wait for it, then start the next.
+*/
+
+#include "myOpenGL/shader_permutation.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unordered_map>
+#include <vector>
+
+struct shader_permutations
+{
+    std::string vertex_source;
+    std::string fragment_source;
+    std::vector<std::string> features;
+    shader_compile_func compile;
+    shader_status_func status;
+    shader_forget_func forget;
+    std::unordered_map<uint32_t, GLuint> variants;
+
+    std::unordered_map<uint32_t, GLuint> reloading;     // mask -> its program from the new sources
+    bool reload_again;                                  // the sources changed again since that started
+};
+
+shader_permutations* shader_permutations_create(const char* vertex_source, const char* fragment_source,
+                                                const char* const* features, int feature_count,
+                                                shader_compile_func compile, shader_status_func status,
+                                                shader_forget_func forget)
+{
+    if (feature_count < 0 || feature_count > SHADER_PERMUTATION_MAX_FEATURES)
+    {
+        printf("shader permutations: %d features, at most %d fit a mask\n", feature_count, SHADER_PERMUTATION_MAX_FEATURES);
+        return NULL;
+    }
+
+    shader_permutations* set = new shader_permutations;
+    set->vertex_source = vertex_source;
+    set->fragment_source = fragment_source;
+    set->features.assign(features, features + feature_count);
+    set->compile = compile;
+    set->status = status;
+    set->forget = forget;
+    set->reload_again = false;
+    return set;
+}
+
+static void delete_program(const shader_permutations* set, GLuint program)
+{
+    glDeleteProgram(program);
+    if (set->forget)
+        set->forget(program);
+}
+
+void shader_permutations_destroy(shader_permutations* set)
+{
+    if (!set)
+        return;
+
+    std::unordered_map<uint32_t, GLuint>::iterator it;
+    for (it = set->variants.begin(); it != set->variants.end(); ++it)
+    {
+        if (it->second)
+            delete_program(set, it->second);
+    }
+    for (it = set->reloading.begin(); it != set->reloading.end(); ++it)
+    {
+        if (it->second)
+            delete_program(set, it->second);
+    }
+    delete set;
+}
+
+static std::string with_defines(const std::string& source, const std::vector<std::string>& features, uint32_t mask)
+{
+    std::string defines;
+    for (size_t i = 0; i < features.size(); i++)
+    {
+        if (mask & (1u << i))
+            defines += "#define " + features[i] + " 1\n";
+    }
+    if (!defines.empty())
+        defines += "#line 2\n";
+
+    /* #version must be the first thing the compiler sees */
+    size_t at = 0;
+    if (source.compare(0, 8, "#version") == 0)
+    {
+        at = source.find('\n');
+        at = at == std::string::npos ? source.size() : at + 1;
+    }
+
+    std::string out = source.substr(0, at);
+    if (at > 0 && out[out.size() - 1] != '\n')
+        out += '\n';
+    return out + defines + source.substr(at);
+}
+
+void shader_permutations_source(const shader_permutations* set, uint32_t mask,
+                                std::string* vertex_source, std::string* fragment_source)
+{
+    if (vertex_source)
+        *vertex_source = with_defines(set->vertex_source, set->features, mask);
+    if (fragment_source)
+        *fragment_source = with_defines(set->fragment_source, set->features, mask);
+}
+
+GLuint shader_permutations_get(shader_permutations* set, uint32_t mask)
+{
+    std::unordered_map<uint32_t, GLuint>::iterator it = set->variants.find(mask);
+    if (it != set->variants.end())
+        return it->second;
+
+    if (set->features.size() < 32 && (mask >> set->features.size()) != 0)
+        printf("shader permutations: mask %x names features that don't exist\n", mask);
+
+    std::string vertex, fragment;
+    shader_permutations_source(set, mask, &vertex, &fragment);
+
+    GLuint program = set->compile(vertex.c_str(), fragment.c_str());
+    if (!program)
+        printf("shader permutations: variant %x failed to build\n", mask);
+
+    set->variants[mask] = program;
+    return program;
+}
+
+void shader_permutations_precompile(shader_permutations* set, const uint32_t* masks, int count)
+{
+    if (masks)
+    {
+        for (int i = 0; i < count; i++)
+            shader_permutations_get(set, masks[i]);
+        return;
+    }
+
+    uint64_t combinations = (uint64_t)1 << set->features.size();
+    for (uint64_t mask = 0; mask < combinations; mask++)
+        shader_permutations_get(set, (uint32_t)mask);
+}
+
+static void start_reload(shader_permutations* set)
+{
+    std::unordered_map<uint32_t, GLuint>::iterator it;
+    for (it = set->variants.begin(); it != set->variants.end(); ++it)
+    {
+        std::string vertex, fragment;
+        shader_permutations_source(set, it->first, &vertex, &fragment);
+        set->reloading[it->first] = set->compile(vertex.c_str(), fragment.c_str());
+    }
+}
+
+void shader_permutations_reload(shader_permutations* set, const char* vertex_source, const char* fragment_source)
+{
+    /* variants compiled from here on (on first use) get the new sources straight away */
+    set->vertex_source = vertex_source;
+    set->fragment_source = fragment_source;
+
+    if (!set->reloading.empty())
+        set->reload_again = true;
+    else
+        start_reload(set);
+}
+
+/* 1 linked, 0 building, -1 failed */
+static int program_status(const shader_permutations* set, GLuint program)
+{
+    if (!program)
+        return -1;
+    return set->status ? set->status(program) : 1;
+}
+
+int shader_permutations_update(shader_permutations* set)
+{
+    if (set->reloading.empty())
+        return 0;
+
+    std::unordered_map<uint32_t, GLuint>::iterator it;
+    for (it = set->reloading.begin(); it != set->reloading.end(); ++it)
+    {
+        if (program_status(set, it->second) == 0)
+            return 0;
+    }
+
+    int swapped = 0;
+    for (it = set->reloading.begin(); it != set->reloading.end(); ++it)
+    {
+        GLuint& current = set->variants[it->first];
+        if (program_status(set, it->second) < 0)
+        {
+            printf("shader permutations: variant %x failed to rebuild, keeping the old program\n", it->first);
+            if (it->second)
+                delete_program(set, it->second);
+            continue;
+        }
+
+        if (current)
+            delete_program(set, current);
+        current = it->second;
+        swapped++;
+    }
+    set->reloading.clear();
+
+    if (set->reload_again)
+    {
+        set->reload_again = false;
+        start_reload(set);
+    }
+    return swapped;
+}
@@ -0,0 +1,63 @@
+/*
+    shader permutations
+    ----------------------------
+    one vertex + fragment source pair, written with #ifdef blocks around
+    optional features, compiled into a separate program per combination of
+    features actually used. a combination is a bitmask: bit i set means
+    features[i] is #defined (to 1) in both stages, right after #version.
+
+    variants are compiled on first use, or all at once up front with
+    shader_permutations_precompile(), so no draw waits for the compiler and
+    the full set a build needs can be walked ahead of time.
+
+    shader_permutations_reload() recompiles every variant from new sources
+    while the old programs stay in use. shader_permutations_update() swaps
+    the new ones in together, once the last of them has finished: a frame
+    never draws half the set from old sources and half from new. a variant
+    that fails to build keeps its old program.
+*/
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#define SHADER_PERMUTATION_MAX_FEATURES 32
+
+/* compiles and links one variant's final sources (exits or returns 0 on error, as it likes) */
+typedef GLuint (*shader_compile_func)(const char* vertex_source, const char* fragment_source);
+
+/* for compiles that finish later: 1 linked, 0 still building, -1 failed */
+typedef int (*shader_status_func)(GLuint program);
+
+/* told about each program the set deletes, so whatever tracks its build can let go of it */
+typedef void (*shader_forget_func)(GLuint program);
+
+struct shader_permutations;
+
+/* the sources and feature names are copied; no status function means compile returns finished programs */
+shader_permutations* shader_permutations_create(const char* vertex_source, const char* fragment_source,
+                                                const char* const* features, int feature_count,
+                                                shader_compile_func compile, shader_status_func status = NULL,
+                                                shader_forget_func forget = NULL);
+
+/* deletes every compiled variant */
+void shader_permutations_destroy(shader_permutations* set);
+
+/* the program for a feature mask, compiled now if it hasn't been */
+GLuint shader_permutations_get(shader_permutations* set, uint32_t mask);
+
+/* compiles the listed masks, or all 2^feature_count combinations when masks is NULL */
+void shader_permutations_precompile(shader_permutations* set, const uint32_t* masks, int count);
+
+/* the sources a mask compiles from, defines included: for tools and error logs */
+void shader_permutations_source(const shader_permutations* set, uint32_t mask,
+                                std::string* vertex_source, std::string* fragment_source);
+
+/* starts rebuilding every variant from new sources (after the reload in flight, if there is one) */
+void shader_permutations_reload(shader_permutations* set, const char* vertex_source, const char* fragment_source);
+
+/* once a frame, before drawing: swaps in a finished reload, returns how many variants changed program */
+int shader_permutations_update(shader_permutations* set);
@@ -0,0 +1,314 @@
+/*
+    shader program reflection and uniform shadowing
+    ----------------------------
+    the shadow is one byte array per program, every default-block uniform
+    holding a slice of it. a uniform's slice is only trusted for the
+    elements set through it so far (known), so the first set of anything
+    always uploads: a freshly linked program's values are 0, but one made
+    with glProgramBinary, or written through plain glUniform, might not be.
+*/
+
+#include "myOpenGL/shader_reflect.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+struct shadow_slot
+{
+    size_t offset;          // into shadow
+    size_t element_bytes;   // 0: a type the setters don't handle
+    int known;              // elements from the first whose value the shadow holds
+};
+
+struct shader_reflection
+{
+    GLuint program;
+    std::vector<shader_uniform_info> uniforms;
+    std::vector<shader_block_info> blocks;
+    std::vector<shadow_slot> slots;         // parallel to uniforms
+    std::vector<uint8_t> shadow;
+};
+
+static struct
+{
+    int uploads;
+    int skipped;
+    int frame_uploads;      // so far this frame
+    int frame_skipped;
+    int last_frame_uploads;
+    int last_frame_skipped;
+} g_uniform_stats;
+
+static bool is_sampler(GLenum type)
+{
+    static const GLenum samplers[] = {
+        GL_SAMPLER_1D, GL_SAMPLER_2D, GL_SAMPLER_3D, GL_SAMPLER_CUBE, GL_SAMPLER_1D_SHADOW, GL_SAMPLER_2D_SHADOW,
+        GL_SAMPLER_1D_ARRAY, GL_SAMPLER_2D_ARRAY, GL_SAMPLER_1D_ARRAY_SHADOW, GL_SAMPLER_2D_ARRAY_SHADOW,
+        GL_SAMPLER_CUBE_SHADOW, GL_SAMPLER_BUFFER, GL_SAMPLER_2D_RECT, GL_SAMPLER_2D_RECT_SHADOW,
+        GL_SAMPLER_2D_MULTISAMPLE, GL_SAMPLER_2D_MULTISAMPLE_ARRAY, GL_SAMPLER_CUBE_MAP_ARRAY,
+        GL_INT_SAMPLER_2D, GL_INT_SAMPLER_3D, GL_INT_SAMPLER_CUBE, GL_INT_SAMPLER_2D_ARRAY,
+        GL_UNSIGNED_INT_SAMPLER_2D, GL_UNSIGNED_INT_SAMPLER_3D, GL_UNSIGNED_INT_SAMPLER_CUBE,
+        GL_UNSIGNED_INT_SAMPLER_2D_ARRAY, GL_UNSIGNED_INT_SAMPLER_BUFFER
+    };
+    for (size_t i = 0; i < sizeof(samplers) / sizeof(samplers[0]); i++)
+    {
+        if (type == samplers[i])
+            return true;
+    }
+    return false;
+}
+
+/* the handle type a GL type is set through: GL_INT for int, bool and samplers, 0 for none */
+static GLenum handle_type(GLenum type)
+{
+    if (type == GL_INT || type == GL_BOOL || is_sampler(type))
+        return GL_INT;
+    if (type == GL_FLOAT || type == GL_FLOAT_VEC2 || type == GL_FLOAT_VEC3 || type == GL_FLOAT_VEC4 || type == GL_FLOAT_MAT4)
+        return type;
+    return 0;
+}
+
+static size_t element_bytes(GLenum type)
+{
+    switch (handle_type(type))
+    {
+    case GL_INT: return sizeof(GLint);
+    case GL_FLOAT: return sizeof(GLfloat);
+    case GL_FLOAT_VEC2: return 2 * sizeof(GLfloat);
+    case GL_FLOAT_VEC3: return 3 * sizeof(GLfloat);
+    case GL_FLOAT_VEC4: return 4 * sizeof(GLfloat);
+    case GL_FLOAT_MAT4: return 16 * sizeof(GLfloat);
+    default: return 0;
+    }
+}
+
+shader_reflection* shader_reflect(GLuint program)
+{
+    shader_reflection* reflection = new shader_reflection;
+    reflection->program = program;
+
+    GLint count = 0, max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &max_length);
+    std::vector<GLchar> name(max_length > 0 ? max_length : 1);
+
+    for (GLint b = 0; b < count; b++)
+    {
+        shader_block_info block;
+        GLsizei length = 0;
+        glGetActiveUniformBlockName(program, b, (GLsizei)name.size(), &length, &name[0]);
+        block.name.assign(&name[0], length);
+        block.index = b;
+        glGetActiveUniformBlockiv(program, b, GL_UNIFORM_BLOCK_DATA_SIZE, &block.data_size);
+        glGetActiveUniformBlockiv(program, b, GL_UNIFORM_BLOCK_BINDING, &block.binding);
+        glGetActiveUniformBlockiv(program, b, GL_UNIFORM_BLOCK_ACTIVE_UNIFORMS, &block.uniforms);
+        reflection->blocks.push_back(block);
+    }
+
+    count = max_length = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    name.resize(max_length > 0 ? max_length : 1);
+
+    size_t shadow_bytes = 0;
+    for (GLint i = 0; i < count; i++)
+    {
+        shader_uniform_info uniform;
+        GLsizei length = 0;
+        GLuint index = (GLuint)i;
+        glGetActiveUniform(program, index, (GLsizei)name.size(), &length, &uniform.count, &uniform.type, &name[0]);
+        name[length < (GLsizei)name.size() ? length : name.size() - 1] = '\0';
+        glGetActiveUniformsiv(program, 1, &index, GL_UNIFORM_BLOCK_INDEX, &uniform.block);
+
+        /* built-ins (gl_*) are active but have no location, block members have none either */
+        uniform.location = uniform.block < 0 ? glGetUniformLocation(program, &name[0]) : -1;
+
+        uniform.name.assign(&name[0], length);
+        if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+            uniform.name.resize(uniform.name.size() - 3);
+
+        shadow_slot slot;
+        slot.offset = shadow_bytes;
+        slot.element_bytes = uniform.location >= 0 ? element_bytes(uniform.type) : 0;
+        slot.known = 0;
+        shadow_bytes += slot.element_bytes * uniform.count;
+
+        reflection->uniforms.push_back(uniform);
+        reflection->slots.push_back(slot);
+    }
+    reflection->shadow.resize(shadow_bytes);
+
+    return reflection;
+}
+
+void shader_reflection_destroy(shader_reflection* reflection)
+{
+    delete reflection;
+}
+
+GLuint shader_reflection_program(const shader_reflection* reflection)
+{
+    return reflection->program;
+}
+
+const std::vector<shader_uniform_info>& shader_reflection_uniforms(const shader_reflection* reflection)
+{
+    return reflection->uniforms;
+}
+
+const std::vector<shader_block_info>& shader_reflection_blocks(const shader_reflection* reflection)
+{
+    return reflection->blocks;
+}
+
+void shader_reflect_invalidate(shader_reflection* reflection)
+{
+    for (size_t i = 0; i < reflection->slots.size(); i++)
+        reflection->slots[i].known = 0;
+}
+
+/* the uniform's index if it exists, is settable and is of the wanted handle type, -1 otherwise */
+static int find_uniform(const shader_reflection* reflection, const char* name, GLenum wanted)
+{
+    for (size_t i = 0; i < reflection->uniforms.size(); i++)
+    {
+        const shader_uniform_info& uniform = reflection->uniforms[i];
+        if (uniform.name != name)
+            continue;
+
+        if (uniform.location < 0 || handle_type(uniform.type) != wanted)
+        {
+            printf("shader reflect: program %u's %s (type %x) can't be set as type %x\n",
+                   reflection->program, name, uniform.type, wanted);
+            return -1;
+        }
+        return (int)i;
+    }
+    return -1;  // not active: compiled out, or never there
+}
+
+uniform_int shader_uniform_int(const shader_reflection* reflection, const char* name)
+{
+    uniform_int handle = { find_uniform(reflection, name, GL_INT) };
+    return handle;
+}
+
+uniform_float shader_uniform_float(const shader_reflection* reflection, const char* name)
+{
+    uniform_float handle = { find_uniform(reflection, name, GL_FLOAT) };
+    return handle;
+}
+
+uniform_vec2 shader_uniform_vec2(const shader_reflection* reflection, const char* name)
+{
+    uniform_vec2 handle = { find_uniform(reflection, name, GL_FLOAT_VEC2) };
+    return handle;
+}
+
+uniform_vec3 shader_uniform_vec3(const shader_reflection* reflection, const char* name)
+{
+    uniform_vec3 handle = { find_uniform(reflection, name, GL_FLOAT_VEC3) };
+    return handle;
+}
+
+uniform_vec4 shader_uniform_vec4(const shader_reflection* reflection, const char* name)
+{
+    uniform_vec4 handle = { find_uniform(reflection, name, GL_FLOAT_VEC4) };
+    return handle;
+}
+
+uniform_mat4 shader_uniform_mat4(const shader_reflection* reflection, const char* name)
+{
+    uniform_mat4 handle = { find_uniform(reflection, name, GL_FLOAT_MAT4) };
+    return handle;
+}
+
+/* true when the values differ from the shadow (which then takes them) and have to be uploaded */
+static bool update_shadow(shader_reflection* reflection, int index, const void* v, int* count)
+{
+    const shader_uniform_info& uniform = reflection->uniforms[index];
+    shadow_slot& slot = reflection->slots[index];
+
+    if (*count > uniform.count)
+        *count = uniform.count;
+
+    uint8_t* shadow = &reflection->shadow[slot.offset];
+    size_t bytes = slot.element_bytes * *count;
+    if (*count <= slot.known && memcmp(shadow, v, bytes) == 0)
+    {
+        g_uniform_stats.skipped++;
+        g_uniform_stats.frame_skipped++;
+        return false;
+    }
+
+    memcpy(shadow, v, bytes);
+    if (*count > slot.known)
+        slot.known = *count;
+
+    g_uniform_stats.uploads++;
+    g_uniform_stats.frame_uploads++;
+    return true;
+}
+
+void shader_set_int(shader_reflection* reflection, uniform_int handle, const GLint* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniform1iv(reflection->uniforms[handle.index].location, count, v);
+}
+
+void shader_set_int(shader_reflection* reflection, uniform_int handle, GLint v)
+{
+    shader_set_int(reflection, handle, &v, 1);
+}
+
+void shader_set_float(shader_reflection* reflection, uniform_float handle, const GLfloat* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniform1fv(reflection->uniforms[handle.index].location, count, v);
+}
+
+void shader_set_float(shader_reflection* reflection, uniform_float handle, GLfloat v)
+{
+    shader_set_float(reflection, handle, &v, 1);
+}
+
+void shader_set_vec2(shader_reflection* reflection, uniform_vec2 handle, const GLfloat* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniform2fv(reflection->uniforms[handle.index].location, count, v);
+}
+
+void shader_set_vec3(shader_reflection* reflection, uniform_vec3 handle, const GLfloat* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniform3fv(reflection->uniforms[handle.index].location, count, v);
+}
+
+void shader_set_vec4(shader_reflection* reflection, uniform_vec4 handle, const GLfloat* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniform4fv(reflection->uniforms[handle.index].location, count, v);
+}
+
+void shader_set_mat4(shader_reflection* reflection, uniform_mat4 handle, const GLfloat* v, int count)
+{
+    if (handle.index >= 0 && update_shadow(reflection, handle.index, v, &count))
+        glUniformMatrix4fv(reflection->uniforms[handle.index].location, count, GL_FALSE, v);
+}
+
+void shader_uniform_end_frame()
+{
+    g_uniform_stats.last_frame_uploads = g_uniform_stats.frame_uploads;
+    g_uniform_stats.last_frame_skipped = g_uniform_stats.frame_skipped;
+    g_uniform_stats.frame_uploads = 0;
+    g_uniform_stats.frame_skipped = 0;
+}
+
+void shader_uniform_get_stats(shader_uniform_stats* stats)
+{
+    stats->uploads = g_uniform_stats.uploads;
+    stats->skipped = g_uniform_stats.skipped;
+    stats->frame_uploads = g_uniform_stats.last_frame_uploads;
+    stats->frame_skipped = g_uniform_stats.last_frame_skipped;
+}
@@ -0,0 +1,95 @@
+/*
+    shader program reflection and uniform shadowing
+    ----------------------------
+    shader_reflect() asks a linked program for its active uniforms and
+    uniform blocks once, and keeps a CPU copy of every uniform's value.
+    uniforms are then found by name once, as typed handles, and set through
+    them: a set that matches the copy issues no GL call at all.
+
+    handles only mean something for the reflection they came from (one per
+    program). a handle for a name the program doesn't use (compiled out,
+    say) is inactive, and setting it does nothing, like location -1 in GL.
+    a handle asked for with the wrong type is inactive too, and says so.
+
+    the setters call glUniform*, so the program has to be the one in use.
+    the shadow only knows about values set through it: anything else that
+    writes the program's uniforms should call shader_reflect_invalidate().
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+struct shader_uniform_info
+{
+    std::string name;       // "[0]" taken off arrays
+    GLint location;         // -1 inside a block
+    GLenum type;            // GL_FLOAT_VEC4, GL_SAMPLER_2D...
+    GLint count;            // array size, 1 otherwise
+    GLint block;            // index into blocks, -1 for the default block
+};
+
+struct shader_block_info
+{
+    std::string name;
+    GLuint index;
+    GLint data_size;        // bytes the buffer bound to it has to hold
+    GLint binding;
+    GLint uniforms;         // active uniforms inside
+};
+
+struct shader_reflection;
+
+/* typed handles: index into the reflection's uniforms, -1 when inactive */
+struct uniform_int { int index; };     // int, bool and samplers
+struct uniform_float { int index; };
+struct uniform_vec2 { int index; };
+struct uniform_vec3 { int index; };
+struct uniform_vec4 { int index; };
+struct uniform_mat4 { int index; };
+
+struct shader_uniform_stats
+{
+    int uploads;            // glUniform calls issued
+    int skipped;            // sets that matched the shadow and were dropped
+
+    /* the same, for the last frame only (set by every shader_uniform_end_frame) */
+    int frame_uploads;
+    int frame_skipped;
+};
+
+shader_reflection* shader_reflect(GLuint program);
+void shader_reflection_destroy(shader_reflection* reflection);
+
+GLuint shader_reflection_program(const shader_reflection* reflection);
+const std::vector<shader_uniform_info>& shader_reflection_uniforms(const shader_reflection* reflection);
+const std::vector<shader_block_info>& shader_reflection_blocks(const shader_reflection* reflection);
+
+/* the next set of every uniform uploads, whatever the shadow holds */
+void shader_reflect_invalidate(shader_reflection* reflection);
+
+uniform_int shader_uniform_int(const shader_reflection* reflection, const char* name);
+uniform_float shader_uniform_float(const shader_reflection* reflection, const char* name);
+uniform_vec2 shader_uniform_vec2(const shader_reflection* reflection, const char* name);
+uniform_vec3 shader_uniform_vec3(const shader_reflection* reflection, const char* name);
+uniform_vec4 shader_uniform_vec4(const shader_reflection* reflection, const char* name);
+uniform_mat4 shader_uniform_mat4(const shader_reflection* reflection, const char* name);
+
+/* count elements of an array uniform from the first, as glUniform* would (column major matrices) */
+void shader_set_int(shader_reflection* reflection, uniform_int handle, const GLint* v, int count = 1);
+void shader_set_int(shader_reflection* reflection, uniform_int handle, GLint v);
+void shader_set_float(shader_reflection* reflection, uniform_float handle, const GLfloat* v, int count = 1);
+void shader_set_float(shader_reflection* reflection, uniform_float handle, GLfloat v);
+void shader_set_vec2(shader_reflection* reflection, uniform_vec2 handle, const GLfloat* v, int count = 1);
+void shader_set_vec3(shader_reflection* reflection, uniform_vec3 handle, const GLfloat* v, int count = 1);
+void shader_set_vec4(shader_reflection* reflection, uniform_vec4 handle, const GLfloat* v, int count = 1);
+void shader_set_mat4(shader_reflection* reflection, uniform_mat4 handle, const GLfloat* v, int count = 1);
+
+/* once a frame, after its last draw: what the frame set becomes the frame_ counters */
+void shader_uniform_end_frame();
+
+/* counts sets through every reflection */
+void shader_uniform_get_stats(shader_uniform_stats* stats);
@@ -0,0 +1,380 @@
+/*
+    pixel upload ring (persistently mapped PBO)
+    ----------------------------
+    spans live in a deque, oldest first, each reserved -> released -> fenced.
+    the tail only moves past a span once the fence behind it has signalled,
+    so a span still being written (or waiting in an upload queue) holds
+    everything after it. when a span doesn't fit before the end of the
+    buffer the rest of the end becomes padding and the span goes to offset 0.
+
+    reserving and releasing touch no GL, only the mutex: workers do both.
+    fences are created, polled and deleted on the main thread only.
+*/
+
+#include "myOpenGL/upload_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <deque>
+
+#include "SDL.h"
+
+#define RING_ALIGNMENT 64                       // spans start on cache lines
+#define RING_WAIT_NS (1000ull * 1000 * 1000)    // longest a main thread stall waits on one fence
+
+enum span_state
+{
+    SPAN_RESERVED,
+    SPAN_RELEASED,
+    SPAN_PADDING
+};
+
+struct ring_entry
+{
+    size_t offset, length;
+    span_state state;
+    uint64_t fence;     // number of the fence behind it, 0 until fenced
+};
+
+struct ring_fence
+{
+    GLsync sync;
+    uint64_t number;
+};
+
+static struct
+{
+    upload_ring_gl gl;
+    bool enabled;
+    GLuint buffer;
+    uint8_t* mapped;
+    size_t capacity;
+    size_t head;                    // where the next span goes
+
+    std::deque<ring_entry> entries; // oldest first
+    uint64_t first_id;              // id of entries.front()
+    std::deque<ring_fence> fences;  // oldest first
+    uint64_t next_fence;
+    uint64_t passed_fence;          // highest fence number the GPU is known to be past
+
+    SDL_mutex* lock;
+    SDL_threadID gl_thread;
+    upload_ring_stats stats;
+} g_ring;
+
+static size_t align_up(size_t size)
+{
+    return (size + RING_ALIGNMENT - 1) & ~(size_t)(RING_ALIGNMENT - 1);
+}
+
+bool upload_ring_init(size_t capacity, const upload_ring_gl* gl)
+{
+    memset(&g_ring.stats, 0, sizeof(g_ring.stats));
+    g_ring.enabled = false;
+    g_ring.mapped = NULL;
+    g_ring.buffer = 0;
+    g_ring.head = 0;
+    g_ring.first_id = 1;
+    g_ring.next_fence = 1;
+    g_ring.passed_fence = 0;
+    g_ring.gl_thread = SDL_ThreadID();
+
+    if (capacity == 0)
+        return false;
+
+    if (gl)
+        g_ring.gl = *gl;
+    else
+    {
+        if (!(GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) || !(GLEW_VERSION_3_2 || GLEW_ARB_sync))
+        {
+            printf("upload ring: no persistent buffer mapping, uploading from client memory\n");
+            return false;
+        }
+
+        g_ring.gl.gen_buffers = glGenBuffers;
+        g_ring.gl.delete_buffers = glDeleteBuffers;
+        g_ring.gl.bind_buffer = glBindBuffer;
+        g_ring.gl.buffer_storage = glBufferStorage;
+        g_ring.gl.map_buffer_range = glMapBufferRange;
+        g_ring.gl.unmap_buffer = glUnmapBuffer;
+        g_ring.gl.fence_sync = glFenceSync;
+        g_ring.gl.client_wait_sync = glClientWaitSync;
+        g_ring.gl.delete_sync = glDeleteSync;
+    }
+
+    const upload_ring_gl& f = g_ring.gl;
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    g_ring.capacity = align_up(capacity);
+
+    f.gen_buffers(1, &g_ring.buffer);
+    f.bind_buffer(GL_PIXEL_UNPACK_BUFFER, g_ring.buffer);
+    f.buffer_storage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)g_ring.capacity, NULL, flags);
+    g_ring.mapped = (uint8_t*)f.map_buffer_range(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)g_ring.capacity, flags);
+    f.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    if (!g_ring.mapped)
+    {
+        printf("upload ring: couldn't map %.1f MB, uploading from client memory\n", g_ring.capacity / (1024.0 * 1024.0));
+        f.delete_buffers(1, &g_ring.buffer);
+        g_ring.buffer = 0;
+        return false;
+    }
+
+    g_ring.lock = SDL_CreateMutex();
+    g_ring.stats.capacity = g_ring.capacity;
+    g_ring.enabled = true;
+    return true;
+}
+
+bool upload_ring_enabled()
+{
+    return g_ring.enabled;
+}
+
+GLuint upload_ring_buffer()
+{
+    return g_ring.buffer;
+}
+
+/* ------------------------------------------------------------------------ */
+/* under the lock */
+
+/* one fence behind every span released since the last one */
+static void fence_released()
+{
+    bool any = false;
+    for (size_t i = 0; i < g_ring.entries.size(); i++)
+        any |= g_ring.entries[i].state == SPAN_RELEASED && g_ring.entries[i].fence == 0;
+    if (!any)
+        return;
+
+    ring_fence fence;
+    fence.sync = g_ring.gl.fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence.number = g_ring.next_fence++;
+    g_ring.fences.push_back(fence);
+    g_ring.stats.fences++;
+
+    for (size_t i = 0; i < g_ring.entries.size(); i++)
+    {
+        ring_entry& entry = g_ring.entries[i];
+        if (entry.state == SPAN_RELEASED && entry.fence == 0)
+            entry.fence = fence.number;
+    }
+}
+
+/* true when the oldest fence has signalled (it is then gone) */
+static bool pass_oldest_fence(GLbitfield flags, GLuint64 timeout)
+{
+    if (g_ring.fences.empty())
+        return false;
+
+    ring_fence& fence = g_ring.fences.front();
+    GLenum result = g_ring.gl.client_wait_sync(fence.sync, flags, timeout);
+    if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        return false;
+
+    g_ring.gl.delete_sync(fence.sync);
+    g_ring.passed_fence = fence.number;
+    g_ring.fences.pop_front();
+    return true;
+}
+
+static void retire_entries()
+{
+    while (!g_ring.entries.empty())
+    {
+        const ring_entry& entry = g_ring.entries.front();
+        bool passed = entry.state == SPAN_PADDING ||
+                      (entry.state == SPAN_RELEASED && entry.fence && entry.fence <= g_ring.passed_fence);
+        if (!passed)
+            break;
+
+        g_ring.stats.used -= entry.length;
+        g_ring.entries.pop_front();
+        g_ring.first_id++;
+    }
+
+    /* empty: start over at the front, the longest run there is */
+    if (g_ring.entries.empty())
+        g_ring.head = 0;
+}
+
+static void push_entry(size_t offset, size_t length, span_state state)
+{
+    ring_entry entry;
+    entry.offset = offset;
+    entry.length = length;
+    entry.state = state;
+    entry.fence = 0;
+    g_ring.entries.push_back(entry);
+
+    g_ring.stats.used += length;
+    if (g_ring.stats.used > g_ring.stats.peak_used)
+        g_ring.stats.peak_used = g_ring.stats.used;
+}
+
+/*
+    free space is [head, end) + [0, tail) while the live spans don't wrap,
+    [head, tail) once they do. head == tail with spans live means full.
+*/
+static bool place(size_t length, size_t* offset)
+{
+    if (g_ring.entries.empty())
+    {
+        *offset = 0;
+        return length <= g_ring.capacity;
+    }
+
+    size_t head = g_ring.head;
+    size_t tail = g_ring.entries.front().offset;
+
+    if (head > tail)
+    {
+        if (g_ring.capacity - head >= length)
+        {
+            *offset = head;
+            return true;
+        }
+        if (tail >= length)
+        {
+            if (g_ring.capacity > head)
+                push_entry(head, g_ring.capacity - head, SPAN_PADDING);
+            g_ring.stats.wraps++;
+            *offset = 0;
+            return true;
+        }
+        return false;
+    }
+
+    if (tail - head >= length && head != tail)
+    {
+        *offset = head;
+        return true;
+    }
+    return false;
+}
+
+/* ------------------------------------------------------------------------ */
+
+bool upload_ring_reserve(size_t size, bool wait, upload_ring_span* span)
+{
+    span->data = NULL;
+    span->offset = 0;
+    span->size = size;
+    span->id = 0;
+
+    if (!g_ring.enabled || size == 0)
+        return false;
+
+    size_t length = align_up(size);
+    bool may_block = wait && SDL_ThreadID() == g_ring.gl_thread;
+    bool stalled = false;
+    size_t offset;
+
+    SDL_LockMutex(g_ring.lock);
+
+    if (length > g_ring.capacity)
+    {
+        g_ring.stats.too_large++;
+        SDL_UnlockMutex(g_ring.lock);
+        return false;
+    }
+
+    while (!place(length, &offset))
+    {
+        /* only the GL thread can wait on fences; spans still being written can't be waited out */
+        fence_released();
+        if (!may_block || !pass_oldest_fence(GL_SYNC_FLUSH_COMMANDS_BIT, RING_WAIT_NS))
+        {
+            g_ring.stats.full++;
+            SDL_UnlockMutex(g_ring.lock);
+            return false;
+        }
+        retire_entries();
+        stalled = true;
+    }
+
+    push_entry(offset, length, SPAN_RESERVED);
+    g_ring.head = offset + length;
+    g_ring.stats.reserves++;
+    g_ring.stats.stalls += stalled ? 1 : 0;
+
+    span->data = g_ring.mapped + offset;
+    span->offset = offset;
+    span->id = g_ring.first_id + g_ring.entries.size() - 1;
+
+    SDL_UnlockMutex(g_ring.lock);
+    return true;
+}
+
+void upload_ring_release(const upload_ring_span& span)
+{
+    if (!span.data || !g_ring.enabled)
+        return;
+
+    SDL_LockMutex(g_ring.lock);
+    size_t index = (size_t)(span.id - g_ring.first_id);
+    if (span.id >= g_ring.first_id && index < g_ring.entries.size())
+        g_ring.entries[index].state = SPAN_RELEASED;
+    SDL_UnlockMutex(g_ring.lock);
+}
+
+void upload_ring_submit()
+{
+    if (!g_ring.enabled)
+        return;
+
+    SDL_LockMutex(g_ring.lock);
+    fence_released();
+    while (pass_oldest_fence(0, 0))
+        ;
+    retire_entries();
+    SDL_UnlockMutex(g_ring.lock);
+}
+
+void upload_ring_get_stats(upload_ring_stats* stats)
+{
+    if (g_ring.enabled)
+        SDL_LockMutex(g_ring.lock);
+
+    *stats = g_ring.stats;
+    stats->live_spans = 0;
+    for (size_t i = 0; i < g_ring.entries.size(); i++)
+        stats->live_spans += g_ring.entries[i].state != SPAN_PADDING ? 1 : 0;
+    stats->pending_fences = (int)g_ring.fences.size();
+
+    if (g_ring.enabled)
+        SDL_UnlockMutex(g_ring.lock);
+}
+
+void upload_ring_shutdown()
+{
+    if (!g_ring.enabled)
+        return;
+
+    const upload_ring_gl& f = g_ring.gl;
+
+    /* the GPU may still be reading: wait out every fence before unmapping */
+    SDL_LockMutex(g_ring.lock);
+    fence_released();
+    while (!g_ring.fences.empty())
+    {
+        f.client_wait_sync(g_ring.fences.front().sync, GL_SYNC_FLUSH_COMMANDS_BIT, RING_WAIT_NS);
+        f.delete_sync(g_ring.fences.front().sync);
+        g_ring.fences.pop_front();
+    }
+    g_ring.entries.clear();
+    g_ring.enabled = false;
+    SDL_UnlockMutex(g_ring.lock);
+
+    f.bind_buffer(GL_PIXEL_UNPACK_BUFFER, g_ring.buffer);
+    f.unmap_buffer(GL_PIXEL_UNPACK_BUFFER);
+    f.bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    f.delete_buffers(1, &g_ring.buffer);
+
+    g_ring.buffer = 0;
+    g_ring.mapped = NULL;
+    SDL_DestroyMutex(g_ring.lock);
+    g_ring.lock = NULL;
+}
@@ -0,0 +1,83 @@
+/*
+    pixel upload ring (persistently mapped PBO)
+    ----------------------------
+    one GL_PIXEL_UNPACK_BUFFER, allocated with glBufferStorage and mapped
+    once for the life of the ring. decoders copy texels into a reserved span
+    of that mapping (from any thread), the main thread then points
+    glTex(Sub)Image calls at the span's offset, so the driver can DMA from it
+    instead of copying client memory before the call returns.
+
+    spans are handed out and retired first in, first out. upload_ring_submit()
+    (main thread, once per frame) puts a glFenceSync behind every span released
+    since the last one, and retires fences the GPU has passed. a span's bytes
+    are only reused once its fence has signalled.
+
+    every GL call goes through an upload_ring_gl table: pass NULL to use the
+    real entry points, or a recording stub to check fence ordering and
+    wraparound without a GPU.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+struct upload_ring_gl
+{
+    PFNGLGENBUFFERSPROC gen_buffers;
+    PFNGLDELETEBUFFERSPROC delete_buffers;
+    PFNGLBINDBUFFERPROC bind_buffer;
+    PFNGLBUFFERSTORAGEPROC buffer_storage;
+    PFNGLMAPBUFFERRANGEPROC map_buffer_range;
+    PFNGLUNMAPBUFFERPROC unmap_buffer;
+    PFNGLFENCESYNCPROC fence_sync;
+    PFNGLCLIENTWAITSYNCPROC client_wait_sync;
+    PFNGLDELETESYNCPROC delete_sync;
+};
+
+struct upload_ring_span
+{
+    uint8_t* data;      // mapped memory to write, NULL when nothing was reserved
+    size_t offset;      // the same bytes as a buffer offset, for glTex*Image with the ring bound
+    size_t size;        // as requested
+    uint64_t id;
+};
+
+struct upload_ring_stats
+{
+    size_t capacity;
+    size_t used;            // reserved and not yet retired, wraparound padding included
+    size_t peak_used;
+    int live_spans;
+    int pending_fences;
+    int reserves;           // spans handed out
+    int stalls;             // main thread reserves that had to wait on a fence
+    int full;               // reserves refused for lack of room (the caller uploads from client memory)
+    int too_large;          // reserves bigger than the whole ring
+    int wraps;              // times the write position went back to the start
+    int fences;             // fences inserted
+};
+
+/* main thread, after glewInit. false (and every reserve fails) without persistent mapping */
+bool upload_ring_init(size_t capacity, const upload_ring_gl* gl = NULL);
+void upload_ring_shutdown();
+bool upload_ring_enabled();
+
+/*
+    any thread. on the main thread, wait lets it block on fences until the GPU
+    frees enough room (a stall); elsewhere a full ring just returns false.
+*/
+bool upload_ring_reserve(size_t size, bool wait, upload_ring_span* span);
+
+/* any thread: the span's GL commands have been issued (or never will be) */
+void upload_ring_release(const upload_ring_span& span);
+
+/* main thread: bind as GL_PIXEL_UNPACK_BUFFER while uploading from spans */
+GLuint upload_ring_buffer();
+
+/* main thread, once per frame: fence released spans, retire passed fences */
+void upload_ring_submit();
+
+void upload_ring_get_stats(upload_ring_stats* stats);
@@ -0,0 +1,757 @@
+/*
+    block compression (BC1 / BC3 / BC5 / BC7) encoder and reference decoder
+    ----------------------------
+    every endpoint format is fitted the same way:
+
+      1. principal axis of the block (power iteration on the covariance)
+      2. endpoints at the extremes of the texels projected on that axis
+      3. quantize endpoints, match every texel to its nearest palette entry
+      4. least squares endpoints for those indices, keep them if the error drops
+
+    BC4 style single channel blocks (BC3 alpha, BC5) just use min / max.
+*/
+
+#include "myTextures/bc_codec.h"
+#include "myCore/job_pool.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define BC_X86 1
+#include <emmintrin.h>
+#endif
+
+/* one 4x4 block, channel-major so four texels fit an SSE register */
+struct bc_block
+{
+    float c[4][16];
+};
+
+/* the colours (or values) a block can choose between */
+struct bc_palette
+{
+    float entry[16][4];
+    int count;
+};
+
+static inline int clampi(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+static void load_block(const uint8_t* rgba, int width, int height, int bx, int by, bc_block* b)
+{
+    for (int i = 0; i < 16; i++)
+    {
+        /* partial edge blocks repeat the last row / column */
+        int x = clampi(bx * 4 + (i & 3), 0, width - 1);
+        int y = clampi(by * 4 + (i >> 2), 0, height - 1);
+        const uint8_t* p = rgba + ((size_t)y * width + x) * 4;
+        for (int c = 0; c < 4; c++)
+            b->c[c][i] = p[c];
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* palette matching, returns the summed squared error */
+
+static float select_indices_scalar(const bc_block& b, int channels, const bc_palette& pal, uint8_t* idx)
+{
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float best = 1e30f;
+        int best_k = 0;
+        for (int k = 0; k < pal.count; k++)
+        {
+            float d = 0.0f;
+            for (int c = 0; c < channels; c++)
+            {
+                float e = b.c[c][i] - pal.entry[k][c];
+                d += e * e;
+            }
+            if (d < best)
+            {
+                best = d;
+                best_k = k;
+            }
+        }
+        idx[i] = (uint8_t)best_k;
+        total += best;
+    }
+    return total;
+}
+
+#ifdef BC_X86
+static float select_indices_sse2(const bc_block& b, int channels, const bc_palette& pal, uint8_t* idx)
+{
+    __m128 total = _mm_setzero_ps();
+
+    for (int i = 0; i < 16; i += 4)
+    {
+        __m128 best = _mm_set1_ps(1e30f);
+        __m128i best_k = _mm_setzero_si128();
+
+        for (int k = 0; k < pal.count; k++)
+        {
+            __m128 d = _mm_setzero_ps();
+            for (int c = 0; c < channels; c++)
+            {
+                __m128 e = _mm_sub_ps(_mm_loadu_ps(&b.c[c][i]), _mm_set1_ps(pal.entry[k][c]));
+                d = _mm_add_ps(d, _mm_mul_ps(e, e));
+            }
+
+            /* strictly closer wins, so ties keep the lower index like the scalar loop */
+            __m128i closer = _mm_castps_si128(_mm_cmplt_ps(d, best));
+            best = _mm_min_ps(d, best);
+            best_k = _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32(k)), _mm_andnot_si128(closer, best_k));
+        }
+
+        int32_t k4[4];
+        _mm_storeu_si128((__m128i*)k4, best_k);
+        for (int j = 0; j < 4; j++)
+            idx[i + j] = (uint8_t)k4[j];
+        total = _mm_add_ps(total, best);
+    }
+
+    float t[4];
+    _mm_storeu_ps(t, total);
+    return (t[0] + t[1]) + (t[2] + t[3]);
+}
+#endif
+
+static float select_indices(const bc_block& b, int channels, const bc_palette& pal, uint8_t* idx, bool simd)
+{
+#ifdef BC_X86
+    if (simd)
+        return select_indices_sse2(b, channels, pal, idx);
+#endif
+    (void)simd;
+    return select_indices_scalar(b, channels, pal, idx);
+}
+
+/* ------------------------------------------------------------------------ */
+/* endpoint fitting */
+
+static void principal_axis(const bc_block& b, int channels, float mean[4], float axis[4])
+{
+    for (int c = 0; c < 4; c++)
+    {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+    for (int c = 0; c < channels; c++)
+    {
+        for (int i = 0; i < 16; i++)
+            mean[c] += b.c[c][i];
+        mean[c] /= 16.0f;
+    }
+
+    float cov[4][4] = { { 0 } };
+    for (int i = 0; i < 16; i++)
+        for (int r = 0; r < channels; r++)
+            for (int c = 0; c < channels; c++)
+                cov[r][c] += (b.c[r][i] - mean[r]) * (b.c[c][i] - mean[c]);
+
+    /* start from the channel that varies most, a few power iterations settle it */
+    int widest = 0;
+    for (int c = 1; c < channels; c++)
+        widest = cov[c][c] > cov[widest][widest] ? c : widest;
+    axis[widest] = 1.0f;
+
+    for (int iter = 0; iter < 8; iter++)
+    {
+        float next[4] = { 0 };
+        for (int r = 0; r < channels; r++)
+            for (int c = 0; c < channels; c++)
+                next[r] += cov[r][c] * axis[c];
+
+        float len = 0.0f;
+        for (int c = 0; c < channels; c++)
+            len += next[c] * next[c];
+        if (len < 1e-12f)
+            break; // flat block, any axis will do
+
+        len = 1.0f / sqrtf(len);
+        for (int c = 0; c < channels; c++)
+            axis[c] = next[c] * len;
+    }
+}
+
+static void axis_endpoints(const bc_block& b, int channels, float e0[4], float e1[4])
+{
+    float mean[4], axis[4];
+    principal_axis(b, channels, mean, axis);
+
+    float lo = 1e30f, hi = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (b.c[c][i] - mean[c]) * axis[c];
+        lo = t < lo ? t : lo;
+        hi = t > hi ? t : hi;
+    }
+
+    /* pull the ends in a touch, the extremes are rarely worth an exact hit */
+    float inset = (hi - lo) / 32.0f;
+    lo += inset;
+    hi -= inset;
+
+    for (int c = 0; c < 4; c++)
+    {
+        float a = c < channels ? mean[c] + axis[c] * hi : 255.0f;
+        float z = c < channels ? mean[c] + axis[c] * lo : 255.0f;
+        e0[c] = a < 0.0f ? 0.0f : (a > 255.0f ? 255.0f : a);
+        e1[c] = z < 0.0f ? 0.0f : (z > 255.0f ? 255.0f : z);
+    }
+}
+
+/* least squares endpoints for fixed indices, weight[k] is how much of e1 palette entry k holds */
+static bool refine_endpoints(const bc_block& b, int channels, const uint8_t* idx, const float* weight, float e0[4], float e1[4])
+{
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f;
+    float ax[4] = { 0 }, bx[4] = { 0 };
+
+    for (int i = 0; i < 16; i++)
+    {
+        float w1 = weight[idx[i]];
+        float w0 = 1.0f - w1;
+        aa += w0 * w0;
+        bb += w1 * w1;
+        ab += w0 * w1;
+        for (int c = 0; c < channels; c++)
+        {
+            ax[c] += w0 * b.c[c][i];
+            bx[c] += w1 * b.c[c][i];
+        }
+    }
+
+    float det = aa * bb - ab * ab;
+    if (fabsf(det) < 1e-6f)
+        return false;
+
+    det = 1.0f / det;
+    for (int c = 0; c < channels; c++)
+    {
+        float a = (ax[c] * bb - bx[c] * ab) * det;
+        float z = (bx[c] * aa - ax[c] * ab) * det;
+        e0[c] = a < 0.0f ? 0.0f : (a > 255.0f ? 255.0f : a);
+        e1[c] = z < 0.0f ? 0.0f : (z > 255.0f ? 255.0f : z);
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------------ */
+/* BC1 colour */
+
+static uint16_t pack_565(const float c[4])
+{
+    int r = (int)(c[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(c[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(c[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t v, int out[3])
+{
+    int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(uint16_t c0, uint16_t c1, int pal[4][3])
+{
+    unpack_565(c0, pal[0]);
+    unpack_565(c1, pal[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        pal[2][c] = (2 * pal[0][c] + pal[1][c]) / 3;
+        pal[3][c] = (pal[0][c] + 2 * pal[1][c]) / 3;
+    }
+}
+
+static float bc1_try(const bc_block& b, uint16_t c0, uint16_t c1, uint8_t* idx, bool simd)
+{
+    int p[4][3];
+    bc1_palette(c0, c1, p);
+
+    bc_palette pal;
+    pal.count = 4;
+    for (int k = 0; k < 4; k++)
+        for (int c = 0; c < 3; c++)
+            pal.entry[k][c] = (float)p[k][c];
+
+    return select_indices(b, 3, pal, idx, simd);
+}
+
+static void encode_bc1_block(const bc_block& b, uint8_t* out, bool simd)
+{
+    static const float weight[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+    float e0[4], e1[4];
+    axis_endpoints(b, 3, e0, e1);
+
+    uint16_t c0 = pack_565(e0), c1 = pack_565(e1);
+    uint8_t idx[16];
+    float err = bc1_try(b, c0, c1, idx, simd);
+
+    uint8_t idx2[16];
+    if (refine_endpoints(b, 3, idx, weight, e0, e1))
+    {
+        uint16_t r0 = pack_565(e0), r1 = pack_565(e1);
+        float err2 = bc1_try(b, r0, r1, idx2, simd);
+        if (err2 < err)
+        {
+            c0 = r0;
+            c1 = r1;
+            memcpy(idx, idx2, 16);
+        }
+    }
+
+    /* four colour mode needs c0 > c1: swap the ends (0<->1, 2<->3) if needed */
+    if (c0 < c1)
+    {
+        uint16_t t = c0;
+        c0 = c1;
+        c1 = t;
+        for (int i = 0; i < 16; i++)
+            idx[i] ^= 1;
+    }
+    if (c0 == c1)
+        memset(idx, 0, 16);
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint32_t)idx[i] << (2 * i);
+
+    out[0] = (uint8_t)c0;
+    out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1;
+    out[3] = (uint8_t)(c1 >> 8);
+    out[4] = (uint8_t)bits;
+    out[5] = (uint8_t)(bits >> 8);
+    out[6] = (uint8_t)(bits >> 16);
+    out[7] = (uint8_t)(bits >> 24);
+}
+
+static void decode_bc1_block(const uint8_t* in, uint8_t texels[16][4], bool allow_three_colour)
+{
+    uint16_t c0 = (uint16_t)(in[0] | (in[1] << 8));
+    uint16_t c1 = (uint16_t)(in[2] | (in[3] << 8));
+    uint32_t bits = in[4] | (in[5] << 8) | (in[6] << 16) | ((uint32_t)in[7] << 24);
+
+    int pal[4][3];
+    int alpha[4] = { 255, 255, 255, 255 };
+    bc1_palette(c0, c1, pal);
+
+    if (allow_three_colour && c0 <= c1)
+    {
+        int p0[3], p1[3];
+        unpack_565(c0, p0);
+        unpack_565(c1, p1);
+        for (int c = 0; c < 3; c++)
+        {
+            pal[2][c] = (p0[c] + p1[c]) / 2;
+            pal[3][c] = 0;
+        }
+        alpha[3] = 0;
+    }
+
+    for (int i = 0; i < 16; i++)
+    {
+        int k = (bits >> (2 * i)) & 3;
+        texels[i][0] = (uint8_t)pal[k][0];
+        texels[i][1] = (uint8_t)pal[k][1];
+        texels[i][2] = (uint8_t)pal[k][2];
+        texels[i][3] = (uint8_t)alpha[k];
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* BC4 single channel (BC3 alpha, BC5 red / green) */
+
+static void bc4_palette(int a0, int a1, int pal[8])
+{
+    pal[0] = a0;
+    pal[1] = a1;
+    if (a0 > a1)
+    {
+        for (int i = 2; i < 8; i++)
+            pal[i] = ((8 - i) * a0 + (i - 1) * a1) / 7;
+    }
+    else
+    {
+        for (int i = 2; i < 6; i++)
+            pal[i] = ((6 - i) * a0 + (i - 1) * a1) / 5;
+        pal[6] = 0;
+        pal[7] = 255;
+    }
+}
+
+static void encode_bc4_block(const bc_block& b, int channel, uint8_t* out, bool simd)
+{
+    float lo = 255.0f, hi = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        lo = b.c[channel][i] < lo ? b.c[channel][i] : lo;
+        hi = b.c[channel][i] > hi ? b.c[channel][i] : hi;
+    }
+
+    int a0 = (int)(hi + 0.5f), a1 = (int)(lo + 0.5f);
+    uint8_t idx[16] = { 0 };
+
+    if (a0 > a1)
+    {
+        /* match against the 8 entry ramp, with the channel moved to slot 0 */
+        bc_block one;
+        memcpy(one.c[0], b.c[channel], sizeof(one.c[0]));
+
+        int p[8];
+        bc4_palette(a0, a1, p);
+
+        bc_palette pal;
+        pal.count = 8;
+        for (int k = 0; k < 8; k++)
+            pal.entry[k][0] = (float)p[k];
+
+        select_indices(one, 1, pal, idx, simd);
+    }
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint64_t)idx[i] << (3 * i);
+
+    out[0] = (uint8_t)a0;
+    out[1] = (uint8_t)a1;
+    for (int i = 0; i < 6; i++)
+        out[2 + i] = (uint8_t)(bits >> (8 * i));
+}
+
+static void decode_bc4_block(const uint8_t* in, uint8_t texels[16][4], int channel)
+{
+    int pal[8];
+    bc4_palette(in[0], in[1], pal);
+
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t)in[2 + i] << (8 * i);
+
+    for (int i = 0; i < 16; i++)
+        texels[i][channel] = (uint8_t)pal[(bits >> (3 * i)) & 7];
+}
+
+/* ------------------------------------------------------------------------ */
+/* BC7, mode 6 only: RGBA 7 bit endpoints + a p-bit each, 4 bit indices */
+
+static const int s_bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+struct bc7_endpoint
+{
+    int q[4];   // 7 bit
+    int p;      // shared low bit
+};
+
+static bc7_endpoint bc7_quantize(const float e[4])
+{
+    bc7_endpoint best;
+    float best_err = 1e30f;
+
+    for (int p = 0; p < 2; p++)
+    {
+        bc7_endpoint t;
+        float err = 0.0f;
+        t.p = p;
+        for (int c = 0; c < 4; c++)
+        {
+            t.q[c] = clampi((int)floorf((e[c] - p) * 0.5f + 0.5f), 0, 127);
+            float d = (float)((t.q[c] << 1) | p) - e[c];
+            err += d * d;
+        }
+        if (err < best_err)
+        {
+            best_err = err;
+            best = t;
+        }
+    }
+    return best;
+}
+
+static void bc7_palette(const bc7_endpoint& a, const bc7_endpoint& b, int pal[16][4])
+{
+    for (int c = 0; c < 4; c++)
+    {
+        int e0 = (a.q[c] << 1) | a.p;
+        int e1 = (b.q[c] << 1) | b.p;
+        for (int k = 0; k < 16; k++)
+            pal[k][c] = ((64 - s_bc7_weights[k]) * e0 + s_bc7_weights[k] * e1 + 32) >> 6;
+    }
+}
+
+static float bc7_try(const bc_block& b, const bc7_endpoint& e0, const bc7_endpoint& e1, uint8_t* idx, bool simd)
+{
+    int p[16][4];
+    bc7_palette(e0, e1, p);
+
+    bc_palette pal;
+    pal.count = 16;
+    for (int k = 0; k < 16; k++)
+        for (int c = 0; c < 4; c++)
+            pal.entry[k][c] = (float)p[k][c];
+
+    return select_indices(b, 4, pal, idx, simd);
+}
+
+/* little bit writer / reader for the 128 bit block */
+static void put_bits(uint8_t* out, int& pos, uint32_t value, int count)
+{
+    for (int i = 0; i < count; i++, pos++)
+    {
+        if (value & (1u << i))
+            out[pos >> 3] |= (uint8_t)(1u << (pos & 7));
+    }
+}
+
+static uint32_t get_bits(const uint8_t* in, int& pos, int count)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++, pos++)
+        value |= (uint32_t)((in[pos >> 3] >> (pos & 7)) & 1) << i;
+    return value;
+}
+
+static void encode_bc7_block(const bc_block& b, uint8_t* out, bool simd)
+{
+    float weight[16];
+    for (int k = 0; k < 16; k++)
+        weight[k] = s_bc7_weights[k] / 64.0f;
+
+    float f0[4], f1[4];
+    axis_endpoints(b, 4, f0, f1);
+
+    bc7_endpoint e0 = bc7_quantize(f0), e1 = bc7_quantize(f1);
+    uint8_t idx[16];
+    float err = bc7_try(b, e0, e1, idx, simd);
+
+    uint8_t idx2[16];
+    if (refine_endpoints(b, 4, idx, weight, f0, f1))
+    {
+        bc7_endpoint r0 = bc7_quantize(f0), r1 = bc7_quantize(f1);
+        float err2 = bc7_try(b, r0, r1, idx2, simd);
+        if (err2 < err)
+        {
+            e0 = r0;
+            e1 = r1;
+            memcpy(idx, idx2, 16);
+        }
+    }
+
+    /* the anchor (texel 0) only has 3 index bits, so its top bit must be clear */
+    if (idx[0] & 8)
+    {
+        bc7_endpoint t = e0;
+        e0 = e1;
+        e1 = t;
+        for (int i = 0; i < 16; i++)
+            idx[i] = (uint8_t)(15 - idx[i]);
+    }
+
+    memset(out, 0, 16);
+    int pos = 0;
+    put_bits(out, pos, 1u << 6, 7);    // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        put_bits(out, pos, e0.q[c], 7);
+        put_bits(out, pos, e1.q[c], 7);
+    }
+    put_bits(out, pos, e0.p, 1);
+    put_bits(out, pos, e1.p, 1);
+    put_bits(out, pos, idx[0], 3);
+    for (int i = 1; i < 16; i++)
+        put_bits(out, pos, idx[i], 4);
+}
+
+static bool decode_bc7_block(const uint8_t* in, uint8_t texels[16][4])
+{
+    int pos = 0;
+    if (get_bits(in, pos, 7) != (1u << 6))
+        return false;
+
+    bc7_endpoint e0, e1;
+    for (int c = 0; c < 4; c++)
+    {
+        e0.q[c] = (int)get_bits(in, pos, 7);
+        e1.q[c] = (int)get_bits(in, pos, 7);
+    }
+    e0.p = (int)get_bits(in, pos, 1);
+    e1.p = (int)get_bits(in, pos, 1);
+
+    int pal[16][4];
+    bc7_palette(e0, e1, pal);
+
+    for (int i = 0; i < 16; i++)
+    {
+        int k = (int)get_bits(in, pos, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+            texels[i][c] = (uint8_t)pal[k][c];
+    }
+    return true;
+}
+
+/* ------------------------------------------------------------------------ */
+
+const char* bc_format_name(bc_format format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return "BC1";
+    case BC_FORMAT_BC3: return "BC3";
+    case BC_FORMAT_BC5: return "BC5";
+    case BC_FORMAT_BC7: return "BC7";
+    }
+    return "?";
+}
+
+GLenum bc_gl_internal_format(bc_format format)
+{
+    switch (format)
+    {
+    case BC_FORMAT_BC1: return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+    case BC_FORMAT_BC3: return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    case BC_FORMAT_BC5: return GL_COMPRESSED_RG_RGTC2;
+    case BC_FORMAT_BC7: return GL_COMPRESSED_RGBA_BPTC_UNORM;
+    }
+    return 0;
+}
+
+size_t bc_block_bytes(bc_format format)
+{
+    return format == BC_FORMAT_BC1 ? 8 : 16;
+}
+
+size_t bc_image_bytes(bc_format format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * bc_block_bytes(format);
+}
+
+struct bc_encode_job
+{
+    bc_format format;
+    const uint8_t* rgba;
+    int width, height;
+    uint8_t* out;
+    bool simd;
+};
+
+static void encode_block_rows(void* user, int begin, int end)
+{
+    bc_encode_job* job = (bc_encode_job*)user;
+    int blocks_x = (job->width + 3) / 4;
+    size_t block_bytes = bc_block_bytes(job->format);
+
+    for (int by = begin; by < end; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            bc_block b;
+            load_block(job->rgba, job->width, job->height, bx, by, &b);
+
+            uint8_t* out = job->out + ((size_t)by * blocks_x + bx) * block_bytes;
+            switch (job->format)
+            {
+            case BC_FORMAT_BC1:
+                encode_bc1_block(b, out, job->simd);
+                break;
+            case BC_FORMAT_BC3:
+                encode_bc4_block(b, 3, out, job->simd);
+                encode_bc1_block(b, out + 8, job->simd);
+                break;
+            case BC_FORMAT_BC5:
+                encode_bc4_block(b, 0, out, job->simd);
+                encode_bc4_block(b, 1, out + 8, job->simd);
+                break;
+            case BC_FORMAT_BC7:
+                encode_bc7_block(b, out, job->simd);
+                break;
+            }
+        }
+    }
+}
+
+void bc_encode_image(bc_format format, const uint8_t* rgba, int width, int height,
+                     uint8_t* out, job_pool* pool, bool simd)
+{
+    bc_encode_job job = { format, rgba, width, height, out, simd };
+    job_pool_parallel_for(pool, (height + 3) / 4, 4, encode_block_rows, &job);
+}
+
+bool bc_decode_image(bc_format format, const uint8_t* blocks, int width, int height, uint8_t* rgba)
+{
+    int blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    size_t block_bytes = bc_block_bytes(format);
+
+    for (int by = 0; by < blocks_y; by++)
+    {
+        for (int bx = 0; bx < blocks_x; bx++)
+        {
+            const uint8_t* in = blocks + ((size_t)by * blocks_x + bx) * block_bytes;
+            uint8_t texels[16][4];
+
+            switch (format)
+            {
+            case BC_FORMAT_BC1:
+                decode_bc1_block(in, texels, true);
+                break;
+            case BC_FORMAT_BC3:
+                decode_bc1_block(in + 8, texels, false);
+                decode_bc4_block(in, texels, 3);
+                break;
+            case BC_FORMAT_BC5:
+                decode_bc4_block(in, texels, 0);
+                decode_bc4_block(in + 8, texels, 1);
+                for (int i = 0; i < 16; i++)
+                {
+                    texels[i][2] = 0;
+                    texels[i][3] = 255;
+                }
+                break;
+            case BC_FORMAT_BC7:
+                if (!decode_bc7_block(in, texels))
+                    return false;
+                break;
+            }
+
+            for (int i = 0; i < 16; i++)
+            {
+                int x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if (x < width && y < height)
+                    memcpy(rgba + ((size_t)y * width + x) * 4, texels[i], 4);
+            }
+        }
+    }
+    return true;
+}
+
+double bc_psnr(bc_format format, const uint8_t* original, const uint8_t* decoded, int width, int height)
+{
+    /* BC1 has no alpha, BC5 only red and green */
+    int channels = format == BC_FORMAT_BC1 ? 3 : (format == BC_FORMAT_BC5 ? 2 : 4);
+
+    double sum = 0.0;
+    size_t count = (size_t)width * height;
+    for (size_t i = 0; i < count; i++)
+    {
+        for (int c = 0; c < channels; c++)
+        {
+            double d = (double)original[i * 4 + c] - decoded[i * 4 + c];
+            sum += d * d;
+        }
+    }
+
+    double mse = sum / ((double)count * channels);
+    if (mse <= 0.0)
+        return 99.0;
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
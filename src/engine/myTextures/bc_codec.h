@@ -0,0 +1,45 @@
+/*
+    block compression (BC1 / BC3 / BC5 / BC7) encoder and reference decoder
+    ----------------------------
+    the encoder is meant for offline cooking (see tools/texture_cooker.cpp):
+    endpoints come from the principal axis of each 4x4 block, followed by one
+    least squares refinement pass. palette matching runs four texels at a time
+    with SSE2 where available, and block rows are spread over a job_pool.
+
+    BC7 blocks are always written in mode 6 (one subset, RGBA, 4 bit indices),
+    and the decoder only understands what the encoder writes.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+struct job_pool;
+
+enum bc_format
+{
+    BC_FORMAT_BC1,  // RGB, 4 bpp
+    BC_FORMAT_BC3,  // RGBA (BC4 alpha + BC1 colour), 8 bpp
+    BC_FORMAT_BC5,  // two channels (RG), 8 bpp, for normal maps
+    BC_FORMAT_BC7   // RGBA, 8 bpp, best quality
+};
+
+const char* bc_format_name(bc_format format);
+GLenum bc_gl_internal_format(bc_format format);
+
+/* 8 bytes (BC1) or 16 bytes (everything else) per 4x4 block */
+size_t bc_block_bytes(bc_format format);
+size_t bc_image_bytes(bc_format format, int width, int height);
+
+/* rgba is tightly packed RGBA8, out receives bc_image_bytes(); pool may be NULL */
+void bc_encode_image(bc_format format, const uint8_t* rgba, int width, int height,
+                     uint8_t* out, job_pool* pool, bool simd = true);
+
+/* expands blocks back to RGBA8, false for BC7 modes the encoder never emits */
+bool bc_decode_image(bc_format format, const uint8_t* blocks, int width, int height, uint8_t* rgba);
+
+/* peak signal to noise ratio (dB) over the channels the format stores */
+double bc_psnr(bc_format format, const uint8_t* original, const uint8_t* decoded, int width, int height);
@@ -0,0 +1,218 @@
+/*
+    KTX (version 1.1) container reading and writing
+    ----------------------------
+    layout: 12 byte identifier, 13 uint32 header fields, key/value pairs,
+    then for each level a uint32 image size followed by the texels. every
+    section is padded to 4 bytes. only little endian files are accepted.
+*/
+
+#include "myTextures/ktx.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const uint8_t s_identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+enum ktx_header_field
+{
+    KTX_ENDIANNESS,
+    KTX_GL_TYPE,
+    KTX_GL_TYPE_SIZE,
+    KTX_GL_FORMAT,
+    KTX_GL_INTERNAL_FORMAT,
+    KTX_GL_BASE_INTERNAL_FORMAT,
+    KTX_PIXEL_WIDTH,
+    KTX_PIXEL_HEIGHT,
+    KTX_PIXEL_DEPTH,
+    KTX_ARRAY_ELEMENTS,
+    KTX_FACES,
+    KTX_MIP_LEVELS,
+    KTX_KEY_VALUE_BYTES,
+    KTX_HEADER_FIELDS
+};
+
+static inline size_t pad4(size_t v)
+{
+    return (v + 3) & ~(size_t)3;
+}
+
+static inline uint32_t read_u32(const uint8_t* p)
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+bool ktx_is_compressed(const ktx_texture& ktx)
+{
+    return ktx.gl_type == 0;
+}
+
+bool ktx_parse(const uint8_t* bytes, size_t size, ktx_texture* out)
+{
+    const size_t header_size = sizeof(s_identifier) + KTX_HEADER_FIELDS * 4;
+    if (size < header_size || memcmp(bytes, s_identifier, sizeof(s_identifier)) != 0)
+        return false;
+
+    uint32_t h[KTX_HEADER_FIELDS];
+    for (int i = 0; i < KTX_HEADER_FIELDS; i++)
+        h[i] = read_u32(bytes + sizeof(s_identifier) + i * 4);
+
+    if (h[KTX_ENDIANNESS] != 0x04030201)
+        return false;
+
+    /* plain 2D only: no arrays, cube maps or volumes */
+    if (h[KTX_PIXEL_DEPTH] > 1 || h[KTX_ARRAY_ELEMENTS] != 0 || h[KTX_FACES] != 1)
+        return false;
+
+    out->gl_type = h[KTX_GL_TYPE];
+    out->gl_format = h[KTX_GL_FORMAT];
+    out->gl_internal_format = h[KTX_GL_INTERNAL_FORMAT];
+    out->gl_base_internal_format = h[KTX_GL_BASE_INTERNAL_FORMAT];
+    out->width = (int)h[KTX_PIXEL_WIDTH];
+    out->height = h[KTX_PIXEL_HEIGHT] ? (int)h[KTX_PIXEL_HEIGHT] : 1;
+    out->levels = h[KTX_MIP_LEVELS] ? (int)h[KTX_MIP_LEVELS] : 1;
+    if (out->levels > MIP_MAX_LEVELS)
+        return false;
+
+    size_t pos = header_size;
+    size_t kv_end = pos + h[KTX_KEY_VALUE_BYTES];
+    if (kv_end > size)
+        return false;
+
+    out->key_values.clear();
+    while (pos + 4 <= kv_end)
+    {
+        uint32_t length = read_u32(bytes + pos);
+        pos += 4;
+        if (pos + length > kv_end)
+            return false;
+
+        /* "key\0value", the value may carry its own trailing \0 */
+        const char* kv = (const char*)bytes + pos;
+        size_t key_length = strnlen(kv, length);
+        std::string key(kv, key_length);
+        std::string value;
+        if (key_length + 1 < length)
+        {
+            value.assign(kv + key_length + 1, length - key_length - 1);
+            if (!value.empty() && value[value.size() - 1] == '\0')
+                value.resize(value.size() - 1);
+        }
+        out->key_values.push_back(std::make_pair(key, value));
+
+        pos += pad4(length);
+    }
+    pos = kv_end;
+
+    for (int l = 0; l < out->levels; l++)
+    {
+        if (pos + 4 > size)
+            return false;
+
+        uint32_t image_size = read_u32(bytes + pos);
+        pos += 4;
+        if (pos + image_size > size)
+            return false;
+
+        out->level_data[l] = bytes + pos;
+        out->level_size[l] = image_size;
+        pos += pad4(image_size);
+    }
+
+    return true;
+}
+
+bool ktx_load_file(const char* path, ktx_texture* out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->storage.resize(size > 0 ? (size_t)size : 0);
+    size_t got = size > 0 ? fread(&out->storage[0], 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    if (size <= 0 || got != (size_t)size)
+        return false;
+
+    return ktx_parse(&out->storage[0], out->storage.size(), out);
+}
+
+std::string ktx_find_value(const ktx_texture& ktx, const char* key)
+{
+    for (size_t i = 0; i < ktx.key_values.size(); i++)
+    {
+        if (ktx.key_values[i].first == key)
+            return ktx.key_values[i].second;
+    }
+    return std::string();
+}
+
+static bool write_u32(FILE* f, uint32_t v)
+{
+    return fwrite(&v, 4, 1, f) == 1;
+}
+
+static bool write_padding(FILE* f, size_t written)
+{
+    static const uint8_t zeros[4] = { 0, 0, 0, 0 };
+    size_t pad = pad4(written) - written;
+    return pad == 0 || fwrite(zeros, 1, pad, f) == pad;
+}
+
+bool ktx_write_file(const char* path, const ktx_texture& ktx)
+{
+    FILE* f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    size_t kv_bytes = 0;
+    for (size_t i = 0; i < ktx.key_values.size(); i++)
+        kv_bytes += 4 + pad4(ktx.key_values[i].first.size() + 1 + ktx.key_values[i].second.size() + 1);
+
+    uint32_t h[KTX_HEADER_FIELDS];
+    h[KTX_ENDIANNESS] = 0x04030201;
+    h[KTX_GL_TYPE] = ktx.gl_type;
+    h[KTX_GL_TYPE_SIZE] = ktx.gl_type == GL_UNSIGNED_BYTE || ktx.gl_type == 0 ? 1 : 4;
+    h[KTX_GL_FORMAT] = ktx.gl_format;
+    h[KTX_GL_INTERNAL_FORMAT] = ktx.gl_internal_format;
+    h[KTX_GL_BASE_INTERNAL_FORMAT] = ktx.gl_base_internal_format;
+    h[KTX_PIXEL_WIDTH] = ktx.width;
+    h[KTX_PIXEL_HEIGHT] = ktx.height;
+    h[KTX_PIXEL_DEPTH] = 0;
+    h[KTX_ARRAY_ELEMENTS] = 0;
+    h[KTX_FACES] = 1;
+    h[KTX_MIP_LEVELS] = ktx.levels;
+    h[KTX_KEY_VALUE_BYTES] = (uint32_t)kv_bytes;
+
+    bool ok = fwrite(s_identifier, sizeof(s_identifier), 1, f) == 1;
+    for (int i = 0; i < KTX_HEADER_FIELDS && ok; i++)
+        ok = write_u32(f, h[i]);
+
+    for (size_t i = 0; i < ktx.key_values.size() && ok; i++)
+    {
+        const std::string& key = ktx.key_values[i].first;
+        const std::string& value = ktx.key_values[i].second;
+        size_t length = key.size() + 1 + value.size() + 1;
+
+        ok = write_u32(f, (uint32_t)length)
+            && fwrite(key.c_str(), key.size() + 1, 1, f) == 1
+            && fwrite(value.c_str(), value.size() + 1, 1, f) == 1
+            && write_padding(f, length);
+    }
+
+    for (int l = 0; l < ktx.levels && ok; l++)
+    {
+        ok = write_u32(f, (uint32_t)ktx.level_size[l])
+            && fwrite(ktx.level_data[l], 1, ktx.level_size[l], f) == ktx.level_size[l]
+            && write_padding(f, ktx.level_size[l]);
+    }
+
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
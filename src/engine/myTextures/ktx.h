@@ -0,0 +1,47 @@
+/*
+    KTX (version 1.1) container reading and writing
+    ----------------------------
+    just enough of the format for 2D textures with a mip chain, compressed
+    (glType == 0) or not. parsing never copies texel data: level pointers
+    aim straight into the bytes handed to ktx_parse, which must outlive them.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "myTextures/mip_builder.h"
+
+struct ktx_texture
+{
+    GLenum gl_type;                 // 0 for compressed formats
+    GLenum gl_format;               // 0 for compressed formats
+    GLenum gl_internal_format;
+    GLenum gl_base_internal_format;
+    int width, height, levels;
+
+    const uint8_t* level_data[MIP_MAX_LEVELS];
+    size_t level_size[MIP_MAX_LEVELS];
+
+    std::vector<std::pair<std::string, std::string> > key_values;
+
+    std::vector<uint8_t> storage;   // file contents, when loaded by ktx_load_file
+};
+
+bool ktx_is_compressed(const ktx_texture& ktx);
+
+/* level pointers reference bytes, nothing is copied */
+bool ktx_parse(const uint8_t* bytes, size_t size, ktx_texture* out);
+
+/* reads the whole file into out->storage, then parses it */
+bool ktx_load_file(const char* path, ktx_texture* out);
+
+/* empty string when the key isn't there */
+std::string ktx_find_value(const ktx_texture& ktx, const char* key);
+
+bool ktx_write_file(const char* path, const ktx_texture& ktx);
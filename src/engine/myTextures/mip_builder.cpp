@@ -0,0 +1,506 @@
+/*
+    CPU mip chain generation
+    ----------------------------
+    each level is produced from the previous one, kept as linear float RGBA:
+
+      box:    dst(x,y) = average of the 2x2 block under it
+      kaiser: a horizontal then a vertical 8 tap pass (taps at -3.5 .. 3.5
+              source texels from the destination centre), clamped at the edges
+
+    float math keeps the SIMD paths honest: each one does the same adds and
+    multiplies as the scalar code, only several texels at a time.
+*/
+
+#include "myTextures/mip_builder.h"
+#include "myCore/job_pool.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define MIP_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define MIP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MIP_TARGET_AVX2
+#endif
+#endif
+
+#define KAISER_TAPS 8
+
+/* ------------------------------------------------------------------------ */
+/* colour space tables, built once */
+
+static float s_srgb_to_linear[256];
+static uint8_t s_linear_to_srgb[4096];
+static float s_kaiser[KAISER_TAPS];
+static bool s_tables_ready = false;
+static SDL_SpinLock s_tables_lock = 0;
+
+static double bessel_i0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+static void build_tables()
+{
+    SDL_AtomicLock(&s_tables_lock);
+    if (s_tables_ready)
+    {
+        SDL_AtomicUnlock(&s_tables_lock);
+        return;
+    }
+
+    for (int i = 0; i < 256; i++)
+    {
+        double c = i / 255.0;
+        s_srgb_to_linear[i] = (float)(c <= 0.04045 ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+    }
+
+    for (int i = 0; i < 4096; i++)
+    {
+        double l = i / 4095.0;
+        double c = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+        s_linear_to_srgb[i] = (uint8_t)(c * 255.0 + 0.5);
+    }
+
+    /* sinc at half the source rate, under a kaiser window (alpha 4) that spans all 8 taps */
+    const double pi = 3.14159265358979323846;
+    const double alpha = 4.0;
+    double total = 0.0;
+    double w[KAISER_TAPS];
+    for (int k = 0; k < KAISER_TAPS; k++)
+    {
+        double d = k - 3.5;              // distance in source texels
+        double x = d * 0.5;              // distance in destination texels
+        double sinc = sin(pi * x) / (pi * x);
+        double r = d / 4.0;              // -0.875 .. 0.875 of the window radius
+        double window = bessel_i0(alpha * sqrt(1.0 - r * r)) / bessel_i0(alpha);
+        w[k] = sinc * window;
+        total += w[k];
+    }
+    for (int k = 0; k < KAISER_TAPS; k++)
+        s_kaiser[k] = (float)(w[k] / total);
+
+    s_tables_ready = true;
+    SDL_AtomicUnlock(&s_tables_lock);
+}
+
+static inline uint8_t encode_channel(float v, bool srgb)
+{
+    if (v < 0.0f) v = 0.0f;
+    if (v > 1.0f) v = 1.0f;
+    if (srgb)
+        return s_linear_to_srgb[(int)(v * 4095.0f + 0.5f)];
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
+static inline void encode_row(const float* src, uint8_t* dst, int width, bool srgb)
+{
+    for (int x = 0; x < width; x++)
+    {
+        dst[0] = encode_channel(src[0], srgb);
+        dst[1] = encode_channel(src[1], srgb);
+        dst[2] = encode_channel(src[2], srgb);
+        dst[3] = encode_channel(src[3], false); // alpha is never gamma encoded
+        src += 4;
+        dst += 4;
+    }
+}
+
+static inline int clampi(int v, int lo, int hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/* ------------------------------------------------------------------------ */
+/* one level's worth of work, shared by every band */
+
+struct mip_pass
+{
+    const uint8_t* src8;    // level 0 only
+    const float* src;
+    float* tmp;             // kaiser: horizontally filtered rows, dw x sh
+    float* dst;
+    uint8_t* out8;
+    int sw, sh, dw, dh;
+    bool srgb;
+    mip_simd simd;
+};
+
+static void decode_rows(void* user, int begin, int end)
+{
+    mip_pass* p = (mip_pass*)user;
+    for (int y = begin; y < end; y++)
+    {
+        const uint8_t* s = p->src8 + (size_t)y * p->sw * 4;
+        float* d = p->dst + (size_t)y * p->sw * 4;
+        for (int x = 0; x < p->sw; x++)
+        {
+            d[0] = p->srgb ? s_srgb_to_linear[s[0]] : s[0] / 255.0f;
+            d[1] = p->srgb ? s_srgb_to_linear[s[1]] : s[1] / 255.0f;
+            d[2] = p->srgb ? s_srgb_to_linear[s[2]] : s[2] / 255.0f;
+            d[3] = s[3] / 255.0f;
+            s += 4;
+            d += 4;
+        }
+    }
+}
+
+/* --- box --- */
+
+static void box_row_scalar(const float* r0, const float* r1, float* d, int sw, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        int a = clampi(2 * x, 0, sw - 1) * 4;
+        int b = clampi(2 * x + 1, 0, sw - 1) * 4;
+        for (int c = 0; c < 4; c++)
+            d[x * 4 + c] = ((r0[a + c] + r0[b + c]) + (r1[a + c] + r1[b + c])) * 0.25f;
+    }
+}
+
+#ifdef MIP_X86
+static void box_row_sse2(const float* r0, const float* r1, float* d, int sw, int x0, int x1)
+{
+    const __m128 quarter = _mm_set1_ps(0.25f);
+    for (int x = x0; x < x1; x++)
+    {
+        int a = clampi(2 * x, 0, sw - 1) * 4;
+        int b = clampi(2 * x + 1, 0, sw - 1) * 4;
+        __m128 top = _mm_add_ps(_mm_loadu_ps(r0 + a), _mm_loadu_ps(r0 + b));
+        __m128 bottom = _mm_add_ps(_mm_loadu_ps(r1 + a), _mm_loadu_ps(r1 + b));
+        _mm_storeu_ps(d + x * 4, _mm_mul_ps(_mm_add_ps(top, bottom), quarter));
+    }
+}
+
+MIP_TARGET_AVX2
+static void box_row_avx2(const float* r0, const float* r1, float* d, int sw, int x0, int x1)
+{
+    const __m256 quarter = _mm256_set1_ps(0.25f);
+    int x = x0;
+
+    /* two destination texels per step, as long as all four sources are in range */
+    for (; x + 1 < x1 && 2 * x + 3 < sw; x += 2)
+    {
+        __m256 t01 = _mm256_loadu_ps(r0 + 2 * x * 4);       // s0 s1
+        __m256 t23 = _mm256_loadu_ps(r0 + 2 * x * 4 + 8);   // s2 s3
+        __m256 b01 = _mm256_loadu_ps(r1 + 2 * x * 4);
+        __m256 b23 = _mm256_loadu_ps(r1 + 2 * x * 4 + 8);
+
+        __m256 top = _mm256_add_ps(_mm256_permute2f128_ps(t01, t23, 0x20), _mm256_permute2f128_ps(t01, t23, 0x31));
+        __m256 bottom = _mm256_add_ps(_mm256_permute2f128_ps(b01, b23, 0x20), _mm256_permute2f128_ps(b01, b23, 0x31));
+        _mm256_storeu_ps(d + x * 4, _mm256_mul_ps(_mm256_add_ps(top, bottom), quarter));
+    }
+
+    box_row_sse2(r0, r1, d, sw, x, x1);
+}
+#endif
+
+static void box_rows(void* user, int begin, int end)
+{
+    mip_pass* p = (mip_pass*)user;
+    for (int y = begin; y < end; y++)
+    {
+        const float* r0 = p->src + (size_t)clampi(2 * y, 0, p->sh - 1) * p->sw * 4;
+        const float* r1 = p->src + (size_t)clampi(2 * y + 1, 0, p->sh - 1) * p->sw * 4;
+        float* d = p->dst + (size_t)y * p->dw * 4;
+
+        switch (p->simd)
+        {
+#ifdef MIP_X86
+        case MIP_SIMD_AVX2: box_row_avx2(r0, r1, d, p->sw, 0, p->dw); break;
+        case MIP_SIMD_SSE2: box_row_sse2(r0, r1, d, p->sw, 0, p->dw); break;
+#endif
+        default: box_row_scalar(r0, r1, d, p->sw, 0, p->dw); break;
+        }
+
+        encode_row(d, p->out8 + (size_t)y * p->dw * 4, p->dw, p->srgb);
+    }
+}
+
+/* --- kaiser, horizontal pass --- */
+
+static void kaiser_h_scalar(const float* s, float* d, int sw, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        float acc[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        for (int k = 0; k < KAISER_TAPS; k++)
+        {
+            const float* t = s + clampi(2 * x - 3 + k, 0, sw - 1) * 4;
+            for (int c = 0; c < 4; c++)
+                acc[c] = acc[c] + s_kaiser[k] * t[c];
+        }
+        memcpy(d + x * 4, acc, sizeof(acc));
+    }
+}
+
+#ifdef MIP_X86
+static void kaiser_h_sse2(const float* s, float* d, int sw, int x0, int x1)
+{
+    for (int x = x0; x < x1; x++)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < KAISER_TAPS; k++)
+        {
+            const float* t = s + clampi(2 * x - 3 + k, 0, sw - 1) * 4;
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(s_kaiser[k]), _mm_loadu_ps(t)));
+        }
+        _mm_storeu_ps(d + x * 4, acc);
+    }
+}
+
+MIP_TARGET_AVX2
+static void kaiser_h_avx2(const float* s, float* d, int sw, int x0, int x1)
+{
+    int x = x0;
+
+    /* edges need clamping, leave those to the sse2 loop */
+    int first = 2;                        // 2x - 3 >= 0
+    int last = (sw - 7) / 2;              // 2(x+1) + 4 <= sw - 1 for the second texel
+    if (first > x1) first = x1;
+
+    kaiser_h_sse2(s, d, sw, x, first);
+    x = first;
+
+    for (; x + 1 < x1 && x <= last; x += 2)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < KAISER_TAPS; k++)
+        {
+            /* low half feeds texel x, high half texel x + 1 */
+            __m256 t = _mm256_insertf128_ps(
+                _mm256_castps128_ps256(_mm_loadu_ps(s + (2 * x - 3 + k) * 4)),
+                _mm_loadu_ps(s + (2 * x - 1 + k) * 4), 1);
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(s_kaiser[k]), t));
+        }
+        _mm256_storeu_ps(d + x * 4, acc);
+    }
+
+    kaiser_h_sse2(s, d, sw, x, x1);
+}
+#endif
+
+static void kaiser_h_rows(void* user, int begin, int end)
+{
+    mip_pass* p = (mip_pass*)user;
+    for (int y = begin; y < end; y++)
+    {
+        const float* s = p->src + (size_t)y * p->sw * 4;
+        float* d = p->tmp + (size_t)y * p->dw * 4;
+
+        switch (p->simd)
+        {
+#ifdef MIP_X86
+        case MIP_SIMD_AVX2: kaiser_h_avx2(s, d, p->sw, 0, p->dw); break;
+        case MIP_SIMD_SSE2: kaiser_h_sse2(s, d, p->sw, 0, p->dw); break;
+#endif
+        default: kaiser_h_scalar(s, d, p->sw, 0, p->dw); break;
+        }
+    }
+}
+
+/* --- kaiser, vertical pass (rows are contiguous, so this is plain wide math) --- */
+
+static void kaiser_v_scalar(const float* const* rows, float* d, int j0, int count)
+{
+    for (int j = j0; j < count; j++)
+    {
+        float acc = 0.0f;
+        for (int k = 0; k < KAISER_TAPS; k++)
+            acc = acc + s_kaiser[k] * rows[k][j];
+        d[j] = acc;
+    }
+}
+
+#ifdef MIP_X86
+static void kaiser_v_sse2(const float* const* rows, float* d, int j0, int count)
+{
+    int j = j0;
+    for (; j + 4 <= count; j += 4)
+    {
+        __m128 acc = _mm_setzero_ps();
+        for (int k = 0; k < KAISER_TAPS; k++)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(s_kaiser[k]), _mm_loadu_ps(rows[k] + j)));
+        _mm_storeu_ps(d + j, acc);
+    }
+    kaiser_v_scalar(rows, d, j, count);
+}
+
+MIP_TARGET_AVX2
+static void kaiser_v_avx2(const float* const* rows, float* d, int j0, int count)
+{
+    int j = j0;
+    for (; j + 8 <= count; j += 8)
+    {
+        __m256 acc = _mm256_setzero_ps();
+        for (int k = 0; k < KAISER_TAPS; k++)
+            acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(s_kaiser[k]), _mm256_loadu_ps(rows[k] + j)));
+        _mm256_storeu_ps(d + j, acc);
+    }
+    kaiser_v_sse2(rows, d, j, count);
+}
+#endif
+
+static void kaiser_v_rows(void* user, int begin, int end)
+{
+    mip_pass* p = (mip_pass*)user;
+    for (int y = begin; y < end; y++)
+    {
+        const float* rows[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; k++)
+            rows[k] = p->tmp + (size_t)clampi(2 * y - 3 + k, 0, p->sh - 1) * p->dw * 4;
+
+        float* d = p->dst + (size_t)y * p->dw * 4;
+
+        switch (p->simd)
+        {
+#ifdef MIP_X86
+        case MIP_SIMD_AVX2: kaiser_v_avx2(rows, d, 0, p->dw * 4); break;
+        case MIP_SIMD_SSE2: kaiser_v_sse2(rows, d, 0, p->dw * 4); break;
+#endif
+        default: kaiser_v_scalar(rows, d, 0, p->dw * 4); break;
+        }
+
+        /* the window has negative lobes, keep the next level's input in range too */
+        for (int j = 0; j < p->dw * 4; j++)
+            d[j] = d[j] < 0.0f ? 0.0f : (d[j] > 1.0f ? 1.0f : d[j]);
+
+        encode_row(d, p->out8 + (size_t)y * p->dw * 4, p->dw, p->srgb);
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+
+int mip_level_count(int width, int height)
+{
+    int size = width > height ? width : height;
+    int levels = 1;
+    while (size > 1)
+    {
+        size >>= 1;
+        levels++;
+    }
+    return levels;
+}
+
+mip_simd mip_best_simd()
+{
+#ifdef MIP_X86
+    if (SDL_HasAVX2())
+        return MIP_SIMD_AVX2;
+    if (SDL_HasSSE2())
+        return MIP_SIMD_SSE2;
+#endif
+    return MIP_SIMD_SCALAR;
+}
+
+void mip_build(const uint8_t* rgba, int width, int height, int levels,
+               mip_filter filter, bool srgb, mip_simd simd,
+               job_pool* pool, mip_chain* out)
+{
+    build_tables();
+
+    int full = mip_level_count(width, height);
+    if (levels <= 0 || levels > full)
+        levels = full;
+    if (levels > MIP_MAX_LEVELS)
+        levels = MIP_MAX_LEVELS;
+
+    if (simd == MIP_SIMD_AUTO)
+        simd = mip_best_simd();
+#ifndef MIP_X86
+    simd = MIP_SIMD_SCALAR;
+#endif
+
+    /* lay out every level in one allocation */
+    size_t total = 0;
+    out->levels = levels;
+    for (int l = 0; l < levels; l++)
+    {
+        out->width[l] = width >> l ? width >> l : 1;
+        out->height[l] = height >> l ? height >> l : 1;
+        out->offset[l] = total;
+        total += (size_t)out->width[l] * out->height[l] * 4;
+    }
+    out->texels.resize(total);
+    memcpy(&out->texels[0], rgba, (size_t)width * height * 4); // level 0 is the source, untouched
+
+    if (levels == 1)
+        return;
+
+    /* ping-pong linear float levels, plus kaiser's intermediate */
+    std::vector<float> a((size_t)width * height * 4);
+    std::vector<float> b((size_t)out->width[1] * out->height[1] * 4);
+    std::vector<float> tmp;
+    if (filter == MIP_FILTER_KAISER)
+        tmp.resize((size_t)out->width[1] * height * 4);
+
+    mip_pass p;
+    memset(&p, 0, sizeof(p));
+    p.srgb = srgb;
+    p.simd = simd;
+
+    const int band = 16; // rows per job, keeps tiny levels on one thread
+
+    p.src8 = rgba;
+    p.dst = &a[0];
+    p.sw = width;
+    p.sh = height;
+    job_pool_parallel_for(pool, height, band, decode_rows, &p);
+
+    float* src = &a[0];
+    float* dst = &b[0];
+
+    for (int l = 1; l < levels; l++)
+    {
+        p.src = src;
+        p.dst = dst;
+        p.tmp = tmp.empty() ? NULL : &tmp[0];
+        p.out8 = &out->texels[out->offset[l]];
+        p.sw = out->width[l - 1];
+        p.sh = out->height[l - 1];
+        p.dw = out->width[l];
+        p.dh = out->height[l];
+
+        if (filter == MIP_FILTER_KAISER)
+        {
+            job_pool_parallel_for(pool, p.sh, band, kaiser_h_rows, &p);
+            job_pool_parallel_for(pool, p.dh, band, kaiser_v_rows, &p);
+        }
+        else
+        {
+            job_pool_parallel_for(pool, p.dh, band, box_rows, &p);
+        }
+
+        float* t = src;
+        src = dst;
+        dst = t;
+    }
+}
+
+int mip_chain_max_difference(const mip_chain& a, const mip_chain& b)
+{
+    if (a.levels != b.levels || a.texels.size() != b.texels.size())
+        return 256;
+
+    int worst = 0;
+    for (size_t i = 0; i < a.texels.size(); i++)
+    {
+        int d = abs((int)a.texels[i] - (int)b.texels[i]);
+        if (d > worst)
+            worst = d;
+    }
+    return worst;
+}
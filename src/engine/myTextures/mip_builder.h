@@ -0,0 +1,59 @@
+/*
+    CPU mip chain generation
+    ----------------------------
+    builds every level of an RGBA8 image down to 1x1, so textures can be
+    allocated with the full chain up front instead of leaning on
+    glGenerateMipmap at whatever moment the driver decides to do the work.
+
+    filtering happens on linear floats: sRGB colour is decoded before
+    averaging and re-encoded after, alpha is always linear. each level is
+    split into row bands that run across a job_pool. the scalar path is the
+    reference, SSE2 / AVX2 paths are picked at runtime and must stay within
+    one step (of 255) of it.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct job_pool;
+
+#define MIP_MAX_LEVELS 16
+
+enum mip_filter
+{
+    MIP_FILTER_BOX,     // 2x2 average, cheap
+    MIP_FILTER_KAISER   // 8 tap kaiser-windowed sinc, sharper, separable
+};
+
+enum mip_simd
+{
+    MIP_SIMD_AUTO,      // best the CPU supports
+    MIP_SIMD_SCALAR,
+    MIP_SIMD_SSE2,
+    MIP_SIMD_AVX2
+};
+
+struct mip_chain
+{
+    int levels;
+    int width[MIP_MAX_LEVELS];
+    int height[MIP_MAX_LEVELS];
+    size_t offset[MIP_MAX_LEVELS];  // byte offset of each level in texels
+    std::vector<uint8_t> texels;    // every level, RGBA8, tightly packed
+};
+
+/* 1 + floor(log2(max(width, height))), what glTexStorage2D wants */
+int mip_level_count(int width, int height);
+
+/* levels <= 0 builds the whole chain; pool may be NULL to stay on this thread */
+void mip_build(const uint8_t* rgba, int width, int height, int levels,
+               mip_filter filter, bool srgb, mip_simd simd,
+               job_pool* pool, mip_chain* out);
+
+/* largest per-channel difference between two chains (for checking against the scalar path) */
+int mip_chain_max_difference(const mip_chain& a, const mip_chain& b);
+
+/* which implementation MIP_SIMD_AUTO resolves to on this machine */
+mip_simd mip_best_simd();
@@ -0,0 +1,584 @@
+/*
+    SIMD pixel format conversion
+    ----------------------------
+    each conversion is a kernel that does a fixed block of pixels with whole
+    register loads and stores: pshufb spreads or gathers the channels, gray
+    is a pmaddwd dot product. blocks whose loads or stores would leave the
+    buffer are done by the scalar reference instead, which also settles the
+    order for in-place runs (back to front when the pixels grow).
+
+    AVX2 has its own kernels where they measured faster: gray and RGB
+    expansion, RGBA swaps and 16 -> 8. everything else stays on SSSE3.
+*/
+
+#include "myTextures/pixel_convert.h"
+
+#include <string.h>
+
+#include <stb_image.h>
+
+#include "SDL.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PIXEL_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define PIXEL_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PIXEL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PIXEL_TARGET_SSSE3
+#define PIXEL_TARGET_AVX2
+#endif
+#endif
+
+#define COMBO(src_n, dst_n) ((src_n) * 8 + (dst_n))
+
+/* dst / src already offset to the block, begin / end in pixels */
+typedef void (*span_func)(uint8_t* dst, const uint8_t* src, size_t begin, size_t end);
+
+/* ------------------------------------------------------------------------ */
+/* scalar reference, the same arithmetic as stb_image */
+
+static inline int luma(int r, int g, int b)
+{
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+/* reads the whole pixel before writing any of it, so dst may overlap src */
+template <int SRC, int DST>
+static inline void convert_pixel(uint8_t* d, const uint8_t* s)
+{
+    int r, g, b, a;
+    if (SRC <= 2)
+    {
+        r = g = b = s[0];
+        a = SRC == 2 ? s[1] : 255;
+    }
+    else
+    {
+        r = s[0];
+        g = s[1];
+        b = s[2];
+        a = SRC == 4 ? s[3] : 255;
+    }
+
+    int y = SRC >= 3 ? luma(r, g, b) : r;
+    switch (DST)
+    {
+    case 1:
+        d[0] = (uint8_t)y;
+        break;
+    case 2:
+        d[0] = (uint8_t)y;
+        d[1] = (uint8_t)a;
+        break;
+    case 3:
+        d[0] = (uint8_t)r;
+        d[1] = (uint8_t)g;
+        d[2] = (uint8_t)b;
+        break;
+    case 4:
+        d[0] = (uint8_t)r;
+        d[1] = (uint8_t)g;
+        d[2] = (uint8_t)b;
+        d[3] = (uint8_t)a;
+        break;
+    }
+}
+
+template <int SRC, int DST>
+static void convert_span(uint8_t* dst, const uint8_t* src, size_t begin, size_t end)
+{
+    if (DST > SRC)
+    {
+        for (size_t i = end; i-- > begin;)
+            convert_pixel<SRC, DST>(dst + i * DST, src + i * SRC);
+    }
+    else
+    {
+        for (size_t i = begin; i < end; i++)
+            convert_pixel<SRC, DST>(dst + i * DST, src + i * SRC);
+    }
+}
+
+template <int N>
+static void swap_span(uint8_t* dst, const uint8_t* src, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++)
+    {
+        uint8_t r = src[i * N], g = src[i * N + 1], b = src[i * N + 2];
+        dst[i * N] = b;
+        dst[i * N + 1] = g;
+        dst[i * N + 2] = r;
+        if (N == 4)
+            dst[i * N + 3] = src[i * N + 3];
+    }
+}
+
+/* src is 16 bit values in memory order; i is a value, not a byte */
+static void reduce_span(uint8_t* dst, const uint8_t* src, size_t begin, size_t end)
+{
+    const uint16_t* values = (const uint16_t*)src;
+    for (size_t i = begin; i < end; i++)
+        dst[i] = (uint8_t)(values[i] >> 8);
+}
+
+/* [src_n - 1][dst_n - 1], NULL on the diagonal */
+static const span_func s_convert_spans[4][4] = {
+    { NULL, convert_span<1, 2>, convert_span<1, 3>, convert_span<1, 4> },
+    { convert_span<2, 1>, NULL, convert_span<2, 3>, convert_span<2, 4> },
+    { convert_span<3, 1>, convert_span<3, 2>, NULL, convert_span<3, 4> },
+    { convert_span<4, 1>, convert_span<4, 2>, convert_span<4, 3>, NULL },
+};
+
+#ifdef PIXEL_X86
+
+/* ------------------------------------------------------------------------ */
+/* kernels: IN / OUT bytes per pixel, PIXELS per block, LOAD / STORE bytes touched per block */
+
+typedef void (*blocks_func)(uint8_t* dst, const uint8_t* src, size_t blocks);
+
+template <class K>
+static PIXEL_TARGET_SSSE3 void blocks_ssse3(uint8_t* dst, const uint8_t* src, size_t blocks)
+{
+    if (K::OUT > K::IN)
+        for (size_t k = blocks; k-- > 0;)
+            K::block(dst + k * K::PIXELS * K::OUT, src + k * K::PIXELS * K::IN);
+    else
+        for (size_t k = 0; k < blocks; k++)
+            K::block(dst + k * K::PIXELS * K::OUT, src + k * K::PIXELS * K::IN);
+}
+
+template <class K>
+static PIXEL_TARGET_AVX2 void blocks_avx2(uint8_t* dst, const uint8_t* src, size_t blocks)
+{
+    if (K::OUT > K::IN)
+        for (size_t k = blocks; k-- > 0;)
+            K::block(dst + k * K::PIXELS * K::OUT, src + k * K::PIXELS * K::IN);
+    else
+        for (size_t k = 0; k < blocks; k++)
+            K::block(dst + k * K::PIXELS * K::OUT, src + k * K::PIXELS * K::IN);
+}
+
+/*
+    as many whole blocks as stay inside both buffers, the rest scalar. growing
+    runs do the scalar end first and the blocks back to front, so in place
+    every block's source is still intact when it is read.
+*/
+template <class K>
+static void run(blocks_func blocks_fn, span_func scalar, uint8_t* dst, const uint8_t* src, size_t count)
+{
+    size_t blocks = count / K::PIXELS;
+    while (blocks && ((blocks - 1) * K::PIXELS * K::IN + K::LOAD > count * K::IN ||
+                      (blocks - 1) * K::PIXELS * K::OUT + K::STORE > count * K::OUT))
+        blocks--;
+
+    size_t done = blocks * K::PIXELS;
+    if (K::OUT > K::IN)
+    {
+        scalar(dst, src, done, count);
+        blocks_fn(dst, src, blocks);
+    }
+    else
+    {
+        blocks_fn(dst, src, blocks);
+        scalar(dst, src, done, count);
+    }
+}
+
+static PIXEL_TARGET_SSSE3 inline __m128i alpha_128()
+{
+    return _mm_set1_epi32((int)0xff000000);
+}
+
+struct gray_to_rgba_ssse3
+{
+    enum { IN = 1, OUT = 4, PIXELS = 16, LOAD = 16, STORE = 64 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)s);
+        /* -128 zeroes the alpha byte, still negative after adding 12 */
+        __m128i spread = _mm_setr_epi8(0, 0, 0, -128, 1, 1, 1, -128, 2, 2, 2, -128, 3, 3, 3, -128);
+        for (int q = 0; q < 4; q++)
+        {
+            __m128i mask = _mm_add_epi8(spread, _mm_set1_epi8((char)(q * 4)));
+            _mm_storeu_si128((__m128i*)(d + q * 16), _mm_or_si128(_mm_shuffle_epi8(v, mask), alpha_128()));
+        }
+    }
+};
+
+struct gray_alpha_to_rgba_ssse3
+{
+    enum { IN = 2, OUT = 4, PIXELS = 8, LOAD = 16, STORE = 32 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)s);
+        __m128i lo = _mm_shuffle_epi8(v, _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7));
+        __m128i hi = _mm_shuffle_epi8(v, _mm_setr_epi8(8, 8, 8, 9, 10, 10, 10, 11, 12, 12, 12, 13, 14, 14, 14, 15));
+        _mm_storeu_si128((__m128i*)d, lo);
+        _mm_storeu_si128((__m128i*)(d + 16), hi);
+    }
+};
+
+static PIXEL_TARGET_SSSE3 inline __m128i widen_mask_128()
+{
+    return _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+}
+
+struct rgb_to_rgba_ssse3
+{
+    enum { IN = 3, OUT = 4, PIXELS = 16, LOAD = 48, STORE = 64 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)s);
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(s + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(s + 32));
+
+        /* four pixels start at bytes 0, 12, 24 and 36 */
+        __m128i p0 = v0;
+        __m128i p1 = _mm_alignr_epi8(v1, v0, 12);
+        __m128i p2 = _mm_alignr_epi8(v2, v1, 8);
+        __m128i p3 = _mm_srli_si128(v2, 4);
+
+        __m128i mask = widen_mask_128();
+        _mm_storeu_si128((__m128i*)d, _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha_128()));
+        _mm_storeu_si128((__m128i*)(d + 16), _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha_128()));
+        _mm_storeu_si128((__m128i*)(d + 32), _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha_128()));
+        _mm_storeu_si128((__m128i*)(d + 48), _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha_128()));
+    }
+};
+
+struct rgba_to_rgb_ssse3
+{
+    enum { IN = 4, OUT = 3, PIXELS = 16, LOAD = 64, STORE = 48 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        /* each register's four pixels packed into its low 12 bytes, then spliced */
+        __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -128, -128, -128, -128);
+        __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + 16)), mask);
+        __m128i c = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + 32)), mask);
+        __m128i e = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(s + 48)), mask);
+
+        _mm_storeu_si128((__m128i*)d, _mm_or_si128(a, _mm_slli_si128(b, 12)));
+        _mm_storeu_si128((__m128i*)(d + 16), _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+        _mm_storeu_si128((__m128i*)(d + 32), _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(e, 4)));
+    }
+};
+
+/* four RGBA pixels -> four 32 bit gray values */
+static PIXEL_TARGET_SSSE3 inline __m128i luma_128(__m128i v)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i weights = _mm_setr_epi16(77, 150, 29, 0, 77, 150, 29, 0);
+
+    /* (77 r + 150 g) and (29 b) per pixel, summed pairwise */
+    __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(v, zero), weights);
+    __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(v, zero), weights);
+    return _mm_srli_epi32(_mm_hadd_epi32(lo, hi), 8);
+}
+
+struct rgba_to_gray_ssse3
+{
+    enum { IN = 4, OUT = 1, PIXELS = 16, LOAD = 64, STORE = 16 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i y0 = luma_128(_mm_loadu_si128((const __m128i*)s));
+        __m128i y1 = luma_128(_mm_loadu_si128((const __m128i*)(s + 16)));
+        __m128i y2 = luma_128(_mm_loadu_si128((const __m128i*)(s + 32)));
+        __m128i y3 = luma_128(_mm_loadu_si128((const __m128i*)(s + 48)));
+
+        __m128i y = _mm_packus_epi16(_mm_packs_epi32(y0, y1), _mm_packs_epi32(y2, y3));
+        _mm_storeu_si128((__m128i*)d, y);
+    }
+};
+
+struct rgba_to_gray_alpha_ssse3
+{
+    enum { IN = 4, OUT = 2, PIXELS = 8, LOAD = 32, STORE = 16 };
+
+    static PIXEL_TARGET_SSSE3 inline __m128i pack4(__m128i v)
+    {
+        /* gray | alpha << 8 in each 32 bit lane, then the low 16 bits of each lane gathered */
+        __m128i ya = _mm_or_si128(luma_128(v), _mm_slli_epi32(_mm_srli_epi32(v, 24), 8));
+        return _mm_shuffle_epi8(ya, _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -128, -128, -128, -128, -128, -128, -128, -128));
+    }
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i a = pack4(_mm_loadu_si128((const __m128i*)s));
+        __m128i b = pack4(_mm_loadu_si128((const __m128i*)(s + 16)));
+        _mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi64(a, b));
+    }
+};
+
+struct swap_rgba_ssse3
+{
+    enum { IN = 4, OUT = 4, PIXELS = 4, LOAD = 16, STORE = 16 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        _mm_storeu_si128((__m128i*)d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask));
+    }
+};
+
+struct swap_rgb_ssse3
+{
+    /* five pixels and the next one's first byte, stored back unchanged */
+    enum { IN = 3, OUT = 3, PIXELS = 5, LOAD = 16, STORE = 16 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+        _mm_storeu_si128((__m128i*)d, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)s), mask));
+    }
+};
+
+struct reduce_16_ssse3
+{
+    enum { IN = 2, OUT = 1, PIXELS = 16, LOAD = 32, STORE = 16 };
+
+    static PIXEL_TARGET_SSSE3 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m128i a = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)s), 8);
+        __m128i b = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(s + 16)), 8);
+        _mm_storeu_si128((__m128i*)d, _mm_packus_epi16(a, b));
+    }
+};
+
+/* the same 16 source bytes in both lanes, so each lane's pshufb can reach all of them */
+static PIXEL_TARGET_AVX2 inline __m256i broadcast_256(const uint8_t* s)
+{
+    return _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)s));
+}
+
+static PIXEL_TARGET_AVX2 inline __m256i alpha_256()
+{
+    return _mm256_set1_epi32((int)0xff000000);
+}
+
+struct gray_to_rgba_avx2
+{
+    enum { IN = 1, OUT = 4, PIXELS = 16, LOAD = 16, STORE = 64 };
+
+    static PIXEL_TARGET_AVX2 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m256i v = broadcast_256(s);
+        __m256i spread = _mm256_setr_epi8(0, 0, 0, -128, 1, 1, 1, -128, 2, 2, 2, -128, 3, 3, 3, -128,
+                                          4, 4, 4, -128, 5, 5, 5, -128, 6, 6, 6, -128, 7, 7, 7, -128);
+        __m256i lo = _mm256_shuffle_epi8(v, spread);
+        __m256i hi = _mm256_shuffle_epi8(v, _mm256_add_epi8(spread, _mm256_set1_epi8(8)));
+        _mm256_storeu_si256((__m256i*)d, _mm256_or_si256(lo, alpha_256()));
+        _mm256_storeu_si256((__m256i*)(d + 32), _mm256_or_si256(hi, alpha_256()));
+    }
+};
+
+struct rgb_to_rgba_avx2
+{
+    enum { IN = 3, OUT = 4, PIXELS = 16, LOAD = 48, STORE = 64 };
+
+    static PIXEL_TARGET_AVX2 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        /* four pixels per 128 bit load, the last shifted down so it doesn't read past 48 */
+        __m128i q0 = _mm_loadu_si128((const __m128i*)s);
+        __m128i q1 = _mm_loadu_si128((const __m128i*)(s + 12));
+        __m128i q2 = _mm_loadu_si128((const __m128i*)(s + 24));
+        __m128i q3 = _mm_srli_si128(_mm_loadu_si128((const __m128i*)(s + 32)), 4);
+
+        __m256i mask = _mm256_broadcastsi128_si256(widen_mask_128());
+        __m256i lo = _mm256_inserti128_si256(_mm256_castsi128_si256(q0), q1, 1);
+        __m256i hi = _mm256_inserti128_si256(_mm256_castsi128_si256(q2), q3, 1);
+        _mm256_storeu_si256((__m256i*)d, _mm256_or_si256(_mm256_shuffle_epi8(lo, mask), alpha_256()));
+        _mm256_storeu_si256((__m256i*)(d + 32), _mm256_or_si256(_mm256_shuffle_epi8(hi, mask), alpha_256()));
+    }
+};
+
+struct swap_rgba_avx2
+{
+    enum { IN = 4, OUT = 4, PIXELS = 8, LOAD = 32, STORE = 32 };
+
+    static PIXEL_TARGET_AVX2 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                        2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        _mm256_storeu_si256((__m256i*)d, _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)s), mask));
+    }
+};
+
+struct reduce_16_avx2
+{
+    enum { IN = 2, OUT = 1, PIXELS = 32, LOAD = 64, STORE = 32 };
+
+    static PIXEL_TARGET_AVX2 inline void block(uint8_t* d, const uint8_t* s)
+    {
+        __m256i a = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)s), 8);
+        __m256i b = _mm256_srli_epi16(_mm256_loadu_si256((const __m256i*)(s + 32)), 8);
+        /* packus works per lane: a0 b0 a1 b1 -> a0 a1 b0 b1 */
+        __m256i packed = _mm256_packus_epi16(a, b);
+        _mm256_storeu_si256((__m256i*)d, _mm256_permute4x64_epi64(packed, 0xd8));
+    }
+};
+
+/* true when a kernel took it */
+static bool convert_simd(pixel_convert_simd simd, uint8_t* dst, int dst_n, const uint8_t* src, int src_n, size_t count)
+{
+    span_func scalar = s_convert_spans[src_n - 1][dst_n - 1];
+
+    if (simd == PIXEL_CONVERT_AVX2)
+    {
+        switch (COMBO(src_n, dst_n))
+        {
+        case COMBO(1, 4):
+            run<gray_to_rgba_avx2>(blocks_avx2<gray_to_rgba_avx2>, scalar, dst, src, count);
+            return true;
+        case COMBO(3, 4):
+            run<rgb_to_rgba_avx2>(blocks_avx2<rgb_to_rgba_avx2>, scalar, dst, src, count);
+            return true;
+        }
+    }
+
+    switch (COMBO(src_n, dst_n))
+    {
+    case COMBO(1, 4):
+        run<gray_to_rgba_ssse3>(blocks_ssse3<gray_to_rgba_ssse3>, scalar, dst, src, count);
+        return true;
+    case COMBO(2, 4):
+        run<gray_alpha_to_rgba_ssse3>(blocks_ssse3<gray_alpha_to_rgba_ssse3>, scalar, dst, src, count);
+        return true;
+    case COMBO(3, 4):
+        run<rgb_to_rgba_ssse3>(blocks_ssse3<rgb_to_rgba_ssse3>, scalar, dst, src, count);
+        return true;
+    case COMBO(4, 3):
+        run<rgba_to_rgb_ssse3>(blocks_ssse3<rgba_to_rgb_ssse3>, scalar, dst, src, count);
+        return true;
+    case COMBO(4, 2):
+        run<rgba_to_gray_alpha_ssse3>(blocks_ssse3<rgba_to_gray_alpha_ssse3>, scalar, dst, src, count);
+        return true;
+    case COMBO(4, 1):
+        run<rgba_to_gray_ssse3>(blocks_ssse3<rgba_to_gray_ssse3>, scalar, dst, src, count);
+        return true;
+    }
+    return false;
+}
+
+#endif // PIXEL_X86
+
+pixel_convert_simd pixel_convert_best()
+{
+#ifdef PIXEL_X86
+    if (SDL_HasAVX2())
+        return PIXEL_CONVERT_AVX2;
+    if (SDL_HasSSE41())
+        return PIXEL_CONVERT_SSSE3;
+#endif
+    return PIXEL_CONVERT_SCALAR;
+}
+
+const char* pixel_convert_name(pixel_convert_simd simd)
+{
+    switch (simd)
+    {
+    case PIXEL_CONVERT_AUTO:    return "auto";
+    case PIXEL_CONVERT_SCALAR:  return "scalar";
+    case PIXEL_CONVERT_SSSE3:   return "ssse3";
+    case PIXEL_CONVERT_AVX2:    return "avx2";
+    }
+    return "?";
+}
+
+bool pixel_convert(pixel_convert_simd simd, uint8_t* dst, int dst_n, const uint8_t* src, int src_n, size_t count)
+{
+    if (src_n < 1 || src_n > 4 || dst_n < 1 || dst_n > 4)
+        return false;
+
+    if (src_n == dst_n)
+    {
+        if (dst != src)
+            memcpy(dst, src, count * src_n);
+        return true;
+    }
+
+    if (simd == PIXEL_CONVERT_AUTO)
+        simd = pixel_convert_best();
+
+#ifdef PIXEL_X86
+    if (simd != PIXEL_CONVERT_SCALAR && convert_simd(simd, dst, dst_n, src, src_n, count))
+        return true;
+#endif
+
+    s_convert_spans[src_n - 1][dst_n - 1](dst, src, 0, count);
+    return true;
+}
+
+void pixel_swap_red_blue(pixel_convert_simd simd, uint8_t* dst, const uint8_t* src, int n, size_t count)
+{
+    if (simd == PIXEL_CONVERT_AUTO)
+        simd = pixel_convert_best();
+
+    span_func scalar = n == 4 ? swap_span<4> : swap_span<3>;
+
+#ifdef PIXEL_X86
+    if (n == 4 && simd == PIXEL_CONVERT_AVX2)
+    {
+        run<swap_rgba_avx2>(blocks_avx2<swap_rgba_avx2>, scalar, dst, src, count);
+        return;
+    }
+    if (simd != PIXEL_CONVERT_SCALAR)
+    {
+        if (n == 4)
+            run<swap_rgba_ssse3>(blocks_ssse3<swap_rgba_ssse3>, scalar, dst, src, count);
+        else
+            run<swap_rgb_ssse3>(blocks_ssse3<swap_rgb_ssse3>, scalar, dst, src, count);
+        return;
+    }
+#endif
+
+    scalar(dst, src, 0, count);
+}
+
+void pixel_reduce_16_to_8(pixel_convert_simd simd, uint8_t* dst, const uint16_t* src, size_t count)
+{
+    if (simd == PIXEL_CONVERT_AUTO)
+        simd = pixel_convert_best();
+
+    const uint8_t* bytes = (const uint8_t*)src;
+
+#ifdef PIXEL_X86
+    if (simd == PIXEL_CONVERT_AVX2)
+    {
+        run<reduce_16_avx2>(blocks_avx2<reduce_16_avx2>, reduce_span, dst, bytes, count);
+        return;
+    }
+    if (simd != PIXEL_CONVERT_SCALAR)
+    {
+        run<reduce_16_ssse3>(blocks_ssse3<reduce_16_ssse3>, reduce_span, dst, bytes, count);
+        return;
+    }
+#endif
+
+    reduce_span(dst, bytes, 0, count);
+}
+
+static pixel_convert_simd s_installed = PIXEL_CONVERT_SCALAR;
+
+static int convert_hook(stbi_uc* dst, const void* src, int src_bits, int img_n, int req_comp, size_t pixels)
+{
+    if (src_bits == 16)
+    {
+        pixel_reduce_16_to_8(s_installed, dst, (const uint16_t*)src, pixels * img_n);
+        return 1;
+    }
+    return pixel_convert(s_installed, dst, req_comp, (const uint8_t*)src, img_n, pixels) ? 1 : 0;
+}
+
+void pixel_convert_install(pixel_convert_simd simd)
+{
+    s_installed = simd == PIXEL_CONVERT_AUTO ? pixel_convert_best() : simd;
+    stbi_set_convert(s_installed == PIXEL_CONVERT_SCALAR ? NULL : convert_hook);
+}
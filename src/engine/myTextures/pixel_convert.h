@@ -0,0 +1,45 @@
+/*
+    SIMD pixel format conversion
+    ----------------------------
+    channel count changes (1/2/3/4 -> 1/2/3/4, 8 bits each), red/blue swaps
+    for BGR(A) data and 16 -> 8 bit reduction, with the same results as
+    stb_image's own conversions: gray is (77 r + 150 g + 29 b) >> 8, a new
+    alpha is 255, 16 bit values keep their high byte.
+
+    everything can run in place (dst == src, the buffer sized for the larger
+    of the two layouts): widening works back to front, narrowing front to
+    back. otherwise dst and src must not overlap.
+
+    pixel_convert_install() puts it behind stb_image's conversions, so a
+    load that asks for a different channel count converts in the decoded
+    buffer instead of allocating a second one. call once at startup, before
+    any thread decodes.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum pixel_convert_simd
+{
+    PIXEL_CONVERT_AUTO,     // best the CPU supports
+    PIXEL_CONVERT_SCALAR,
+    PIXEL_CONVERT_SSSE3,    // pshufb (detected through SSE4.1, SDL has no SSSE3 check)
+    PIXEL_CONVERT_AVX2      // 32 byte gray / RGB expansion, RGBA swaps and 16 -> 8 on top of SSSE3
+};
+
+/* which implementation PIXEL_CONVERT_AUTO resolves to on this machine */
+pixel_convert_simd pixel_convert_best();
+const char* pixel_convert_name(pixel_convert_simd simd);
+
+/* SCALAR removes the hook, leaving stb's loops (and its second buffer) */
+void pixel_convert_install(pixel_convert_simd simd = PIXEL_CONVERT_AUTO);
+
+/* count pixels of src_n channels to dst_n channels; false unless both are 1..4 */
+bool pixel_convert(pixel_convert_simd simd, uint8_t* dst, int dst_n, const uint8_t* src, int src_n, size_t count);
+
+/* RGB <-> BGR (n == 3) or RGBA <-> BGRA (n == 4) */
+void pixel_swap_red_blue(pixel_convert_simd simd, uint8_t* dst, const uint8_t* src, int n, size_t count);
+
+/* count 16 bit values to 8 bits; dst may be (uint8_t*)src */
+void pixel_reduce_16_to_8(pixel_convert_simd simd, uint8_t* dst, const uint16_t* src, size_t count);
@@ -0,0 +1,499 @@
+/*
+    SIMD PNG row unfiltering for stb_image
+    ----------------------------
+    each filter predicts a byte from its neighbours, a (left), b (above) and
+    c (above left), and stores the difference:
+
+      sub:     x + a
+      up:      x + b
+      average: x + floor((a + b) / 2)
+      paeth:   x + whichever of a, b, c is closest to a + b - c
+
+    up has no dependency along the row, so it runs 16 (or 32) bytes at a
+    time. sub becomes a prefix sum over four pixels per register. average
+    and paeth depend on the pixel just written, so they go one pixel per
+    step, all channels at once, instead of one byte per step.
+
+    layouts: RGB -> RGB, RGBA -> RGBA and RGB -> RGBA (alpha set to 255),
+    templated on the input and output pixel sizes.
+*/
+
+#include "myTextures/png_unfilter.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <stb_image.h>
+
+#include "SDL.h"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define PNG_X86 1
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(__clang__)
+#define PNG_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PNG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define PNG_TARGET_SSSE3
+#define PNG_TARGET_AVX2
+#endif
+#endif
+
+enum png_filter
+{
+    PNG_FILTER_NONE,
+    PNG_FILTER_SUB,
+    PNG_FILTER_UP,
+    PNG_FILTER_AVERAGE,
+    PNG_FILTER_PAETH
+};
+
+/* ------------------------------------------------------------------------ */
+/* scalar reference, the same arithmetic as stb_image */
+
+static inline int paeth(int a, int b, int c)
+{
+    int p = a + b - c;
+    int pa = abs(p - a);
+    int pb = abs(p - b);
+    int pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    if (pb <= pc) return b;
+    return c;
+}
+
+static void unfilter_scalar(int filter, uint8_t* cur, const uint8_t* raw, const uint8_t* prior,
+                            int width, int in, int out)
+{
+    for (int i = 0; i < width; i++, cur += out, raw += in)
+    {
+        const uint8_t* left = i ? cur - out : NULL;
+        const uint8_t* up = prior ? prior + i * out : NULL;
+        const uint8_t* up_left = (i && prior) ? up - out : NULL;
+
+        for (int k = 0; k < in; k++)
+        {
+            int a = left ? left[k] : 0;
+            int b = up ? up[k] : 0;
+            int c = up_left ? up_left[k] : 0;
+
+            switch (filter)
+            {
+            case PNG_FILTER_NONE:       cur[k] = raw[k]; break;
+            case PNG_FILTER_SUB:        cur[k] = (uint8_t)(raw[k] + a); break;
+            case PNG_FILTER_UP:         cur[k] = (uint8_t)(raw[k] + b); break;
+            case PNG_FILTER_AVERAGE:    cur[k] = (uint8_t)(raw[k] + ((a + b) >> 1)); break;
+            case PNG_FILTER_PAETH:      cur[k] = (uint8_t)(raw[k] + paeth(a, b, c)); break;
+            }
+        }
+        if (out > in)
+            cur[in] = 255;
+    }
+}
+
+#ifdef PNG_X86
+
+/* ------------------------------------------------------------------------ */
+/* one pixel in the low lanes of a register */
+
+template<int N>
+static inline __m128i load_pixel(const uint8_t* p)
+{
+    uint32_t v = 0;
+    memcpy(&v, p, N);
+    return _mm_cvtsi32_si128((int)v);
+}
+
+template<int N>
+static inline void store_pixel(uint8_t* p, __m128i v)
+{
+    uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+    memcpy(p, &x, N);
+}
+
+/* RGB -> RGBA rows force the fourth byte of every pixel to 255 */
+template<int IN, int OUT>
+static inline __m128i fill_alpha(__m128i v)
+{
+    return OUT > IN ? _mm_or_si128(v, _mm_set1_epi32((int)0xff000000)) : v;
+}
+
+/*
+    the per pixel kernels move 4 bytes at a time inside a row, even for RGB:
+    the extra byte read belongs to the next pixel, the extra byte written is
+    overwritten by the next step. only the last pixel of a row moves exactly
+    IN / OUT bytes, so nothing outside the row is touched. byte lanes never
+    mix, so whatever rides along in the spare lane is harmless.
+*/
+template<int IN, int OUT, int LOAD, int STORE>
+static inline void none_step(uint8_t* cur, const uint8_t* raw)
+{
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(load_pixel<LOAD>(raw)));
+}
+
+template<int IN, int OUT>
+static void none_row(uint8_t* cur, const uint8_t* raw, int width)
+{
+    if (IN == OUT)
+    {
+        memcpy(cur, raw, (size_t)width * IN);
+        return;
+    }
+
+    int i = 0;
+    for (; i + 1 < width; i++)
+        none_step<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN);
+    none_step<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN);
+}
+
+template<int IN, int OUT, int LOAD, int STORE>
+static inline void sub_step(uint8_t* cur, const uint8_t* raw, __m128i& a)
+{
+    a = _mm_add_epi8(load_pixel<LOAD>(raw), a);
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(a));
+}
+
+template<int IN, int OUT>
+static void sub_row_sse2(uint8_t* cur, const uint8_t* raw, int width)
+{
+    __m128i a = _mm_setzero_si128();
+    int i = 0;
+
+    if (IN == 4 && OUT == 4)
+    {
+        /* prefix sum over four pixels, then carry in the last pixel of the previous four */
+        for (; i + 4 <= width; i += 4)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(raw + i * 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, a);
+            _mm_storeu_si128((__m128i*)(cur + i * 4), x);
+            a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        if (i == width)
+            return;
+    }
+
+    for (; i + 1 < width; i++)
+        sub_step<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN, a);
+    sub_step<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN, a);
+}
+
+template<int IN, int OUT, int LOAD, int STORE>
+static inline void up_step(uint8_t* cur, const uint8_t* raw, const uint8_t* prior)
+{
+    __m128i x = _mm_add_epi8(load_pixel<LOAD>(raw), load_pixel<STORE>(prior));
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(x));
+}
+
+template<int IN, int OUT>
+static void up_row_sse2(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int width)
+{
+    if (IN == OUT)
+    {
+        int bytes = width * IN;
+        int k = 0;
+        for (; k + 16 <= bytes; k += 16)
+        {
+            __m128i x = _mm_loadu_si128((const __m128i*)(raw + k));
+            __m128i b = _mm_loadu_si128((const __m128i*)(prior + k));
+            _mm_storeu_si128((__m128i*)(cur + k), _mm_add_epi8(x, b));
+        }
+        for (; k < bytes; k++)
+            cur[k] = (uint8_t)(raw[k] + prior[k]);
+        return;
+    }
+
+    int i = 0;
+    for (; i + 1 < width; i++)
+        up_step<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN, prior + i * OUT);
+    up_step<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN, prior + i * OUT);
+}
+
+/*
+    average keeps the complement of the last pixel: with ~v = 255 - v,
+      floor((a + b) / 2) = ~pavgb(~a, ~b)   so   ~a' = pavgb(~a, ~b) - x
+    which is two instructions from one pixel to the next.
+*/
+template<int IN, int OUT, int LOAD, int STORE>
+static inline void average_step(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, __m128i& not_a)
+{
+    const __m128i ones = _mm_set1_epi8(-1);
+    __m128i not_b = prior ? _mm_xor_si128(load_pixel<STORE>(prior), ones) : ones;
+
+    not_a = _mm_sub_epi8(_mm_avg_epu8(not_a, not_b), load_pixel<LOAD>(raw));
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(_mm_xor_si128(not_a, ones)));
+}
+
+/* prior may be NULL (first row): b is then 0 and the average is a / 2 */
+template<int IN, int OUT>
+static void average_row_sse2(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int width)
+{
+    __m128i not_a = _mm_set1_epi8(-1);
+    int i = 0;
+
+    for (; i + 1 < width; i++)
+        average_step<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN, prior ? prior + i * OUT : NULL, not_a);
+    average_step<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN, prior ? prior + i * OUT : NULL, not_a);
+}
+
+/* mask ? x : y */
+static inline __m128i select(__m128i mask, __m128i x, __m128i y)
+{
+    return _mm_or_si128(_mm_and_si128(mask, x), _mm_andnot_si128(mask, y));
+}
+
+/*
+    paeth on 16 bit lanes: with p = a + b - c,
+      |p - a| = |b - c|,  |p - b| = |a - c|,  |p - c| = |(b - c) + (a - c)|
+    and the first of a, b, c whose distance is the smallest wins, as in the spec.
+*/
+static inline __m128i paeth_predict(__m128i a, __m128i b, __m128i c, __m128i pa, __m128i pb, __m128i pc)
+{
+    __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+    __m128i nearest = select(_mm_cmpeq_epi16(pb, smallest), b, c);
+    return select(_mm_cmpeq_epi16(pa, smallest), a, nearest);
+}
+
+static inline __m128i abs16_sse2(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+template<int IN, int OUT, int LOAD, int STORE>
+static inline void paeth_step_sse2(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, __m128i& a, __m128i& c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i b = _mm_unpacklo_epi8(load_pixel<STORE>(prior), zero);
+
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = abs16_sse2(_mm_add_epi16(pa, pb));
+    __m128i predicted = paeth_predict(a, b, c, abs16_sse2(pa), abs16_sse2(pb), pc);
+
+    __m128i x = _mm_add_epi8(load_pixel<LOAD>(raw), _mm_packus_epi16(predicted, predicted));
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(x));
+
+    a = _mm_unpacklo_epi8(x, zero);
+    c = b;
+}
+
+template<int IN, int OUT>
+static void paeth_row_sse2(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int width)
+{
+    __m128i a = _mm_setzero_si128(), c = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 1 < width; i++)
+        paeth_step_sse2<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN, prior + i * OUT, a, c);
+    paeth_step_sse2<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN, prior + i * OUT, a, c);
+}
+
+/* ------------------------------------------------------------------------ */
+/* SSSE3: pabsw for paeth, pshufb to widen RGB rows four pixels at a time */
+
+template<int IN, int OUT, int LOAD, int STORE>
+static PNG_TARGET_SSSE3 inline void paeth_step_ssse3(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, __m128i& a, __m128i& c)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i b = _mm_unpacklo_epi8(load_pixel<STORE>(prior), zero);
+
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+    __m128i predicted = paeth_predict(a, b, c, _mm_abs_epi16(pa), _mm_abs_epi16(pb), pc);
+
+    __m128i x = _mm_add_epi8(load_pixel<LOAD>(raw), _mm_packus_epi16(predicted, predicted));
+    store_pixel<STORE>(cur, fill_alpha<IN, OUT>(x));
+
+    a = _mm_unpacklo_epi8(x, zero);
+    c = b;
+}
+
+template<int IN, int OUT>
+static PNG_TARGET_SSSE3 void paeth_row_ssse3(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int width)
+{
+    __m128i a = _mm_setzero_si128(), c = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 1 < width; i++)
+        paeth_step_ssse3<IN, OUT, 4, 4>(cur + i * OUT, raw + i * IN, prior + i * OUT, a, c);
+    paeth_step_ssse3<IN, OUT, IN, OUT>(cur + i * OUT, raw + i * IN, prior + i * OUT, a, c);
+}
+
+/* 12 RGB bytes -> 4 RGBA pixels, alpha lanes zeroed (filled in later) */
+static PNG_TARGET_SSSE3 inline __m128i widen_rgb(const uint8_t* raw)
+{
+    const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)raw), shuffle);
+}
+
+/*
+    RGB -> RGBA for none, sub and up. reading 16 bytes for 12 means the wide
+    loop has to stop while two more pixels are still left in the row.
+*/
+static PNG_TARGET_SSSE3 void widen_row_ssse3(int filter, uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int width)
+{
+    const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    __m128i a = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 6 <= width; i += 4)
+    {
+        __m128i x = widen_rgb(raw + i * 3);
+
+        if (filter == PNG_FILTER_SUB)
+        {
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi8(x, a);
+            a = _mm_shuffle_epi32(x, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        else if (filter == PNG_FILTER_UP)
+            x = _mm_add_epi8(x, _mm_loadu_si128((const __m128i*)(prior + i * 4)));
+
+        _mm_storeu_si128((__m128i*)(cur + i * 4), _mm_or_si128(x, alpha));
+    }
+
+    /* the last few pixels, one at a time */
+    for (; i < width; i++)
+    {
+        __m128i x = load_pixel<3>(raw + i * 3);
+        if (filter == PNG_FILTER_SUB)
+            a = x = _mm_add_epi8(x, a);
+        else if (filter == PNG_FILTER_UP)
+            x = _mm_add_epi8(x, load_pixel<4>(prior + i * 4));
+        store_pixel<4>(cur + i * 4, _mm_or_si128(x, alpha));
+    }
+}
+
+/* ------------------------------------------------------------------------ */
+/* AVX2: only up is wide enough to care about 32 bytes at a time */
+
+static PNG_TARGET_AVX2 void up_row_avx2(uint8_t* cur, const uint8_t* raw, const uint8_t* prior, int bytes)
+{
+    int k = 0;
+    for (; k + 32 <= bytes; k += 32)
+    {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(raw + k));
+        __m256i b = _mm256_loadu_si256((const __m256i*)(prior + k));
+        _mm256_storeu_si256((__m256i*)(cur + k), _mm256_add_epi8(x, b));
+    }
+    for (; k < bytes; k++)
+        cur[k] = (uint8_t)(raw[k] + prior[k]);
+}
+
+/* ------------------------------------------------------------------------ */
+
+template<int IN, int OUT>
+static void unfilter_simd(png_unfilter_simd simd, int filter, uint8_t* cur, const uint8_t* raw,
+                          const uint8_t* prior, int width)
+{
+    bool ssse3 = simd >= PNG_UNFILTER_SSSE3;
+
+    if (ssse3 && IN == 3 && OUT == 4 && filter <= PNG_FILTER_UP)
+    {
+        widen_row_ssse3(filter, cur, raw, prior, width);
+        return;
+    }
+
+    switch (filter)
+    {
+    case PNG_FILTER_NONE:
+        none_row<IN, OUT>(cur, raw, width);
+        break;
+    case PNG_FILTER_SUB:
+        sub_row_sse2<IN, OUT>(cur, raw, width);
+        break;
+    case PNG_FILTER_UP:
+        if (simd == PNG_UNFILTER_AVX2 && IN == OUT)
+            up_row_avx2(cur, raw, prior, width * IN);
+        else
+            up_row_sse2<IN, OUT>(cur, raw, prior, width);
+        break;
+    case PNG_FILTER_AVERAGE:
+        average_row_sse2<IN, OUT>(cur, raw, prior, width);
+        break;
+    case PNG_FILTER_PAETH:
+        if (ssse3)
+            paeth_row_ssse3<IN, OUT>(cur, raw, prior, width);
+        else
+            paeth_row_sse2<IN, OUT>(cur, raw, prior, width);
+        break;
+    }
+}
+
+#endif // PNG_X86
+
+png_unfilter_simd png_unfilter_best()
+{
+#ifdef PNG_X86
+    if (SDL_HasAVX2())
+        return PNG_UNFILTER_AVX2;
+    if (SDL_HasSSE41())
+        return PNG_UNFILTER_SSSE3;
+    if (SDL_HasSSE2())
+        return PNG_UNFILTER_SSE2;
+#endif
+    return PNG_UNFILTER_SCALAR;
+}
+
+const char* png_unfilter_name(png_unfilter_simd simd)
+{
+    switch (simd)
+    {
+    case PNG_UNFILTER_AUTO:     return "auto";
+    case PNG_UNFILTER_SCALAR:   return "scalar";
+    case PNG_UNFILTER_SSE2:     return "sse2";
+    case PNG_UNFILTER_SSSE3:    return "ssse3";
+    case PNG_UNFILTER_AVX2:     return "avx2";
+    }
+    return "?";
+}
+
+bool png_unfilter_row(png_unfilter_simd simd, int filter, uint8_t* cur, const uint8_t* raw,
+                      const uint8_t* prior, int width, int img_n, int out_n)
+{
+    bool layout_ok = (img_n == 3 || img_n == 4) && (out_n == img_n || (img_n == 3 && out_n == 4));
+    if (!layout_ok || filter < PNG_FILTER_NONE || filter > PNG_FILTER_PAETH)
+        return false;
+
+    if (simd == PNG_UNFILTER_AUTO)
+        simd = png_unfilter_best();
+
+    /* nothing above the first row: up is a copy and paeth always picks a */
+    if (!prior && filter == PNG_FILTER_UP)
+        filter = PNG_FILTER_NONE;
+    if (!prior && filter == PNG_FILTER_PAETH)
+        filter = PNG_FILTER_SUB;
+
+#ifdef PNG_X86
+    if (simd != PNG_UNFILTER_SCALAR)
+    {
+        if (img_n == 4)
+            unfilter_simd<4, 4>(simd, filter, cur, raw, prior, width);
+        else if (out_n == 4)
+            unfilter_simd<3, 4>(simd, filter, cur, raw, prior, width);
+        else
+            unfilter_simd<3, 3>(simd, filter, cur, raw, prior, width);
+        return true;
+    }
+#endif
+
+    unfilter_scalar(filter, cur, raw, prior, width, img_n, out_n);
+    return true;
+}
+
+static png_unfilter_simd s_installed = PNG_UNFILTER_SCALAR;
+
+static int unfilter_hook(int filter, stbi_uc* cur, const stbi_uc* raw, const stbi_uc* prior, int width, int img_n, int out_n)
+{
+    return png_unfilter_row(s_installed, filter, cur, raw, prior, width, img_n, out_n) ? 1 : 0;
+}
+
+void png_unfilter_install(png_unfilter_simd simd)
+{
+    s_installed = simd == PNG_UNFILTER_AUTO ? png_unfilter_best() : simd;
+    stbi_set_png_unfilter(s_installed == PNG_UNFILTER_SCALAR ? NULL : unfilter_hook);
+}
@@ -0,0 +1,39 @@
+/*
+    SIMD PNG row unfiltering for stb_image
+    ----------------------------
+    stb_image undoes the PNG filters (sub, up, average, paeth) one byte at a
+    time. png_unfilter_install() hooks kernels that work a whole pixel (or,
+    for up, 16/32 bytes) per step into stb's PNG path for 8-bit RGB and RGBA
+    images, including the RGB -> RGBA expansion every 4 channel load does.
+    other bit depths and channel counts still take stb's own loop.
+
+    call once at startup, before any thread decodes a PNG. every level is
+    bit-exact with the scalar reference (and so with stb itself).
+*/
+#pragma once
+
+#include <stdint.h>
+
+enum png_unfilter_simd
+{
+    PNG_UNFILTER_AUTO,      // best the CPU supports
+    PNG_UNFILTER_SCALAR,    // the byte loop, same as stb's
+    PNG_UNFILTER_SSE2,
+    PNG_UNFILTER_SSSE3,     // paeth with pabsw (detected through SSE4.1, SDL has no SSSE3 check)
+    PNG_UNFILTER_AVX2       // 32 byte up filter on top of SSSE3
+};
+
+/* which implementation PNG_UNFILTER_AUTO resolves to on this machine */
+png_unfilter_simd png_unfilter_best();
+const char* png_unfilter_name(png_unfilter_simd simd);
+
+/* SCALAR removes the hook, leaving stb's loop */
+void png_unfilter_install(png_unfilter_simd simd = PNG_UNFILTER_AUTO);
+
+/*
+    one row, exactly as the stb hook sees it: filter 0..4, prior NULL for the
+    first row, out_n == img_n or out_n == 4 with img_n == 3 (alpha set to 255).
+    returns false for layouts it doesn't handle.
+*/
+bool png_unfilter_row(png_unfilter_simd simd, int filter, uint8_t* cur, const uint8_t* raw,
+                      const uint8_t* prior, int width, int img_n, int out_n);
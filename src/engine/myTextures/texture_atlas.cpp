@@ -0,0 +1,348 @@
+/*
+    texture atlases
+    ----------------------------
+    the packer works on cells: gutter + image (rounded up to the alignment)
+    + gutter + padding. with every cell edge and every page edge a multiple
+    of the alignment, every free rectangle stays aligned too, so nothing
+    has to be re-aligned after a split. pages are packed as if they were one
+    padding wider and taller, so the last cell's padding can hang off the
+    edge; nothing ever samples it.
+*/
+
+#include "myTextures/texture_atlas.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+struct free_rect
+{
+    int x, y, width, height;
+};
+
+struct pack_page
+{
+    std::vector<free_rect> free;
+    int used_width, used_height;
+};
+
+static int round_up(int value, int alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+int atlas_alignment(const atlas_settings& settings)
+{
+    int levels = settings.mip_levels < 1 ? 1 : settings.mip_levels;
+    return 1 << (levels - 1);
+}
+
+/* at least one texel of gutter at the last clean level */
+static int gutter_texels(const atlas_settings& settings)
+{
+    int alignment = atlas_alignment(settings);
+    int gutter = settings.gutter;
+    if (settings.mip_levels > 1 && gutter < alignment)
+        gutter = alignment;
+    return round_up(gutter, alignment);
+}
+
+static bool overlaps(const free_rect& a, const free_rect& b)
+{
+    return a.x < b.x + b.width && b.x < a.x + a.width &&
+           a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static bool contains(const free_rect& outer, const free_rect& inner)
+{
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
+}
+
+/* best short side fit on one page; false when nothing there is big enough */
+static bool find_position(const pack_page& page, int width, int height, int* x, int* y)
+{
+    int best_short = 0x7fffffff, best_long = 0x7fffffff;
+    bool found = false;
+
+    for (size_t i = 0; i < page.free.size(); i++)
+    {
+        const free_rect& r = page.free[i];
+        if (r.width < width || r.height < height)
+            continue;
+
+        int short_side = std::min(r.width - width, r.height - height);
+        int long_side = std::max(r.width - width, r.height - height);
+        if (short_side < best_short || (short_side == best_short && long_side < best_long))
+        {
+            best_short = short_side;
+            best_long = long_side;
+            *x = r.x;
+            *y = r.y;
+            found = true;
+        }
+    }
+    return found;
+}
+
+/* carve the cell out of every free rectangle it touches, then drop the ones left inside others */
+static void place_cell(pack_page& page, const free_rect& cell)
+{
+    std::vector<free_rect> next;
+    next.reserve(page.free.size() + 4);
+
+    for (size_t i = 0; i < page.free.size(); i++)
+    {
+        const free_rect& r = page.free[i];
+        if (!overlaps(r, cell))
+        {
+            next.push_back(r);
+            continue;
+        }
+
+        if (cell.x > r.x)
+        {
+            free_rect left = { r.x, r.y, cell.x - r.x, r.height };
+            next.push_back(left);
+        }
+        if (cell.x + cell.width < r.x + r.width)
+        {
+            free_rect right = { cell.x + cell.width, r.y, r.x + r.width - (cell.x + cell.width), r.height };
+            next.push_back(right);
+        }
+        if (cell.y > r.y)
+        {
+            free_rect top = { r.x, r.y, r.width, cell.y - r.y };
+            next.push_back(top);
+        }
+        if (cell.y + cell.height < r.y + r.height)
+        {
+            free_rect bottom = { r.x, cell.y + cell.height, r.width, r.y + r.height - (cell.y + cell.height) };
+            next.push_back(bottom);
+        }
+    }
+
+    page.free.clear();
+    for (size_t i = 0; i < next.size(); i++)
+    {
+        bool redundant = false;
+        for (size_t j = 0; j < next.size() && !redundant; j++)
+        {
+            /* of two identical rectangles keep the first */
+            if (i != j && contains(next[j], next[i]))
+                redundant = !contains(next[i], next[j]) || j < i;
+        }
+        if (!redundant)
+            page.free.push_back(next[i]);
+    }
+}
+
+struct larger_first
+{
+    const int* widths;
+    const int* heights;
+
+    bool operator()(int a, int b) const
+    {
+        int side_a = std::max(widths[a], heights[a]), side_b = std::max(widths[b], heights[b]);
+        if (side_a != side_b)
+            return side_a > side_b;
+        return widths[a] * heights[a] > widths[b] * heights[b];
+    }
+};
+
+bool atlas_pack(const atlas_settings& settings, const int* widths, const int* heights, int count,
+                atlas_rect* out, std::vector<atlas_page>* pages)
+{
+    int alignment = atlas_alignment(settings);
+    int gutter = gutter_texels(settings);
+    int padding = round_up(settings.padding, alignment);
+    int page_width = settings.page_width / alignment * alignment;
+    int page_height = settings.page_height / alignment * alignment;
+
+    std::vector<int> order(count);
+    for (int i = 0; i < count; i++)
+        order[i] = i;
+    larger_first compare = { widths, heights };
+    std::stable_sort(order.begin(), order.end(), compare);
+
+    std::vector<pack_page> packing;
+    bool all_placed = true;
+
+    for (int n = 0; n < count; n++)
+    {
+        int i = order[n];
+        free_rect cell = {};
+        cell.width = gutter + round_up(widths[i], alignment) + gutter + padding;
+        cell.height = gutter + round_up(heights[i], alignment) + gutter + padding;
+
+        out[i].page = -1;
+        out[i].width = widths[i];
+        out[i].height = heights[i];
+
+        if (cell.width > page_width + padding || cell.height > page_height + padding)
+        {
+            all_placed = false;
+            continue;
+        }
+
+        /* earlier pages first, so the last one is the only one left sparse */
+        int page = 0;
+        for (; page < (int)packing.size(); page++)
+        {
+            if (find_position(packing[page], cell.width, cell.height, &cell.x, &cell.y))
+                break;
+        }
+        if (page == (int)packing.size())
+        {
+            pack_page fresh;
+            free_rect whole = { 0, 0, page_width + padding, page_height + padding };
+            fresh.free.push_back(whole);
+            fresh.used_width = fresh.used_height = 0;
+            packing.push_back(fresh);
+            cell.x = cell.y = 0;
+        }
+
+        place_cell(packing[page], cell);
+
+        out[i].page = page;
+        out[i].x = cell.x + gutter;
+        out[i].y = cell.y + gutter;
+
+        pack_page& p = packing[page];
+        p.used_width = std::max(p.used_width, out[i].x + round_up(widths[i], alignment) + gutter);
+        p.used_height = std::max(p.used_height, out[i].y + round_up(heights[i], alignment) + gutter);
+    }
+
+    pages->resize(packing.size());
+    for (size_t p = 0; p < packing.size(); p++)
+    {
+        (*pages)[p].width = packing[p].used_width;
+        (*pages)[p].height = packing[p].used_height;
+    }
+    return all_placed;
+}
+
+void atlas_blit(const atlas_settings& settings, uint8_t* page, int page_width,
+                const uint8_t* rgba, const atlas_rect& rect)
+{
+    int alignment = atlas_alignment(settings);
+    int gutter = gutter_texels(settings);
+    int x0 = rect.x - gutter, x1 = rect.x + round_up(rect.width, alignment) + gutter;
+    int y0 = rect.y - gutter, y1 = rect.y + round_up(rect.height, alignment) + gutter;
+
+    /* every texel of the cell takes the nearest image texel: the image itself, edges stretched outwards */
+    for (int y = y0; y < y1; y++)
+    {
+        int sy = std::min(std::max(y - rect.y, 0), rect.height - 1);
+        const uint8_t* src = rgba + (size_t)sy * rect.width * 4;
+        uint8_t* dst = page + ((size_t)y * page_width + x0) * 4;
+
+        for (int x = x0; x < rect.x; x++, dst += 4)
+            memcpy(dst, src, 4);
+
+        memcpy(dst, src, (size_t)rect.width * 4);
+        dst += (size_t)rect.width * 4;
+
+        for (int x = rect.x + rect.width; x < x1; x++, dst += 4)
+            memcpy(dst, src + (size_t)(rect.width - 1) * 4, 4);
+    }
+}
+
+atlas_entry atlas_make_entry(const char* name, const atlas_rect& rect, const atlas_page& page)
+{
+    atlas_entry entry;
+    entry.name = name;
+    entry.page = rect.page;
+    entry.rect = rect;
+    entry.scale_u = (float)rect.width / page.width;
+    entry.scale_v = (float)rect.height / page.height;
+    entry.offset_u = (float)rect.x / page.width;
+    entry.offset_v = (float)rect.y / page.height;
+    return entry;
+}
+
+void atlas_remap_uv(const atlas_entry& entry, const float* uv, float* out, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i * 2 + 0] = uv[i * 2 + 0] * entry.scale_u + entry.offset_u;
+        out[i * 2 + 1] = uv[i * 2 + 1] * entry.scale_v + entry.offset_v;
+    }
+}
+
+std::string atlas_table_write(const atlas_table& table)
+{
+    std::string text;
+    char line[512];
+
+    for (size_t p = 0; p < table.pages.size(); p++)
+    {
+        snprintf(line, sizeof(line), "page %d %s %d %d\n", (int)p, table.page_files[p].c_str(),
+                 table.pages[p].width, table.pages[p].height);
+        text += line;
+    }
+    for (size_t i = 0; i < table.entries.size(); i++)
+    {
+        const atlas_entry& e = table.entries[i];
+        snprintf(line, sizeof(line), "image %s %d %d %d %d %d\n", e.name.c_str(), e.page,
+                 e.rect.x, e.rect.y, e.rect.width, e.rect.height);
+        text += line;
+    }
+    return text;
+}
+
+bool atlas_table_parse(const char* text, size_t size, atlas_table* out)
+{
+    out->page_files.clear();
+    out->pages.clear();
+    out->entries.clear();
+
+    std::string all(text, size);
+    size_t start = 0;
+    while (start < all.size())
+    {
+        size_t end = all.find('\n', start);
+        if (end == std::string::npos)
+            end = all.size();
+        std::string line = all.substr(start, end - start);
+        start = end + 1;
+
+        char name[256];
+        int index;
+        atlas_rect rect;
+        atlas_page page;
+
+        if (line.empty() || line[0] == '#' || line[0] == '\r')
+            continue;
+
+        if (sscanf(line.c_str(), "page %d %255s %d %d", &index, name, &page.width, &page.height) == 4)
+        {
+            if (index != (int)out->pages.size() || page.width <= 0 || page.height <= 0)
+                return false;
+            out->page_files.push_back(name);
+            out->pages.push_back(page);
+        }
+        else if (sscanf(line.c_str(), "image %255s %d %d %d %d %d", name, &rect.page, &rect.x, &rect.y, &rect.width, &rect.height) == 6)
+        {
+            /* pages come first, so an entry can always be resolved right away */
+            if (rect.page < 0 || rect.page >= (int)out->pages.size())
+                return false;
+            out->entries.push_back(atlas_make_entry(name, rect, out->pages[rect.page]));
+        }
+        else
+            return false;
+    }
+    return true;
+}
+
+const atlas_entry* atlas_table_find(const atlas_table& table, const char* name)
+{
+    for (size_t i = 0; i < table.entries.size(); i++)
+    {
+        if (table.entries[i].name == name)
+            return &table.entries[i];
+    }
+    return NULL;
+}
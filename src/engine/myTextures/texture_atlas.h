@@ -0,0 +1,89 @@
+/*
+    texture atlases
+    ----------------------------
+    many small images packed into a few shared pages, so meshes that each
+    needed their own texture (and their own draw) can share one binding.
+
+    packing is MaxRects, best short side fit: the free space of a page is a
+    list of maximal, possibly overlapping rectangles, and each image, largest
+    first, goes where it leaves the least room along its shorter side.
+
+    every image is surrounded by a gutter of its own edge texels, then by
+    empty padding. cells are aligned to 1 << (mip_levels - 1) texels, so for
+    the first mip_levels levels (box filtered, 2x2 -> 1) each image starts on
+    a whole texel and keeps at least one texel of gutter: neither bilinear
+    nor mip filtering pulls in a neighbour.
+
+    the lookup table maps an image name to a page and to the scale and
+    offset that move its [0, 1] uvs into that page. uvs outside [0, 1]
+    (repeating textures) can't be remapped and need a texture of their own.
+*/
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct atlas_settings
+{
+    int page_width, page_height;    // the most a page may grow to
+    int padding;                    // empty texels between neighbouring cells
+    int gutter;                     // edge texels repeated around every image
+    int mip_levels;                 // levels that must stay free of bleeding, 1 for none
+};
+
+struct atlas_page
+{
+    int width, height;              // trimmed to what was placed on it
+};
+
+struct atlas_rect
+{
+    int page;                       // -1 when it doesn't fit on any page
+    int x, y;                       // the image itself, gutter excluded
+    int width, height;
+};
+
+struct atlas_entry
+{
+    std::string name;
+    int page;
+    atlas_rect rect;
+    float scale_u, scale_v;         // uv' = uv * scale + offset
+    float offset_u, offset_v;
+};
+
+struct atlas_table
+{
+    std::vector<std::string> page_files;    // relative to the table
+    std::vector<atlas_page> pages;
+    std::vector<atlas_entry> entries;
+};
+
+/* texels every cell edge is aligned to */
+int atlas_alignment(const atlas_settings& settings);
+
+/* places count images over as many pages as it takes; false if any is bigger than a page */
+bool atlas_pack(const atlas_settings& settings, const int* widths, const int* heights, int count,
+                atlas_rect* out, std::vector<atlas_page>* pages);
+
+/* copies an RGBA8 image into its rect on an RGBA8 page of page_width, then fills its gutter */
+void atlas_blit(const atlas_settings& settings, uint8_t* page, int page_width,
+                const uint8_t* rgba, const atlas_rect& rect);
+
+atlas_entry atlas_make_entry(const char* name, const atlas_rect& rect, const atlas_page& page);
+
+/* count uv pairs (u, v, u, v...) through entry; out may be uv */
+void atlas_remap_uv(const atlas_entry& entry, const float* uv, float* out, size_t count);
+
+/*
+    the table as text, one line each:
+      page <index> <file> <width> <height>
+      image <name> <page> <x> <y> <width> <height>
+    parse takes what asset_load returns (no terminator needed).
+*/
+std::string atlas_table_write(const atlas_table& table);
+bool atlas_table_parse(const char* text, size_t size, atlas_table* out);
+
+const atlas_entry* atlas_table_find(const atlas_table& table, const char* name);
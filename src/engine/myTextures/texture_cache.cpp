@@ -0,0 +1,136 @@
+/*
+    on-disk cache of decoded textures
+    ----------------------------
+    files are named after a hash of (path, variant) and written to a
+    temporary name first, then renamed over the old one, so a crash or a
+    second instance never leaves half a file where a reader could map it.
+*/
+
+#include "myTextures/texture_cache.h"
+#include "myCore/hash.h"
+#include "myCore/root_path.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+/* bump when the layout of a cache file changes, old files then just miss */
+#define TEXTURE_CACHE_VERSION "1"
+
+static std::string g_cache_dir;     // full path with a trailing '/', empty when off
+
+void texture_cache_init(const char* dir)
+{
+    g_cache_dir.clear();
+    if (!dir || !dir[0])
+        return;
+
+    g_cache_dir = root_path_make_directory(dir);
+}
+
+bool texture_cache_enabled()
+{
+    return !g_cache_dir.empty();
+}
+
+static std::string cache_file(const char* path, uint32_t variant)
+{
+    char name[32];
+    uint64_t key = hash64(path, strlen(path), variant);
+    sprintf(name, "%016llx.ktx", (unsigned long long)key);
+    return g_cache_dir + name;
+}
+
+static std::string to_hex(uint64_t v)
+{
+    char text[20];
+    sprintf(text, "%016llx", (unsigned long long)v);
+    return text;
+}
+
+static bool hex_value(const ktx_texture& ktx, const char* key, uint64_t* out)
+{
+    std::string text = ktx_find_value(ktx, key);
+    if (text.empty())
+        return false;
+    *out = strtoull(text.c_str(), NULL, 16);
+    return true;
+}
+
+bool texture_cache_load(const char* path, uint32_t variant, const texture_cache_source& source,
+                        file_map* map, ktx_texture* out, uint64_t* content_key)
+{
+    if (g_cache_dir.empty())
+        return false;
+
+    if (!file_map_open(cache_file(path, variant).c_str(), map))
+        return false;
+
+    uint64_t size, mtime, hash, stored_variant;
+    bool ok = ktx_parse(map->data, map->size, out)
+        && ktx_find_value(*out, "ga.cache") == TEXTURE_CACHE_VERSION
+        && ktx_find_value(*out, "ga.source") == path
+        && hex_value(*out, "ga.variant", &stored_variant) && stored_variant == variant
+        && hex_value(*out, "ga.size", &size) && size == source.size
+        && hex_value(*out, "ga.mtime", &mtime)
+        && hex_value(*out, "ga.hash", &hash)
+        && hex_value(*out, "ga.content", content_key)
+        && out->gl_type == GL_UNSIGNED_BYTE && out->gl_format == GL_RGBA;
+
+    /* a matching mtime is trusted, otherwise the content has to match */
+    ok = ok && ((source.mtime != 0 && mtime == source.mtime) || (source.hashed && hash == source.hash));
+
+    if (!ok)
+        file_map_close(map);
+    return ok;
+}
+
+bool texture_cache_store(const char* path, uint32_t variant, const texture_cache_source& source,
+                         int width, int height, int levels, const uint8_t* const* level_data,
+                         const size_t* level_size, uint64_t content_key)
+{
+    if (g_cache_dir.empty() || !source.hashed || levels > MIP_MAX_LEVELS)
+        return false;
+
+    ktx_texture ktx;
+    ktx.gl_type = GL_UNSIGNED_BYTE;
+    ktx.gl_format = GL_RGBA;
+    ktx.gl_internal_format = GL_RGBA8;
+    ktx.gl_base_internal_format = GL_RGBA;
+    ktx.width = width;
+    ktx.height = height;
+    ktx.levels = levels;
+    for (int l = 0; l < levels; l++)
+    {
+        ktx.level_data[l] = level_data[l];
+        ktx.level_size[l] = level_size[l];
+    }
+
+    ktx.key_values.push_back(std::make_pair(std::string("ga.cache"), std::string(TEXTURE_CACHE_VERSION)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.source"), std::string(path)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.variant"), to_hex(variant)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.size"), to_hex(source.size)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.mtime"), to_hex(source.mtime)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.hash"), to_hex(source.hash)));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.content"), to_hex(content_key)));
+
+    std::string final_name = cache_file(path, variant);
+    std::string temp_name = final_name + ".tmp";
+
+    if (!ktx_write_file(temp_name.c_str(), ktx))
+    {
+        remove(temp_name.c_str());
+        return false;
+    }
+
+#ifdef _WIN32
+    remove(final_name.c_str()); // rename won't replace on windows
+#endif
+    if (rename(temp_name.c_str(), final_name.c_str()) != 0)
+    {
+        remove(temp_name.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+/*
+    on-disk cache of decoded textures
+    ----------------------------
+    decoding a PNG means inflating and unfiltering every row, every launch,
+    for pixels that never change. the first decode of an image writes its
+    RGBA8 levels (the whole mip chain, when one was built) to a .ktx file in
+    the cache directory; later launches map that file and hand the levels
+    straight to the upload path without running stb at all.
+
+    one cache file per (source path, variant). inside it, key/values record
+    the source's size, mtime and content hash:
+      same size and mtime          -> hit, the source isn't even read
+      mtime differs, same hash     -> hit (touched, not changed)
+      anything else                -> miss, decode again and overwrite
+
+    archive entries have no mtime of their own, so they are always checked
+    by hash, which is cheap since their bytes are already mapped.
+*/
+#pragma once
+
+#include <stdint.h>
+
+#include "myCore/file_map.h"
+#include "myTextures/ktx.h"
+
+struct texture_cache_source
+{
+    uint64_t size;
+    uint64_t mtime;     // 0 when unknown
+    uint64_t hash;      // hash64 of the source file, only valid if hashed
+    bool hashed;
+};
+
+/* dir is relative to the executable and created if missing; NULL turns the cache off */
+void texture_cache_init(const char* dir);
+bool texture_cache_enabled();
+
+/*
+    on a hit, out's levels point into map, which the caller closes once
+    they are uploaded. content_key is the one the decode originally produced.
+*/
+bool texture_cache_load(const char* path, uint32_t variant, const texture_cache_source& source,
+                        file_map* map, ktx_texture* out, uint64_t* content_key);
+
+/* level 0 is width x height; safe to call from several threads for different paths */
+bool texture_cache_store(const char* path, uint32_t variant, const texture_cache_source& source,
+                         int width, int height, int levels, const uint8_t* const* level_data,
+                         const size_t* level_size, uint64_t content_key);
@@ -0,0 +1,1582 @@
+/*
+    asynchronous, cached texture streaming
+    ----------------------------
+    request (main) -> decode job (worker) -> upload queue -> pump (main)
+
+    the upload queue is bounded: a worker with a finished image waits for room,
+    so decoded-but-not-uploaded memory can't grow with the number of requests.
+
+    two levels of sharing:
+      path    -> entry        (interned with the flags, ref-counted by requests)
+      content -> gpu texture  (keyed by pixel hash + size, ref-counted by entries)
+
+    a decoded image's levels are staged into the upload ring on the worker
+    when there is room; its span is released once the upload calls have been
+    issued, and the ring fences it on the next pump.
+
+    eviction works on gpu textures, so entries sharing content go together.
+    a dropped level is copied down into a smaller texture and the big one
+    deleted, since raising GL_TEXTURE_BASE_LEVEL wouldn't free anything.
+
+    progressive uploads: a texture is allocated with its whole chain but
+    only the mip tail goes up at first, GL_TEXTURE_BASE_LEVEL pointing at
+    it. the image waits in a main thread list, its levels copied out of the
+    upload ring, while pump streams its finer levels, the coarsest across
+    all textures first. a decode that wasn't cached also queues a rough
+    preview tail before building the chain.
+*/
+
+#include "myTextures/texture_stream.h"
+#include "myCore/job_pool.h"
+#include "myCore/decode_arena.h"
+#include "myCore/hash.h"
+#include "myTextures/ktx.h"
+#include "myTextures/pixel_convert.h"
+#include "myTextures/texture_cache.h"
+#include "myAssets/asset_archive.h"
+#include "myOpenGL/gl_state.h"
+#include "myOpenGL/upload_ring.h"
+
+#include <stb_image.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include "SDL.h"
+
+enum entry_state
+{
+    ENTRY_FREE,
+    ENTRY_PENDING,
+    ENTRY_READY,
+    ENTRY_FAILED,
+    ENTRY_EVICTED   // was ready, decoded again once touched
+};
+
+#define RESIDENCY_MIN_SIDE 64   // textures stop dropping levels here, eviction is next
+
+struct stream_entry
+{
+    std::string path;
+    std::vector<GLuint> units;  // every unit this texture was requested on
+    GLuint texture;             // 0 until uploaded
+    uint64_t content_key;       // which gpu_texture we hold a reference to
+    int refs;
+    int flags;                  // as requested, for decoding it again
+    entry_state state;
+    bool reloading;             // a decode to restore dropped levels is in flight
+    bool changed;               // the file changed after the decode in flight (or the next one) was asked for
+};
+
+struct gpu_texture
+{
+    GLuint name;
+    int refs;
+    size_t bytes;                       // what the levels still allocated cost
+    size_t full_bytes;                  // and what they cost before any were dropped
+    GLenum internal_format;
+    int width, height, levels;          // as allocated now
+    int dropped;                        // top levels given up to the budget
+    size_t level_bytes[MIP_MAX_LEVELS]; // as allocated now
+    uint64_t last_used;                 // frame it was last sampled in
+    int base_level;                     // finest level with texels in it so far
+    bool loading;                       // finer levels still to come, not evictable yet
+};
+
+struct decode_request
+{
+    texture_stream_handle handle;
+    std::string path;   // relative to the executable, as requested
+    int flags;
+    bool changed;       // the file was just saved: its mtime can't be trusted to tell it from the cached one
+};
+
+struct decoded_image
+{
+    texture_stream_handle handle;
+    int width, height;
+    uint8_t* pixels;    // RGBA8, owned by stb until uploaded
+    mip_chain* mips;    // every level including the first, NULL for a single level
+    ktx_texture* ktx;   // cooked and cached textures skip stb entirely
+    asset_data* source; // what ktx points into (possibly the archive mapping)
+    file_map* cached;   // or this, when ktx came from the decoded texture cache
+    upload_ring_span staged;            // every level copied into the upload ring, data NULL when not
+    size_t level_offset[MIP_MAX_LEVELS];// of each level within staged
+    uint64_t content_key;
+    int first_level;    // texture level of the first level carried (a preview's tail), 0 otherwise
+    bool preview;       // a rough mip tail, the real image follows it in the queue
+    bool cache_hit, cache_miss;
+
+    /* what reading the source cost, all 0 when it wasn't read */
+    size_t ingested_bytes;
+    int page_faults, major_page_faults;
+    double read_ms, decode_ms;
+};
+
+/* an image whose finer levels are still being uploaded, one per step */
+struct progressive_upload
+{
+    uint64_t key;
+    decoded_image image;
+    int level;          // image level the texture's base level is at now
+};
+
+static void init_image(decoded_image& image, texture_stream_handle handle)
+{
+    image.handle = handle;
+    image.width = image.height = 0;
+    image.content_key = 0;
+    image.mips = NULL;
+    image.ktx = NULL;
+    image.pixels = NULL;
+    image.source = NULL;
+    image.cached = NULL;
+    image.staged.data = NULL;
+    image.first_level = 0;
+    image.preview = false;
+    image.cache_hit = image.cache_miss = false;
+    image.ingested_bytes = 0;
+    image.page_faults = image.major_page_faults = 0;
+    image.read_ms = image.decode_ms = 0.0;
+}
+
+/* the source may be a mapping of its own, not just memory */
+static void free_source(decoded_image& image)
+{
+    if (image.source)
+        asset_release(image.source);
+    delete image.source;
+    image.source = NULL;
+}
+
+static bool image_ok(const decoded_image& image)
+{
+    return image.pixels || image.ktx || image.staged.data;
+}
+
+/* where each level's texels are, in upload order; returns the level count */
+static int image_levels(const decoded_image& image, const uint8_t** level_data, size_t* level_size)
+{
+    if (image.ktx)
+    {
+        for (int l = 0; l < image.ktx->levels; l++)
+        {
+            level_data[l] = image.ktx->level_data[l];
+            level_size[l] = image.ktx->level_size[l];
+        }
+        return image.ktx->levels;
+    }
+
+    if (image.mips)
+    {
+        for (int l = 0; l < image.mips->levels; l++)
+        {
+            level_data[l] = &image.mips->texels[image.mips->offset[l]];
+            level_size[l] = (size_t)image.mips->width[l] * image.mips->height[l] * 4;
+        }
+        return image.mips->levels;
+    }
+
+    level_data[0] = image.pixels;
+    level_size[0] = (size_t)image.width * image.height * 4;
+    return 1;
+}
+
+static int level_count(const decoded_image& image)
+{
+    if (image.ktx)
+        return image.ktx->levels;
+    if (image.mips)
+        return image.mips->levels;
+    return 1;
+}
+
+static void level_size(const decoded_image& image, int level, int* width, int* height)
+{
+    if (image.ktx)
+    {
+        *width = image.ktx->width >> level ? image.ktx->width >> level : 1;
+        *height = image.ktx->height >> level ? image.ktx->height >> level : 1;
+    }
+    else if (image.mips)
+    {
+        *width = image.mips->width[level];
+        *height = image.mips->height[level];
+    }
+    else
+    {
+        *width = image.width;
+        *height = image.height;
+    }
+}
+
+static size_t level_bytes(const decoded_image& image, int level)
+{
+    if (image.ktx)
+        return image.ktx->level_size[level];
+
+    int width, height;
+    level_size(image, level, &width, &height);
+    return (size_t)width * height * 4;
+}
+
+static void free_image(decoded_image& image)
+{
+    upload_ring_release(image.staged);
+    stbi_image_free(image.pixels);
+    delete image.mips;
+    delete image.ktx;
+    free_source(image);
+    if (image.cached)
+        file_map_close(image.cached);
+    delete image.cached;
+    image.pixels = NULL;
+    image.mips = NULL;
+    image.ktx = NULL;
+    image.cached = NULL;
+    image.staged.data = NULL;
+}
+
+static bool has_extension(const std::string& path, const char* ext)
+{
+    size_t n = strlen(ext);
+    return path.size() >= n && path.compare(path.size() - n, n, ext) == 0;
+}
+
+struct texture_stream
+{
+    texture_stream_settings settings;
+    job_pool* workers;
+    GLuint placeholder;
+
+    // main thread only
+    std::vector<stream_entry> entries;
+    std::vector<texture_stream_handle> free_entries;
+    std::unordered_map<std::string, texture_stream_handle> paths;  // by path_key
+    std::unordered_map<uint64_t, gpu_texture> contents;
+    texture_stream_stats stats;
+    int pending;
+    uint64_t frame;                     // the one touches are stamped with
+    int frame_evictions, frame_mip_drops, frame_reloads;
+
+    // shared with the workers
+    SDL_mutex* lock;
+    SDL_cond* upload_space;
+    std::deque<decoded_image> uploads;
+    bool quitting;
+
+    // main thread only, again
+    std::vector<progressive_upload> progressive;
+};
+
+static texture_stream g_stream;
+
+/* a path as requested with flags: each combination decodes to different texels, so it's its own entry */
+static std::string path_key(const std::string& path, int flags)
+{
+    char suffix[16];
+    sprintf(suffix, "|%d", flags);
+    return path + suffix;
+}
+
+/* everything that changes the decoded texels, so each variant caches separately */
+static uint32_t cache_variant(int flags)
+{
+    return (uint32_t)flags | ((uint32_t)g_stream.settings.mips << 8);
+}
+
+/* a previous launch's decode, straight from the mapped cache file */
+static bool load_cached(const decode_request* req, const texture_cache_source& source, decoded_image& image)
+{
+    file_map* map = new file_map;
+    ktx_texture* ktx = new ktx_texture;
+    if (!texture_cache_load(req->path.c_str(), cache_variant(req->flags), source, map, ktx, &image.content_key))
+    {
+        delete map;
+        delete ktx;
+        return false;
+    }
+
+    image.cached = map;
+    image.ktx = ktx;
+    image.width = ktx->width;
+    image.height = ktx->height;
+    image.cache_hit = true;
+    return true;
+}
+
+static void store_cached(const decode_request* req, const texture_cache_source& source, const decoded_image& image)
+{
+    const uint8_t* level_data[MIP_MAX_LEVELS];
+    size_t level_size[MIP_MAX_LEVELS];
+    int levels = image_levels(image, level_data, level_size);
+
+    if (!texture_cache_store(req->path.c_str(), cache_variant(req->flags), source, image.width, image.height,
+                             levels, level_data, level_size, image.content_key))
+        printf("texture cache: couldn't store %s\n", req->path.c_str());
+}
+
+/*
+    uncompressed KTX levels stored as RGB, BGR or BGRA: the driver would
+    reorder those on the CPU inside glTexSubImage2D, on the main thread.
+    done here on the worker instead, into RGBA8 the upload takes as is.
+    rows in the file are padded to 4 bytes.
+*/
+static bool expand_to_rgba(ktx_texture& ktx)
+{
+    if (ktx_is_compressed(ktx) || ktx.gl_type != GL_UNSIGNED_BYTE)
+        return true;
+
+    int n;
+    bool swap;
+    switch (ktx.gl_format)
+    {
+    case GL_RGB:    n = 3; swap = false; break;
+    case GL_BGR:    n = 3; swap = true; break;
+    case GL_BGRA:   n = 4; swap = true; break;
+    default:        return true;
+    }
+
+    size_t total = 0;
+    size_t offset[MIP_MAX_LEVELS];
+    for (int l = 0; l < ktx.levels; l++)
+    {
+        size_t w = ktx.width >> l ? ktx.width >> l : 1;
+        size_t h = ktx.height >> l ? ktx.height >> l : 1;
+        if (ktx.level_size[l] < ((w * n + 3) & ~(size_t)3) * h)
+            return false;
+        offset[l] = total;
+        total += w * h * 4;
+    }
+
+    std::vector<uint8_t> rgba(total);
+    for (int l = 0; l < ktx.levels; l++)
+    {
+        size_t w = ktx.width >> l ? ktx.width >> l : 1;
+        size_t h = ktx.height >> l ? ktx.height >> l : 1;
+        size_t stride = (w * n + 3) & ~(size_t)3;
+
+        for (size_t y = 0; y < h; y++)
+        {
+            const uint8_t* src = ktx.level_data[l] + y * stride;
+            uint8_t* row = &rgba[offset[l] + y * w * 4];
+            if (n == 4)
+                pixel_swap_red_blue(PIXEL_CONVERT_AUTO, row, src, 4, w);
+            else
+            {
+                pixel_convert(PIXEL_CONVERT_AUTO, row, 4, src, 3, w);
+                if (swap)
+                    pixel_swap_red_blue(PIXEL_CONVERT_AUTO, row, row, 4, w);
+            }
+        }
+    }
+
+    /* the levels may point into storage, so only swap it in once they are converted */
+    ktx.storage.swap(rgba);
+    for (int l = 0; l < ktx.levels; l++)
+    {
+        ktx.level_data[l] = &ktx.storage[offset[l]];
+        ktx.level_size[l] = (l + 1 < ktx.levels ? offset[l + 1] : total) - offset[l];
+    }
+
+    bool srgb = ktx.gl_internal_format == GL_SRGB8 || ktx.gl_internal_format == GL_SRGB8_ALPHA8;
+    ktx.gl_format = GL_RGBA;
+    ktx.gl_internal_format = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    ktx.gl_base_internal_format = GL_RGBA;
+    return true;
+}
+
+/*
+    copy the finished levels into the upload ring and drop the CPU copies,
+    so the main thread uploads from mapped memory. the shapes (ktx header,
+    mip sizes) stay for upload_image. a full ring isn't worth waiting for
+    here: the image just uploads from client memory.
+*/
+static void stage_image(decoded_image& image)
+{
+    const uint8_t* level_data[MIP_MAX_LEVELS];
+    size_t level_size[MIP_MAX_LEVELS];
+    int levels = image_levels(image, level_data, level_size);
+
+    /* 4 byte aligned levels, GL_UNPACK_ALIGNMENT's default */
+    size_t total = 0;
+    for (int l = 0; l < levels; l++)
+    {
+        image.level_offset[l] = total;
+        total += (level_size[l] + 3) & ~(size_t)3;
+    }
+
+    upload_ring_span span;
+    if (!upload_ring_reserve(total, false, &span))
+        return;
+
+    for (int l = 0; l < levels; l++)
+        memcpy(span.data + image.level_offset[l], level_data[l], level_size[l]);
+
+    stbi_image_free(image.pixels);
+    image.pixels = NULL;
+    if (image.mips)
+        std::vector<uint8_t>().swap(image.mips->texels);
+    if (image.ktx)
+    {
+        std::vector<uint8_t>().swap(image.ktx->storage);
+        for (int l = 0; l < levels; l++)
+            image.ktx->level_data[l] = NULL;
+    }
+    free_source(image);
+    if (image.cached)
+        file_map_close(image.cached);
+    delete image.cached;
+    image.cached = NULL;
+
+    image.staged = span;
+}
+
+/*
+    the reverse, on the main thread, for an image that outlives the frame
+    it was uploaded in (progressive): the levels still to stream go back to
+    client memory and the span is released, fenced behind the uploads
+    already issued from it. the ring only ever holds a frame's spans.
+    progressive images always carry a chain, so pixels never needs this.
+*/
+static void unstage_image(decoded_image& image)
+{
+    if (!image.staged.data)
+        return;
+
+    int levels = level_count(image);
+    if (image.ktx)
+    {
+        size_t total = 0;
+        for (int l = 0; l < levels; l++)
+            total += image.ktx->level_size[l];
+        image.ktx->storage.resize(total);
+
+        size_t at = 0;
+        for (int l = 0; l < levels; l++)
+        {
+            memcpy(&image.ktx->storage[at], image.staged.data + image.level_offset[l], image.ktx->level_size[l]);
+            image.ktx->level_data[l] = &image.ktx->storage[at];
+            at += image.ktx->level_size[l];
+        }
+    }
+    else if (image.mips)
+    {
+        int last = levels - 1;
+        image.mips->texels.resize(image.mips->offset[last] + (size_t)image.mips->width[last] * image.mips->height[last] * 4);
+        for (int l = 0; l < levels; l++)
+            memcpy(&image.mips->texels[image.mips->offset[l]], image.staged.data + image.level_offset[l],
+                   (size_t)image.mips->width[l] * image.mips->height[l] * 4);
+    }
+
+    upload_ring_release(image.staged);
+    image.staged.data = NULL;
+}
+
+/* waits for room in the upload queue (or drops the image when quitting) */
+static void queue_image(decoded_image& image)
+{
+    SDL_LockMutex(g_stream.lock);
+    while ((int)g_stream.uploads.size() >= g_stream.settings.max_queued_uploads && !g_stream.quitting)
+        SDL_CondWait(g_stream.upload_space, g_stream.lock);
+
+    if (g_stream.quitting)
+        free_image(image);
+    else
+        g_stream.uploads.push_back(image);
+    SDL_UnlockMutex(g_stream.lock);
+}
+
+/*
+    a rough mip tail straight from the decoded pixels: one plain average per
+    texel of the first tail level (no sRGB decoding, it's only on screen
+    until the real levels land), then a tiny chain below it. it goes up
+    while the full chain is still being built.
+*/
+static void queue_preview(const decode_request* req, const decoded_image& image)
+{
+    int tail = g_stream.settings.progressive_tail;
+    if (tail <= 0)
+        return;
+
+    int first = 0;
+    while (image.width >> first > tail || image.height >> first > tail)
+        first++;
+    if (first == 0)
+        return;
+
+    int width = image.width >> first ? image.width >> first : 1;
+    int height = image.height >> first ? image.height >> first : 1;
+    int block = 1 << first;
+
+    std::vector<uint8_t> small((size_t)width * height * 4);
+    for (int ty = 0; ty < height; ty++)
+    {
+        int y1 = (ty + 1) * block < image.height ? (ty + 1) * block : image.height;
+        for (int tx = 0; tx < width; tx++)
+        {
+            int x1 = (tx + 1) * block < image.width ? (tx + 1) * block : image.width;
+            uint32_t sum[4] = { 0, 0, 0, 0 };
+            for (int y = ty * block; y < y1; y++)
+            {
+                const uint8_t* row = image.pixels + ((size_t)y * image.width + tx * block) * 4;
+                for (int x = tx * block; x < x1; x++, row += 4)
+                {
+                    sum[0] += row[0];
+                    sum[1] += row[1];
+                    sum[2] += row[2];
+                    sum[3] += row[3];
+                }
+            }
+
+            uint32_t count = (uint32_t)(x1 - tx * block) * (uint32_t)(y1 - ty * block);
+            for (int c = 0; c < 4; c++)
+                small[((size_t)ty * width + tx) * 4 + c] = (uint8_t)((sum[c] + count / 2) / count);
+        }
+    }
+
+    decoded_image preview;
+    init_image(preview, image.handle);
+    preview.width = image.width;
+    preview.height = image.height;
+    preview.content_key = image.content_key;
+    preview.first_level = first;
+    preview.preview = true;
+    preview.mips = new mip_chain;
+    mip_build(&small[0], width, height, 0, MIP_FILTER_BOX, !(req->flags & TEXTURE_STREAM_LINEAR),
+              MIP_SIMD_AUTO, NULL, preview.mips);
+
+    queue_image(preview);
+}
+
+static double ms_since(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+static void note_ingest(const decode_request* req, decoded_image& image, const file_map_faults& before,
+                        Uint64 read_start, Uint64 decode_start)
+{
+    file_map_faults after;
+    file_map_read_faults(&after);
+
+    image.page_faults = (int)(after.minor - before.minor + after.major - before.major);
+    image.major_page_faults = (int)(after.major - before.major);
+    image.read_ms = (double)(decode_start - read_start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+    image.decode_ms = ms_since(decode_start);
+
+    if (g_stream.settings.log_ingest)
+    {
+        printf("texture: %s %.1f KB read, %d page faults (%d major), read %.2f ms, decode %.2f ms\n",
+               req->path.c_str(), image.ingested_bytes / 1024.0, image.page_faults, image.major_page_faults,
+               image.read_ms, image.decode_ms);
+    }
+}
+
+static void decode_job(void* data)
+{
+    decode_request* req = (decode_request*)data;
+
+    decoded_image image;
+    int channels_in_file;
+    init_image(image, req->handle);
+
+    bool is_ktx = has_extension(req->path, ".ktx");
+
+    /* a loose file whose size and mtime match the cache is a hit without reading it */
+    texture_cache_source source;
+    asset_info info;
+    bool cacheable = !is_ktx && texture_cache_enabled() && asset_stat(req->path.c_str(), &info);
+    if (cacheable)
+    {
+        source.size = info.size;
+        source.mtime = info.mtime;
+        source.hash = 0;
+        source.hashed = false;
+    }
+
+    /* saved again within the mtime's resolution looks unchanged: after a change only the content decides */
+    texture_cache_source probe = source;
+    if (req->changed)
+        probe.mtime = 0;
+
+    bool loaded = cacheable && !req->changed && load_cached(req, probe, image);
+
+    /* mapped pages fault in while the hash and the decoder touch them, so count across both */
+    file_map_faults faults_before;
+    Uint64 read_start = 0, decode_start = 0;
+
+    if (!loaded)
+    {
+        file_map_read_faults(&faults_before);
+        read_start = SDL_GetPerformanceCounter();
+
+        /* straight from the archive mapping when there is one, a loose file otherwise */
+        image.source = new asset_data;
+        loaded = asset_load(req->path.c_str(), image.source);
+        image.ingested_bytes = loaded ? image.source->size : 0;
+
+        /* touched but unchanged (or packed): the content hash decides */
+        if (loaded && cacheable)
+        {
+            source.hash = hash64(image.source->bytes, image.source->size);
+            source.hashed = true;
+            probe.hash = source.hash;
+            probe.hashed = true;
+            if (load_cached(req, probe, image))
+            {
+                free_source(image);
+                cacheable = false; // nothing to store
+            }
+        }
+        decode_start = SDL_GetPerformanceCounter();
+    }
+
+    if (loaded && image.ktx)
+    {
+        /* already a hit, nothing left to do */
+    }
+    else if (loaded && is_ktx)
+    {
+        /* cooked: levels (and usually block compression) are already in the file */
+        image.ktx = new ktx_texture;
+        if (ktx_parse(image.source->bytes, image.source->size, image.ktx) && expand_to_rgba(*image.ktx))
+        {
+            image.width = image.ktx->width;
+            image.height = image.ktx->height;
+            image.content_key = hash64(image.source->bytes, image.source->size);
+        }
+        else
+            loaded = false;
+    }
+    else if (loaded)
+    {
+        /* stb's scratch buffers come from this worker's arena (when main.cpp routes them there) */
+        decode_arena_begin();
+        image.pixels = stbi_load_from_memory(image.source->bytes, (int)image.source->size,
+                                             &image.width, &image.height, &channels_in_file, 4);
+        image.pixels = (uint8_t*)decode_arena_end(image.pixels);
+        loaded = image.pixels != NULL;
+
+        /* the compressed bytes aren't needed once decoded */
+        free_source(image);
+    }
+
+    if (image.ingested_bytes)
+        note_ingest(req, image, faults_before, read_start, decode_start);
+
+    if (!loaded)
+    {
+        printf("texture load error: %s\n", req->path.c_str());
+        free_image(image);
+    }
+    else if (image.pixels)
+    {
+        /* hash on the worker so the main thread only does a table lookup */
+        size_t size = (size_t)image.width * image.height * 4;
+        uint64_t dims = ((uint64_t)image.width << 32) | (uint32_t)image.height;
+        image.content_key = hash64(image.pixels, size, dims);
+
+        if (!(req->flags & TEXTURE_STREAM_NO_MIPS))
+        {
+            image.content_key = hash64_mix(image.content_key ^ (uint64_t)req->flags);
+            queue_preview(req, image);
+
+            /* on this worker: the pool's parallelism is across textures. waiting here on bands
+               spread over the pool could pick up another decode, stuck in queue_image for room */
+            image.mips = new mip_chain;
+            mip_build(image.pixels, image.width, image.height, 0, g_stream.settings.mips,
+                      !(req->flags & TEXTURE_STREAM_LINEAR), MIP_SIMD_AUTO, NULL, image.mips);
+        }
+
+        if (cacheable)
+        {
+            store_cached(req, source, image);
+            image.cache_miss = true;
+        }
+    }
+
+    if (loaded)
+        stage_image(image);
+
+    queue_image(image); // failures are queued too, so pending settles
+    delete req;
+}
+
+void texture_stream_init(const texture_stream_settings* settings)
+{
+    texture_stream_settings defaults = { 0, 4, 4 * 1024 * 1024, MIP_FILTER_BOX, "cache/textures", 16 * 1024 * 1024, 256 * 1024 * 1024, 16, false };
+    g_stream.settings = settings ? *settings : defaults;
+    if (g_stream.settings.max_queued_uploads < 1)
+        g_stream.settings.max_queued_uploads = 1;
+
+    g_stream.lock = SDL_CreateMutex();
+    g_stream.upload_space = SDL_CreateCond();
+    g_stream.quitting = false;
+    g_stream.pending = 0;
+    g_stream.frame = 0;
+    g_stream.frame_evictions = g_stream.frame_mip_drops = g_stream.frame_reloads = 0;
+    memset(&g_stream.stats, 0, sizeof(g_stream.stats));
+
+    g_stream.workers = job_pool_create(g_stream.settings.worker_count, "texture_stream");
+    texture_cache_init(g_stream.settings.cache_dir);
+    upload_ring_init(g_stream.settings.upload_ring_bytes);
+
+    /* a single mid-grey texel stands in for anything still in flight */
+    static const uint8_t grey[4] = { 128, 128, 128, 255 };
+
+    glGenTextures(1, &g_stream.placeholder);
+    gl_state_bind_texture(GL_TEXTURE_2D, g_stream.placeholder);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, 1, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+}
+
+void texture_stream_shutdown()
+{
+    /* wake any worker waiting for queue space, they'll drop their image */
+    SDL_LockMutex(g_stream.lock);
+    g_stream.quitting = true;
+    SDL_CondBroadcast(g_stream.upload_space);
+    SDL_UnlockMutex(g_stream.lock);
+
+    job_pool_destroy(g_stream.workers);
+    g_stream.workers = NULL;
+
+    while (!g_stream.uploads.empty())
+    {
+        free_image(g_stream.uploads.front());
+        g_stream.uploads.pop_front();
+    }
+    for (size_t i = 0; i < g_stream.progressive.size(); i++)
+        free_image(g_stream.progressive[i].image);
+    g_stream.progressive.clear();
+    upload_ring_shutdown();
+
+    /* whatever is still referenced goes now */
+    std::unordered_map<uint64_t, gpu_texture>::iterator it;
+    for (it = g_stream.contents.begin(); it != g_stream.contents.end(); ++it)
+        gl_state_delete_textures(1, &it->second.name);
+
+    g_stream.contents.clear();
+    g_stream.paths.clear();
+    g_stream.entries.clear();
+    g_stream.free_entries.clear();
+
+    gl_state_delete_textures(1, &g_stream.placeholder);
+
+    SDL_DestroyCond(g_stream.upload_space);
+    SDL_DestroyMutex(g_stream.lock);
+}
+
+static void bind_to_units(const stream_entry& entry, GLuint texture)
+{
+    for (size_t i = 0; i < entry.units.size(); i++)
+    {
+        gl_state_active_texture(GL_TEXTURE0 + entry.units[i]);
+        gl_state_bind_texture(GL_TEXTURE_2D, texture);
+    }
+}
+
+static void submit_decode(texture_stream_handle handle)
+{
+    stream_entry& entry = g_stream.entries[handle];
+
+    decode_request* req = new decode_request;
+    req->handle = handle;
+    req->path = entry.path;
+    req->flags = entry.flags;
+    req->changed = entry.changed;
+    entry.changed = false;
+    job_pool_submit(g_stream.workers, decode_job, req, NULL);
+}
+
+texture_stream_handle texture_stream_request(const char* path, GLuint textureUnit, int flags)
+{
+    g_stream.stats.requests++;
+
+    /* already known? hand out another reference, no decode */
+    std::unordered_map<std::string, texture_stream_handle>::iterator found = g_stream.paths.find(path_key(path, flags));
+    if (found != g_stream.paths.end())
+    {
+        stream_entry& entry = g_stream.entries[found->second];
+        entry.refs++;
+        g_stream.stats.path_hits++;
+
+        bool known_unit = false;
+        for (size_t i = 0; i < entry.units.size(); i++)
+            known_unit |= (entry.units[i] == textureUnit);
+        if (!known_unit)
+            entry.units.push_back(textureUnit);
+
+        gl_state_active_texture(GL_TEXTURE0 + textureUnit);
+        gl_state_bind_texture(GL_TEXTURE_2D, entry.texture ? entry.texture : g_stream.placeholder);
+
+        texture_stream_touch(found->second);
+        return found->second;
+    }
+
+    texture_stream_handle handle;
+    if (!g_stream.free_entries.empty())
+    {
+        handle = g_stream.free_entries.back();
+        g_stream.free_entries.pop_back();
+    }
+    else
+    {
+        handle = (texture_stream_handle)g_stream.entries.size();
+        g_stream.entries.push_back(stream_entry());
+    }
+
+    stream_entry& entry = g_stream.entries[handle];
+    entry.path = path;
+    entry.units.assign(1, textureUnit);
+    entry.texture = 0;
+    entry.content_key = 0;
+    entry.refs = 1;
+    entry.flags = flags;
+    entry.state = ENTRY_PENDING;
+    entry.reloading = false;
+    entry.changed = false;
+
+    g_stream.paths[path_key(entry.path, flags)] = handle;
+    g_stream.pending++;
+
+    /* something valid to sample from right away */
+    gl_state_active_texture(GL_TEXTURE0 + textureUnit);
+    gl_state_bind_texture(GL_TEXTURE_2D, g_stream.placeholder);
+
+    submit_decode(handle);
+    return handle;
+}
+
+static void release_content(uint64_t key)
+{
+    std::unordered_map<uint64_t, gpu_texture>::iterator it = g_stream.contents.find(key);
+    if (it == g_stream.contents.end())
+        return;
+
+    if (--it->second.refs > 0)
+        return;
+
+    for (size_t i = 0; i < g_stream.progressive.size(); i++)
+    {
+        if (g_stream.progressive[i].key == key)
+        {
+            free_image(g_stream.progressive[i].image);
+            g_stream.progressive.erase(g_stream.progressive.begin() + i);
+            break;
+        }
+    }
+
+    gl_state_delete_textures(1, &it->second.name);
+    g_stream.stats.gpu_textures--;
+    g_stream.stats.gpu_bytes -= it->second.bytes;
+    g_stream.contents.erase(it);
+}
+
+static void free_entry(texture_stream_handle handle)
+{
+    stream_entry& entry = g_stream.entries[handle];
+
+    if (entry.texture)
+        release_content(entry.content_key);
+
+    entry.path.clear();
+    entry.units.clear();
+    entry.texture = 0;
+    entry.state = ENTRY_FREE;
+    g_stream.free_entries.push_back(handle);
+}
+
+void texture_stream_release(texture_stream_handle handle)
+{
+    if (handle < 0 || handle >= (texture_stream_handle)g_stream.entries.size())
+        return;
+
+    stream_entry& entry = g_stream.entries[handle];
+    if (entry.state == ENTRY_FREE || --entry.refs > 0)
+        return;
+
+    g_stream.paths.erase(path_key(entry.path, entry.flags));
+
+    /* a decode still in flight owns the slot until its image shows up in pump */
+    if (entry.state != ENTRY_PENDING && !entry.reloading)
+        free_entry(handle);
+}
+
+static bool compressed_format_supported(GLenum format)
+{
+    switch (format)
+    {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        return GLEW_EXT_texture_compression_s3tc != 0;
+    case GL_COMPRESSED_RG_RGTC2:
+        return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+    }
+    return true; // let GL decide
+}
+
+/* a client pointer, or with the ring bound, the level's offset into it */
+static const void* level_pixels(const decoded_image& image, int level, const void* client)
+{
+    if (image.staged.data)
+        return (const void*)(uintptr_t)(image.staged.offset + image.level_offset[level]);
+    return client;
+}
+
+/* every entry holding key now samples name */
+static void retarget_entries(uint64_t key, GLuint name)
+{
+    for (size_t i = 0; i < g_stream.entries.size(); i++)
+    {
+        stream_entry& entry = g_stream.entries[i];
+        if (entry.texture && entry.content_key == key)
+        {
+            entry.texture = name;
+            bind_to_units(entry, name);
+        }
+    }
+}
+
+/* the first texture unit anyone holding key is bound on, for GL work on it */
+static GLuint unit_holding(uint64_t key)
+{
+    for (size_t i = 0; i < g_stream.entries.size(); i++)
+    {
+        const stream_entry& entry = g_stream.entries[i];
+        if (entry.texture && entry.content_key == key && !entry.units.empty())
+            return entry.units[0];
+    }
+    return 0;
+}
+
+/* storage for the whole chain image belongs to (not just the levels it carries), bound on unit */
+static void allocate_texture(const decoded_image& image, GLuint unit, gpu_texture* gpu)
+{
+    gpu->width = image.width;
+    gpu->height = image.height;
+    gpu->levels = image.first_level + level_count(image);
+    gpu->internal_format = image.ktx ? image.ktx->gl_internal_format : GL_RGBA8;
+
+    gl_state_active_texture(GL_TEXTURE0 + unit);
+
+    glGenTextures(1, &gpu->name);
+    gl_state_bind_texture(GL_TEXTURE_2D, gpu->name);
+    glTexStorage2D(GL_TEXTURE_2D, gpu->levels, gpu->internal_format, gpu->width, gpu->height);
+
+    /* the whole chain, allocated up front, nothing left for the driver to generate */
+    if (gpu->levels > 1)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    gpu->bytes = 0;
+    for (int l = 0; l < gpu->levels; l++)
+    {
+        int w = gpu->width >> l ? gpu->width >> l : 1;
+        int h = gpu->height >> l ? gpu->height >> l : 1;
+        gpu->level_bytes[l] = image.ktx ? image.ktx->level_size[l] : (size_t)w * h * 4;
+        gpu->bytes += gpu->level_bytes[l];
+    }
+    gpu->full_bytes = gpu->bytes;
+    gpu->dropped = 0;
+    gpu->base_level = 0;
+    gpu->loading = false;
+    gpu->last_used = g_stream.frame;
+}
+
+/* image levels [first, end) into the bound texture, coarsest first */
+static void upload_levels(const decoded_image& image, int first, int end)
+{
+    if (image.staged.data)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, upload_ring_buffer());
+
+    for (int l = end - 1; l >= first; l--)
+    {
+        int level = image.first_level + l;
+        int w, h;
+        level_size(image, l, &w, &h);
+
+        if (image.ktx && ktx_is_compressed(*image.ktx))
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, image.ktx->gl_internal_format,
+                                      (GLsizei)image.ktx->level_size[l], level_pixels(image, l, image.ktx->level_data[l]));
+        else if (image.ktx)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, image.ktx->gl_format, image.ktx->gl_type,
+                            level_pixels(image, l, image.ktx->level_data[l]));
+        else if (image.mips)
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE,
+                            level_pixels(image, l, image.staged.data ? NULL : &image.mips->texels[image.mips->offset[l]]));
+        else
+            glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, w, h, GL_RGBA, GL_UNSIGNED_BYTE, level_pixels(image, l, image.pixels));
+    }
+
+    if (image.staged.data)
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+/* on the bound texture */
+static void set_base_level(gpu_texture& gpu, int level)
+{
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    gpu.base_level = level;
+}
+
+/* the image level uploads start at: the largest within progressive_tail, 0 for everything at once */
+static int first_upload_level(const decoded_image& image)
+{
+    int tail = g_stream.settings.progressive_tail;
+    int count = level_count(image);
+    if (tail <= 0 || count < 2 || image.first_level > 0)
+        return 0;
+
+    for (int l = 0; l < count; l++)
+    {
+        int w, h;
+        level_size(image, l, &w, &h);
+        if (w <= tail && h <= tail)
+            return l;
+    }
+    return count - 1;
+}
+
+/* what an image costs the frame it is first uploaded in */
+static size_t upload_cost(const decoded_image& image)
+{
+    if (!image_ok(image))
+        return 0;
+
+    size_t total = 0;
+    for (int l = first_upload_level(image); l < level_count(image); l++)
+        total += level_bytes(image, l);
+    return total;
+}
+
+static bool is_streaming(uint64_t key)
+{
+    for (size_t i = 0; i < g_stream.progressive.size(); i++)
+    {
+        if (g_stream.progressive[i].key == key)
+            return true;
+    }
+    return false;
+}
+
+static void upload_preview(decoded_image& image)
+{
+    stream_entry& entry = g_stream.entries[image.handle];
+
+    /* unwanted, or something (shared content, levels kept from before) already shows */
+    if (entry.refs <= 0 || entry.texture || g_stream.contents.count(image.content_key))
+    {
+        free_image(image);
+        return;
+    }
+
+    gpu_texture gpu;
+    allocate_texture(image, entry.units[0], &gpu);
+    upload_levels(image, 0, level_count(image));
+    set_base_level(gpu, image.first_level);
+    gpu.loading = true;
+    gpu.refs = 1;
+    free_image(image);
+
+    g_stream.contents[image.content_key] = gpu;
+    g_stream.stats.gpu_textures++;
+    g_stream.stats.gpu_bytes += gpu.bytes;
+    g_stream.stats.previews++;
+
+    /* still pending: the image itself is right behind it */
+    entry.texture = gpu.name;
+    entry.content_key = image.content_key;
+    bind_to_units(entry, gpu.name);
+}
+
+/*
+    a hot reload that kept the size and format: the texture keeps its name
+    and storage, only its key changes. not when it is shared (the others
+    still want the old texels), nor while it is short of levels.
+*/
+static bool update_in_place(stream_entry& entry, decoded_image& image)
+{
+    std::unordered_map<uint64_t, gpu_texture>::iterator it = g_stream.contents.find(entry.content_key);
+    if (it == g_stream.contents.end() || g_stream.contents.count(image.content_key))
+        return false;
+
+    gpu_texture gpu = it->second;
+    GLenum format = image.ktx ? image.ktx->gl_internal_format : GL_RGBA8;
+    if (gpu.refs > 1 || gpu.dropped || gpu.loading || image.first_level != 0 || gpu.width != image.width ||
+        gpu.height != image.height || gpu.levels != level_count(image) || gpu.internal_format != format)
+        return false;
+
+    gl_state_active_texture(GL_TEXTURE0 + entry.units[0]);
+    gl_state_bind_texture(GL_TEXTURE_2D, gpu.name);
+    upload_levels(image, 0, level_count(image));
+    g_stream.stats.staged_uploads += image.staged.data ? 1 : 0;
+    g_stream.stats.in_place_reloads++;
+
+    gpu.last_used = g_stream.frame;
+    g_stream.contents.erase(it);
+    g_stream.contents[image.content_key] = gpu;
+
+    entry.content_key = image.content_key;
+    entry.state = ENTRY_READY;
+    free_image(image);
+    return true;
+}
+
+static void upload_image(decoded_image& image)
+{
+    if (image.preview)
+    {
+        upload_preview(image);
+        return;
+    }
+
+    stream_entry& entry = g_stream.entries[image.handle];
+    entry.reloading = false;
+
+    /* released while decoding, nobody wants it anymore */
+    if (entry.refs <= 0)
+    {
+        free_image(image);
+        free_entry(image.handle);
+        return;
+    }
+
+    /* a reload that fails keeps whatever levels it still has */
+    if (!image_ok(image))
+    {
+        if (!entry.texture)
+            entry.state = ENTRY_FAILED;
+        return; // leave the placeholder bound
+    }
+
+    if (image.ktx && ktx_is_compressed(*image.ktx) && !compressed_format_supported(image.ktx->gl_internal_format))
+    {
+        printf("texture load error: %s is in a compressed format this GL can't sample\n", entry.path.c_str());
+        free_image(image);
+        if (!entry.texture)
+            entry.state = ENTRY_FAILED;
+        return;
+    }
+
+    /* reloaded, but the pixels changed since: new texels into the same texture if it can take them */
+    if (entry.texture && entry.content_key != image.content_key && update_in_place(entry, image))
+        return;
+
+    /* otherwise let go of the old ones */
+    if (entry.texture && entry.content_key != image.content_key)
+    {
+        release_content(entry.content_key);
+        entry.texture = 0;
+    }
+    bool holds = entry.texture != 0;
+
+    std::unordered_map<uint64_t, gpu_texture>::iterator it = g_stream.contents.find(image.content_key);
+    bool found = it != g_stream.contents.end();
+
+    /* already on the GPU in full (or on its way there) under another path, or this one? share it */
+    if (found && !it->second.dropped && (!it->second.loading || is_streaming(image.content_key)))
+    {
+        if (!holds)
+        {
+            it->second.refs++;
+            g_stream.stats.content_dedupes++;
+        }
+        it->second.last_used = g_stream.frame;
+
+        entry.texture = it->second.name;
+        entry.content_key = image.content_key;
+        entry.state = ENTRY_READY;
+
+        bind_to_units(entry, entry.texture);
+        free_image(image);
+        return;
+    }
+
+    /* only a preview's tail is up: this image streams in the finer levels */
+    if (found && it->second.loading)
+    {
+        if (!holds)
+            it->second.refs++;
+
+        unstage_image(image);
+        progressive_upload job;
+        job.key = image.content_key;
+        job.image = image;
+        job.level = it->second.base_level;
+        g_stream.progressive.push_back(job);
+
+        entry.texture = it->second.name;
+        entry.content_key = image.content_key;
+        entry.state = ENTRY_READY;
+
+        bind_to_units(entry, entry.texture);
+        return;
+    }
+
+    /* a restore goes up whole, the levels it replaces are already on screen */
+    gpu_texture gpu;
+    int first = found ? 0 : first_upload_level(image);
+
+    allocate_texture(image, entry.units[0], &gpu);
+    upload_levels(image, first, level_count(image));
+    g_stream.stats.staged_uploads += image.staged.data ? 1 : 0;
+
+    if (first > 0)
+    {
+        set_base_level(gpu, first);
+        gpu.loading = true;
+
+        unstage_image(image); // the finer levels wait in client memory, the span is fenced behind these uploads
+        progressive_upload job;
+        job.key = image.content_key;
+        job.image = image;
+        job.level = first;
+        g_stream.progressive.push_back(job);
+    }
+    else
+        free_image(image); // releases the span: the next submit fences it behind these uploads
+
+    if (found)
+    {
+        /* back in full, in place of the dropped copy everyone sharing it samples */
+        gpu.refs = it->second.refs + (holds ? 0 : 1);
+        gl_state_delete_textures(1, &it->second.name);
+        g_stream.stats.gpu_bytes -= it->second.bytes;
+        it->second = gpu;
+    }
+    else
+    {
+        gpu.refs = 1;
+        g_stream.contents[image.content_key] = gpu;
+        g_stream.stats.gpu_textures++;
+    }
+    g_stream.stats.gpu_bytes += gpu.bytes;
+
+    entry.texture = gpu.name;
+    entry.content_key = image.content_key;
+    entry.state = ENTRY_READY;
+
+    retarget_entries(image.content_key, gpu.name);
+}
+
+/*
+    one finer level at a time, always the cheapest one pending, so every
+    texture on screen sharpens at about the same rate. bytes is what the
+    frame has uploaded already; at least one level goes per pump.
+*/
+static void stream_levels(size_t bytes)
+{
+    bool any = false;
+
+    while (!g_stream.progressive.empty())
+    {
+        size_t next = 0;
+        for (size_t i = 1; i < g_stream.progressive.size(); i++)
+        {
+            const progressive_upload& a = g_stream.progressive[i];
+            const progressive_upload& b = g_stream.progressive[next];
+            if (level_bytes(a.image, a.level - 1) < level_bytes(b.image, b.level - 1))
+                next = i;
+        }
+
+        progressive_upload& job = g_stream.progressive[next];
+        size_t size = level_bytes(job.image, job.level - 1);
+        if (any && bytes + size > g_stream.settings.upload_bytes_per_frame)
+            break;
+
+        gpu_texture& gpu = g_stream.contents[job.key];
+        gl_state_active_texture(GL_TEXTURE0 + unit_holding(job.key));
+        gl_state_bind_texture(GL_TEXTURE_2D, gpu.name);
+
+        job.level--;
+        upload_levels(job.image, job.level, job.level + 1);
+        set_base_level(gpu, job.image.first_level + job.level);
+
+        bytes += size;
+        any = true;
+        g_stream.stats.streamed_levels++;
+
+        if (job.level == 0)
+        {
+            gpu.loading = false;
+            free_image(job.image);
+            g_stream.progressive.erase(g_stream.progressive.begin() + next);
+        }
+    }
+}
+
+/* a decode of the file as it is now, for an entry that isn't waiting on one already */
+static void start_hot_reload(texture_stream_handle handle)
+{
+    stream_entry& entry = g_stream.entries[handle];
+    if (entry.state == ENTRY_READY && !entry.reloading)
+        entry.reloading = true;
+    else if (entry.state == ENTRY_FAILED)
+        entry.state = ENTRY_PENDING;
+    else
+        return; // in flight, or evicted: the decode that brings it back reads the new file
+
+    g_stream.pending++;
+    g_stream.stats.hot_reloads++;
+    submit_decode(handle);
+}
+
+/* another decode of an entry that was evicted, or that dropped levels */
+static void reload_entry(texture_stream_handle handle)
+{
+    stream_entry& entry = g_stream.entries[handle];
+    if (entry.state == ENTRY_EVICTED)
+        entry.state = ENTRY_PENDING;
+    else
+        entry.reloading = true;
+
+    g_stream.pending++;
+    g_stream.stats.reloads++;
+    g_stream.frame_reloads++;
+    submit_decode(handle);
+}
+
+static bool can_drop_level(const gpu_texture& gpu)
+{
+    if (!(GLEW_VERSION_4_3 || GLEW_ARB_copy_image) || gpu.levels < 2)
+        return false;
+    return (gpu.width < gpu.height ? gpu.width : gpu.height) / 2 >= RESIDENCY_MIN_SIDE;
+}
+
+/* the same texture minus its top level, copied down on the GPU into a smaller allocation */
+static void drop_top_level(uint64_t key, gpu_texture& gpu)
+{
+    int width = gpu.width >> 1 ? gpu.width >> 1 : 1;
+    int height = gpu.height >> 1 ? gpu.height >> 1 : 1;
+    GLuint smaller;
+
+    gl_state_active_texture(GL_TEXTURE0 + unit_holding(key));
+    glGenTextures(1, &smaller);
+    gl_state_bind_texture(GL_TEXTURE_2D, smaller);
+    glTexStorage2D(GL_TEXTURE_2D, gpu.levels - 1, gpu.internal_format, width, height);
+
+    for (int l = 1; l < gpu.levels; l++)
+    {
+        int w = gpu.width >> l ? gpu.width >> l : 1;
+        int h = gpu.height >> l ? gpu.height >> l : 1;
+        glCopyImageSubData(gpu.name, GL_TEXTURE_2D, l, 0, 0, 0, smaller, GL_TEXTURE_2D, l - 1, 0, 0, 0, w, h, 1);
+        gpu.level_bytes[l - 1] = gpu.level_bytes[l];
+    }
+    if (gpu.levels > 2)
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+    gl_state_delete_textures(1, &gpu.name);
+    retarget_entries(key, smaller);
+
+    size_t before = gpu.bytes;
+    gpu.name = smaller;
+    gpu.width = width;
+    gpu.height = height;
+    gpu.levels--;
+    gpu.dropped++;
+    gpu.bytes = 0;
+    for (int l = 0; l < gpu.levels; l++)
+        gpu.bytes += gpu.level_bytes[l];
+    g_stream.stats.gpu_bytes -= before - gpu.bytes;
+}
+
+/* off the GPU entirely: everyone sharing it goes back to the placeholder until touched */
+static void evict(std::unordered_map<uint64_t, gpu_texture>::iterator it)
+{
+    for (size_t i = 0; i < g_stream.entries.size(); i++)
+    {
+        stream_entry& entry = g_stream.entries[i];
+        if (entry.texture && entry.content_key == it->first)
+        {
+            entry.texture = 0;
+            entry.content_key = 0;
+            entry.state = ENTRY_EVICTED;
+            bind_to_units(entry, g_stream.placeholder);
+        }
+    }
+
+    gl_state_delete_textures(1, &it->second.name);
+    g_stream.stats.gpu_textures--;
+    g_stream.stats.gpu_bytes -= it->second.bytes;
+    g_stream.contents.erase(it);
+}
+
+/* least recently sampled first, never anything sampled during the frame that just ended */
+static void enforce_budget()
+{
+    size_t budget = g_stream.settings.budget_bytes;
+
+    while (budget && g_stream.stats.gpu_bytes > budget)
+    {
+        std::unordered_map<uint64_t, gpu_texture>::iterator it, victim = g_stream.contents.end();
+        for (it = g_stream.contents.begin(); it != g_stream.contents.end(); ++it)
+        {
+            const gpu_texture& gpu = it->second;
+            if (gpu.last_used >= g_stream.frame || gpu.loading)
+                continue;
+            if (victim == g_stream.contents.end() || gpu.last_used < victim->second.last_used ||
+                (gpu.last_used == victim->second.last_used && gpu.bytes > victim->second.bytes))
+                victim = it;
+        }
+
+        /* everything left is in use: over budget it is */
+        if (victim == g_stream.contents.end())
+            break;
+
+        if (can_drop_level(victim->second))
+        {
+            drop_top_level(victim->first, victim->second);
+            g_stream.stats.mip_drops++;
+            g_stream.frame_mip_drops++;
+        }
+        else
+        {
+            evict(victim);
+            g_stream.stats.evictions++;
+            g_stream.frame_evictions++;
+        }
+    }
+}
+
+void texture_stream_pump()
+{
+    std::vector<decoded_image> batch;
+    size_t bytes = 0;
+
+    /* before anything new lands, so the frame's uploads aren't the first to go */
+    enforce_budget();
+    g_stream.frame++;
+
+    /* grab this frame's share under the lock, do the GL work outside it */
+    SDL_LockMutex(g_stream.lock);
+    while (!g_stream.uploads.empty())
+    {
+        const decoded_image& next = g_stream.uploads.front();
+        size_t size = upload_cost(next);
+
+        if (!batch.empty() && bytes + size > g_stream.settings.upload_bytes_per_frame)
+            break;
+
+        bytes += size;
+        batch.push_back(next);
+        g_stream.uploads.pop_front();
+    }
+    if (!batch.empty())
+        SDL_CondBroadcast(g_stream.upload_space);
+    SDL_UnlockMutex(g_stream.lock);
+
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        g_stream.stats.cache_hits += batch[i].cache_hit ? 1 : 0;
+        g_stream.stats.cache_misses += batch[i].cache_miss ? 1 : 0;
+        g_stream.stats.ingested_bytes += batch[i].ingested_bytes;
+        g_stream.stats.page_faults += batch[i].page_faults;
+        g_stream.stats.major_page_faults += batch[i].major_page_faults;
+        g_stream.stats.read_ms += batch[i].read_ms;
+        g_stream.stats.decode_ms += batch[i].decode_ms;
+        g_stream.pending -= batch[i].preview ? 0 : 1;
+        upload_image(batch[i]);
+
+        /* saved again while that decode was running */
+        texture_stream_handle handle = batch[i].handle;
+        if (!batch[i].preview && g_stream.entries[handle].changed)
+            start_hot_reload(handle);
+    }
+
+    /* new arrivals first (their tails are small), then sharpen what is already showing */
+    stream_levels(bytes);
+
+    upload_ring_submit();
+
+    g_stream.stats.frame_evictions = g_stream.frame_evictions;
+    g_stream.stats.frame_mip_drops = g_stream.frame_mip_drops;
+    g_stream.stats.frame_reloads = g_stream.frame_reloads;
+    g_stream.frame_evictions = g_stream.frame_mip_drops = g_stream.frame_reloads = 0;
+}
+
+void texture_stream_touch(texture_stream_handle handle)
+{
+    if (handle < 0 || handle >= (texture_stream_handle)g_stream.entries.size())
+        return;
+
+    /* evicted while a reload was in flight: that decode brings it back */
+    stream_entry& entry = g_stream.entries[handle];
+    if (entry.state == ENTRY_EVICTED)
+    {
+        if (!entry.reloading)
+            reload_entry(handle);
+        return;
+    }
+    if (entry.state != ENTRY_READY)
+        return;
+
+    std::unordered_map<uint64_t, gpu_texture>::iterator it = g_stream.contents.find(entry.content_key);
+    if (it == g_stream.contents.end())
+        return;
+
+    gpu_texture& gpu = it->second;
+    gpu.last_used = g_stream.frame;
+
+    /* dropped levels only come back when they fit, or the budget would take them straight away */
+    size_t budget = g_stream.settings.budget_bytes;
+    if (gpu.dropped && !entry.reloading &&
+        (!budget || g_stream.stats.gpu_bytes + (gpu.full_bytes - gpu.bytes) <= budget))
+        reload_entry(handle);
+}
+
+bool texture_stream_reload(const char* path)
+{
+    /* every variant still requested: one per set of flags the path was asked for with */
+    bool streamed = false;
+    for (size_t i = 0; i < g_stream.entries.size(); i++)
+    {
+        texture_stream_handle handle = (texture_stream_handle)i;
+        stream_entry& entry = g_stream.entries[handle];
+        if (entry.state == ENTRY_FREE || entry.path != path)
+            continue;
+
+        std::unordered_map<std::string, texture_stream_handle>::iterator found = g_stream.paths.find(path_key(path, entry.flags));
+        if (found == g_stream.paths.end() || found->second != handle)
+            continue;
+
+        entry.changed = true;
+        start_hot_reload(handle);
+        streamed = true;
+    }
+    return streamed;
+}
+
+GLuint texture_stream_texture(texture_stream_handle handle)
+{
+    if (handle < 0 || handle >= (texture_stream_handle)g_stream.entries.size())
+        return g_stream.placeholder;
+
+    texture_stream_touch(handle);
+
+    GLuint texture = g_stream.entries[handle].texture;
+    return texture ? texture : g_stream.placeholder;
+}
+
+bool texture_stream_is_ready(texture_stream_handle handle)
+{
+    if (handle < 0 || handle >= (texture_stream_handle)g_stream.entries.size())
+        return false;
+
+    return g_stream.entries[handle].state == ENTRY_READY;
+}
+
+int texture_stream_pending()
+{
+    return g_stream.pending;
+}
+
+void texture_stream_get_stats(texture_stream_stats* stats)
+{
+    *stats = g_stream.stats;
+}
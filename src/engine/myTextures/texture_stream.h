@@ -0,0 +1,137 @@
+/*
+    asynchronous, cached texture streaming
+    ----------------------------
+    texture_stream_request() returns right away with a placeholder bound to the
+    requested texture unit. a pool of SDL worker threads decodes the image, and
+    texture_stream_pump() (main thread, once per frame) drains a bounded queue
+    of decoded images into GL, uploading at most a byte budget per frame.
+    once a texture lands, it replaces the placeholder on its texture unit(s).
+
+    paths are interned with their flags: asking for a path again with the same
+    flags hands back the same ref-counted handle without decoding again (other
+    flags are another texture). decoded pixels are also hashed, so two files
+    with identical content end up sharing a single GL texture.
+
+    unless asked not to, every texture gets a full mip chain built on the
+    workers (see mip_builder.h) and allocated with the matching level count.
+    paths ending in .ktx are cooked textures (tools/texture_cooker.cpp): their
+    levels, block compressed or not, are uploaded exactly as stored.
+
+    everything else is decoded once and kept in a cache directory next to the
+    executable (see texture_cache.h); later launches map the cached levels
+    instead of decoding the image again. sources that do have to be read are
+    memory mapped (see asset_archive.h) and decoded straight from the
+    mapping; stats count the bytes, page faults and time that took.
+
+    finished levels are copied into a persistently mapped upload ring on the
+    worker (see myOpenGL/upload_ring.h), so the upload on the main thread is
+    a DMA from the ring rather than a copy out of client memory. images that
+    don't fit when the ring is full upload from client memory as before.
+
+    textures live within a byte budget. whatever wasn't sampled (touched)
+    during the last frame is a candidate once the budget is exceeded, least
+    recently sampled first: it gives up its top mip level (copied down on the
+    GPU, GL 4.3) until it is small, then leaves the GPU entirely, leaving
+    the placeholder bound. touching it again decodes it again.
+
+    textures with a mip chain arrive coarse first: the tail (levels up to
+    progressive_tail texels) is uploaded with GL_TEXTURE_BASE_LEVEL raised to
+    it, then each pump uploads finer levels and lowers the base level. a
+    decode that misses the cache also sends a quick downscaled tail before
+    the chain is built, so objects show the right colours early.
+
+    texture_stream_reload() (fed by myCore/file_watch.h in main.cpp) decodes
+    a changed file again on a worker. when its size, format and level count
+    are what the texture already has, the new levels go into the same GL
+    texture with glTexSubImage2D; otherwise it is replaced like any other
+    changed content. the old texels stay up until then.
+*/
+#pragma once
+
+#include <stddef.h>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "myTextures/mip_builder.h"
+
+typedef int texture_stream_handle;
+
+enum texture_stream_flags
+{
+    TEXTURE_STREAM_LINEAR = 1,      // data, not colour (normal maps...): filter without sRGB decoding
+    TEXTURE_STREAM_NO_MIPS = 2      // the image's own level only, no chain built
+};
+
+struct texture_stream_settings
+{
+    int worker_count;               // <= 0: one per core, minus the main thread
+    int max_queued_uploads;         // decoded images allowed to wait for upload
+    size_t upload_bytes_per_frame;  // soft budget, at least one image goes per pump
+    mip_filter mips;                // how the mip chain is downsampled
+    const char* cache_dir;          // decoded texture cache, relative to the executable; NULL for none
+    size_t upload_ring_bytes;       // persistently mapped staging for uploads; 0 for none
+    size_t budget_bytes;            // texture memory to stay within; 0 for no limit
+    int progressive_tail;           // largest mip uploaded first, finer ones stream in; 0 for all at once
+    bool log_ingest;                // print what reading and decoding each source cost
+};
+
+struct texture_stream_stats
+{
+    int requests;           // every texture_stream_request call
+    int path_hits;          // requests answered by an already interned path
+    int content_dedupes;    // decodes that matched pixels already on the GPU
+    int gpu_textures;       // live GL textures owned by the stream
+    size_t gpu_bytes;       // their estimated size
+    int cache_hits;         // decodes skipped thanks to the texture cache
+    int cache_misses;       // decodes that (re)filled it
+    int staged_uploads;     // uploads sourced from the upload ring instead of client memory
+    int evictions;          // textures taken off the GPU to stay within the budget
+    int mip_drops;          // top levels given up before that
+    int reloads;            // evicted or dropped textures decoded again once sampled
+    int previews;           // quick downscaled tails shown before their decode finished
+    int streamed_levels;    // finer levels uploaded after a texture first appeared
+    int hot_reloads;        // decodes started because the file changed
+    int in_place_reloads;   // of those, uploaded into the texture already there
+
+    /* reading sources (decodes that didn't hit the cache by size and mtime) */
+    size_t ingested_bytes;  // source bytes read through a mapping
+    int page_faults;        // taken while hashing and decoding them, see file_map_read_faults
+    int major_page_faults;  // the ones that waited on the disk
+    double read_ms;         // mapping and hashing, summed over workers
+    double decode_ms;       // decoding (or the cache lookup the hash allowed)
+
+    /* the same three, for the last frame only (reset by every pump) */
+    int frame_evictions;
+    int frame_mip_drops;
+    int frame_reloads;
+};
+
+/* settings may be NULL for the defaults */
+void texture_stream_init(const texture_stream_settings* settings);
+void texture_stream_shutdown();
+
+/* path is relative to the executable (g_root_path); each request takes a reference */
+texture_stream_handle texture_stream_request(const char* path, GLuint textureUnit, int flags = 0);
+void texture_stream_release(texture_stream_handle handle);
+
+/* upload whatever is decoded, within this frame's budget */
+void texture_stream_pump();
+
+/*
+    marks a texture as sampled this frame, which keeps it off the eviction
+    list, and brings it back (in full) if it was evicted or dropped levels
+*/
+void texture_stream_touch(texture_stream_handle handle);
+
+/* the file behind path changed: decode it again if it is streamed (false if it isn't) */
+bool texture_stream_reload(const char* path);
+
+/* placeholder name until the real texture has been uploaded; counts as a touch */
+GLuint texture_stream_texture(texture_stream_handle handle);
+bool texture_stream_is_ready(texture_stream_handle handle);
+
+/* requests that have not reached the GPU yet */
+int texture_stream_pending();
+
+void texture_stream_get_stats(texture_stream_stats* stats);
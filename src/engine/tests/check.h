@@ -0,0 +1,40 @@
+/*
+    headless test checks
+    ----------------------------
+    each test is its own executable, registered with CTest. a failed CHECK
+    prints where and carries on, so one run reports every failure; main
+    returns check_result(), nonzero if any failed.
+*/
+#pragma once
+
+#include <stdio.h>
+
+static int g_check_failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) \
+        { \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            g_check_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long check_a = (long long)(a), check_b = (long long)(b); \
+        if (check_a != check_b) \
+        { \
+            printf("%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, check_a, check_b); \
+            g_check_failures++; \
+        } \
+    } while (0)
+
+static int check_result(const char* name)
+{
+    if (g_check_failures)
+        printf("%s: %d check(s) failed\n", name, g_check_failures);
+    else
+        printf("%s: ok\n", name);
+    return g_check_failures ? 1 : 0;
+}
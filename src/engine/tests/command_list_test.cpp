@@ -0,0 +1,174 @@
+/*
+    command list test
+    ----------------------------
+    records the same items on one thread and across a job_pool and checks
+    the two come out the same: byte for byte per list, and as the stream
+    of GL state calls (through a stub gl_state_gl table) and render packets
+    their replay produces. replay here never reaches real GL: the lists it
+    replays hold binds and packets only, and the packets are sorted, never
+    drawn.
+*/
+
+#include "myOpenGL/command_list.h"
+#include "myOpenGL/gl_state.h"
+#include "myCore/hash.h"
+#include "tests/check.h"
+
+#define LIST_COUNT 16
+#define ITEM_COUNT 20000
+
+static uint64_t g_trace;
+static int g_calls;
+
+static void trace(uint64_t a, uint64_t b)
+{
+    uint64_t call[2] = { a, b };
+    g_trace = hash64(call, sizeof(call), g_trace);
+    g_calls++;
+}
+
+static void GLAPIENTRY stub_use_program(GLuint program) { trace(1, program); }
+static void GLAPIENTRY stub_bind_vertex_array(GLuint vao) { trace(2, vao); }
+static void GLAPIENTRY stub_bind_buffer(GLenum target, GLuint buffer) { trace(target, buffer); }
+static void GLAPIENTRY stub_active_texture(GLenum texture) { trace(3, texture); }
+static void GLAPIENTRY stub_bind_texture(GLenum target, GLuint texture) { trace(target, texture); }
+static void GLAPIENTRY stub_polygon_mode(GLenum face, GLenum mode) { trace(face, mode); }
+static void GLAPIENTRY stub_viewport(GLint, GLint, GLsizei, GLsizei) {}
+static void GLAPIENTRY stub_cap(GLenum) {}
+static void GLAPIENTRY stub_names(GLsizei, const GLuint*) {}
+static void GLAPIENTRY stub_blend_func(GLenum, GLenum) {}
+static void GLAPIENTRY stub_depth_func(GLenum) {}
+static void GLAPIENTRY stub_depth_mask(GLboolean) {}
+
+/* stands in for scene traversal: some work per item, then its commands */
+static void record_everything(void*, command_list* list, int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+    {
+        float x = 0;
+        for (int k = 0; k < 50; k++)
+            x += (float)((i * k) % 7);
+
+        command_list_use_program(list, 1 + i % 3);
+        command_list_bind_texture(list, i % 2, GL_TEXTURE_2D, 10 + i % 5);
+        command_list_bind_vertex_array(list, 1 + (int)x % 4);
+
+        uniform_vec4 color = { i % 4 };
+        GLfloat value[4] = { x, 0.0f, 1.0f, (float)i };
+        command_list_set_vec4(list, NULL, color, value);
+        uniform_int inactive = { -1 };
+        command_list_set_int(list, NULL, inactive, i);          // records nothing
+
+        command_list_draw_elements(list, GL_TRIANGLES, 3 + i % 9, GL_UNSIGNED_SHORT, i * 2);
+        if (i % 10 == 0)
+            command_list_draw_arrays(list, GL_TRIANGLES, i, 3);
+    }
+}
+
+/* what replays without a context: binds and packets */
+static void record_replayable(void*, command_list* list, int begin, int end)
+{
+    for (int i = begin; i < end; i++)
+    {
+        command_list_use_program(list, 1 + i % 3);
+        command_list_bind_texture(list, i % 2, GL_TEXTURE_2D, 10 + i % 5);
+        command_list_polygon_mode(list, i % 7 ? GL_FILL : GL_LINE);
+
+        render_packet packet = {};
+        packet.program = 1 + i % 5;
+        packet.vao = 1 + i % 11;
+        packet.texture_count = 1;
+        packet.textures[0] = 20 + i % 13;
+        packet.primitive = GL_TRIANGLES;
+        packet.count = 6;
+        packet.user = (void*)(intptr_t)i;
+        command_list_submit(list, i % 2, packet, (i % 100) / 99.0f);
+    }
+}
+
+struct replay
+{
+    uint64_t trace;
+    int calls;
+    render_queue_stats stats;
+};
+
+static replay replay_lists(command_list* const* lists)
+{
+    static gl_state_gl stub = {
+        stub_use_program, stub_bind_vertex_array, stub_names, stub_bind_buffer, stub_names,
+        stub_active_texture, stub_bind_texture, stub_names, stub_polygon_mode, stub_viewport,
+        stub_cap, stub_cap, stub_blend_func, stub_depth_func, stub_depth_mask
+    };
+    gl_state_init(&stub);
+    g_trace = 0;
+    g_calls = 0;
+
+    render_queue* queue = render_queue_create(ITEM_COUNT);
+    command_lists_execute(lists, LIST_COUNT, queue);
+    render_queue_sort(queue);
+
+    replay result;
+    result.trace = g_trace;
+    result.calls = g_calls;
+    render_queue_get_stats(queue, &result.stats);
+
+    render_queue_clear(queue);
+    render_queue_destroy(queue);
+    return result;
+}
+
+int main()
+{
+    job_pool* pool = job_pool_create(8, "command_list_test");
+    command_list* inline_lists[LIST_COUNT];
+    command_list* pool_lists[LIST_COUNT];
+    for (int i = 0; i < LIST_COUNT; i++)
+    {
+        inline_lists[i] = command_list_create(64);      // small, so recording has to grow them
+        pool_lists[i] = command_list_create(64);
+    }
+
+    /* byte for byte, every kind of command */
+    command_lists_record(NULL, inline_lists, LIST_COUNT, ITEM_COUNT, record_everything, NULL);
+    command_lists_record(pool, pool_lists, LIST_COUNT, ITEM_COUNT, record_everything, NULL);
+
+    int commands = 0;
+    for (int i = 0; i < LIST_COUNT; i++)
+    {
+        CHECK_EQ(command_list_count(pool_lists[i]), command_list_count(inline_lists[i]));
+        CHECK_EQ(command_list_bytes(pool_lists[i]), command_list_bytes(inline_lists[i]));
+        CHECK(command_list_hash(pool_lists[i]) == command_list_hash(inline_lists[i]));
+        commands += command_list_count(inline_lists[i]);
+    }
+    CHECK_EQ(commands, ITEM_COUNT * 5 + ITEM_COUNT / 10);
+
+    /* recording again resets first: the same again, not twice as much */
+    command_lists_record(pool, pool_lists, LIST_COUNT, ITEM_COUNT, record_everything, NULL);
+    for (int i = 0; i < LIST_COUNT; i++)
+        CHECK(command_list_hash(pool_lists[i]) == command_list_hash(inline_lists[i]));
+
+    /* replayed: the same GL calls in the same order, the same packets into the queue */
+    command_lists_record(NULL, inline_lists, LIST_COUNT, ITEM_COUNT, record_replayable, NULL);
+    command_lists_record(pool, pool_lists, LIST_COUNT, ITEM_COUNT, record_replayable, NULL);
+    replay one_thread = replay_lists(inline_lists);
+    replay threaded = replay_lists(pool_lists);
+
+    CHECK(one_thread.calls > 0);
+    CHECK_EQ(threaded.calls, one_thread.calls);
+    CHECK(threaded.trace == one_thread.trace);
+    CHECK_EQ(one_thread.stats.packets, ITEM_COUNT);
+    CHECK_EQ(threaded.stats.packets, ITEM_COUNT);
+    CHECK_EQ(threaded.stats.submitted.programs, one_thread.stats.submitted.programs);
+    CHECK_EQ(threaded.stats.sorted.programs, one_thread.stats.sorted.programs);
+    CHECK_EQ(threaded.stats.sorted.textures, one_thread.stats.sorted.textures);
+    CHECK_EQ(threaded.stats.sorted.vaos, one_thread.stats.sorted.vaos);
+
+    for (int i = 0; i < LIST_COUNT; i++)
+    {
+        command_list_destroy(inline_lists[i]);
+        command_list_destroy(pool_lists[i]);
+    }
+    job_pool_destroy(pool);
+    return check_result("command_list_test");
+}
@@ -0,0 +1,223 @@
+/*
+    gl_state test
+    ----------------------------
+    drives the state cache through a stub gl_state_gl table that only
+    counts what reached it, no context needed.
+*/
+
+#include "myOpenGL/gl_state.h"
+#include "tests/check.h"
+
+static struct
+{
+    int use_program;
+    int bind_vertex_array;
+    int bind_buffer;
+    int active_texture;
+    int bind_texture;
+    int polygon_mode;
+    int viewport;
+    int caps;
+    int other;
+    GLenum last_face;
+} g_calls;
+
+static void GLAPIENTRY stub_use_program(GLuint) { g_calls.use_program++; }
+static void GLAPIENTRY stub_bind_vertex_array(GLuint) { g_calls.bind_vertex_array++; }
+static void GLAPIENTRY stub_bind_buffer(GLenum, GLuint) { g_calls.bind_buffer++; }
+static void GLAPIENTRY stub_active_texture(GLenum) { g_calls.active_texture++; }
+static void GLAPIENTRY stub_bind_texture(GLenum, GLuint) { g_calls.bind_texture++; }
+static void GLAPIENTRY stub_polygon_mode(GLenum face, GLenum) { g_calls.polygon_mode++; g_calls.last_face = face; }
+static void GLAPIENTRY stub_viewport(GLint, GLint, GLsizei, GLsizei) { g_calls.viewport++; }
+static void GLAPIENTRY stub_cap(GLenum) { g_calls.caps++; }
+static void GLAPIENTRY stub_names(GLsizei, const GLuint*) { g_calls.other++; }
+static void GLAPIENTRY stub_blend_func(GLenum, GLenum) { g_calls.other++; }
+static void GLAPIENTRY stub_depth_func(GLenum) { g_calls.other++; }
+static void GLAPIENTRY stub_depth_mask(GLboolean) { g_calls.other++; }
+
+static void reset()
+{
+    static gl_state_gl stub = {
+        stub_use_program, stub_bind_vertex_array, stub_names, stub_bind_buffer, stub_names,
+        stub_active_texture, stub_bind_texture, stub_names, stub_polygon_mode, stub_viewport,
+        stub_cap, stub_cap, stub_blend_func, stub_depth_func, stub_depth_mask
+    };
+    g_calls = decltype(g_calls)();
+    gl_state_init(&stub);
+}
+
+static void repeated_binds()
+{
+    reset();
+    gl_state_use_program(3);
+    gl_state_use_program(3);
+    gl_state_use_program(4);
+    CHECK_EQ(g_calls.use_program, 2);
+
+    gl_state_active_texture(GL_TEXTURE0 + 1);
+    gl_state_bind_texture(GL_TEXTURE_2D, 7);
+    gl_state_active_texture(GL_TEXTURE0 + 1);
+    gl_state_bind_texture(GL_TEXTURE_2D, 7);
+    CHECK_EQ(g_calls.active_texture, 1);
+    CHECK_EQ(g_calls.bind_texture, 1);
+
+    /* the same name on another unit is a different binding */
+    gl_state_active_texture(GL_TEXTURE0);
+    gl_state_bind_texture(GL_TEXTURE_2D, 7);
+    CHECK_EQ(g_calls.bind_texture, 2);
+
+    gl_state_viewport(0, 0, 640, 480);
+    gl_state_viewport(0, 0, 640, 480);
+    gl_state_enable(GL_BLEND, true);
+    gl_state_enable(GL_BLEND, true);
+    CHECK_EQ(g_calls.viewport, 1);
+    CHECK_EQ(g_calls.caps, 1);
+
+    /* untracked targets always go through */
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 5);
+    gl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 5);
+    CHECK_EQ(g_calls.bind_buffer, 2);
+
+    gl_state_stats stats;
+    gl_state_get_stats(&stats);
+    CHECK_EQ(stats.issued, 2 + 2 + 2 + 1 + 1 + 2);
+    CHECK_EQ(stats.filtered, 1 + 1 + 1 + 1 + 1);
+}
+
+static void vertex_array_forgets_element_buffer()
+{
+    reset();
+    gl_state_bind_vertex_array(1);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 2);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 2);
+    CHECK_EQ(g_calls.bind_buffer, 1);
+
+    /* another vertex array has its own element buffer, so the same bind is needed again */
+    gl_state_bind_vertex_array(4);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 2);
+    CHECK_EQ(g_calls.bind_buffer, 2);
+
+    /* a filtered vertex array bind leaves it alone */
+    gl_state_bind_vertex_array(4);
+    gl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 2);
+    CHECK_EQ(g_calls.bind_vertex_array, 2);
+    CHECK_EQ(g_calls.bind_buffer, 2);
+
+    /* array buffers aren't vertex array state */
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, 3);
+    gl_state_bind_vertex_array(1);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, 3);
+    CHECK_EQ(g_calls.bind_buffer, 3);
+}
+
+static void delete_then_regenerate()
+{
+    reset();
+    GLuint texture = 7;
+    gl_state_active_texture(GL_TEXTURE0);
+    gl_state_bind_texture(GL_TEXTURE_2D, texture);
+    gl_state_delete_textures(1, &texture);
+
+    /* glGenTextures may hand 7 back: binding it has to reach GL, and unbinding is already done */
+    gl_state_bind_texture(GL_TEXTURE_2D, texture);
+    CHECK_EQ(g_calls.bind_texture, 2);
+    gl_state_delete_textures(1, &texture);
+    gl_state_bind_texture(GL_TEXTURE_2D, 0);
+    CHECK_EQ(g_calls.bind_texture, 2);
+
+    GLuint buffer = 9;
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    gl_state_delete_buffers(1, &buffer);
+    gl_state_bind_buffer(GL_ARRAY_BUFFER, buffer);
+    CHECK_EQ(g_calls.bind_buffer, 2);
+
+    GLuint vao = 2;
+    gl_state_bind_vertex_array(vao);
+    gl_state_delete_vertex_arrays(1, &vao);
+    gl_state_bind_vertex_array(vao);
+    CHECK_EQ(g_calls.bind_vertex_array, 2);
+}
+
+static void polygon_mode_faces()
+{
+    reset();
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+    gl_state_polygon_mode(GL_FRONT, GL_FILL);
+    gl_state_polygon_mode(GL_BACK, GL_FILL);
+    CHECK_EQ(g_calls.polygon_mode, 1);
+
+    /* one face changed: setting both has to go through, setting the other doesn't */
+    gl_state_polygon_mode(GL_FRONT, GL_LINE);
+    gl_state_polygon_mode(GL_BACK, GL_FILL);
+    CHECK_EQ(g_calls.polygon_mode, 2);
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_LINE);
+    CHECK_EQ(g_calls.polygon_mode, 3);
+    CHECK_EQ(g_calls.last_face, GL_FRONT_AND_BACK);
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_LINE);
+    gl_state_polygon_mode(GL_BACK, GL_LINE);
+    CHECK_EQ(g_calls.polygon_mode, 3);
+}
+
+static void invalidate()
+{
+    reset();
+    gl_state_use_program(3);
+    gl_state_bind_vertex_array(1);
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+    gl_state_viewport(0, 0, 4, 4);
+
+    /* something changed state behind the cache's back: the same calls have to go through again */
+    gl_state_invalidate();
+    gl_state_use_program(3);
+    gl_state_bind_vertex_array(1);
+    gl_state_polygon_mode(GL_FRONT_AND_BACK, GL_FILL);
+    gl_state_viewport(0, 0, 4, 4);
+    CHECK_EQ(g_calls.use_program, 2);
+    CHECK_EQ(g_calls.bind_vertex_array, 2);
+    CHECK_EQ(g_calls.polygon_mode, 2);
+    CHECK_EQ(g_calls.viewport, 2);
+}
+
+static void frame_counters()
+{
+    reset();
+    gl_state_use_program(3);
+    gl_state_use_program(3);
+    gl_state_end_frame();
+
+    gl_state_stats stats;
+    gl_state_get_stats(&stats);
+    CHECK_EQ(stats.frame_issued, 1);
+    CHECK_EQ(stats.frame_filtered, 1);
+
+    /* until the next end_frame, the last frame's counts stand */
+    gl_state_use_program(3);
+    gl_state_use_program(3);
+    gl_state_use_program(3);
+    gl_state_get_stats(&stats);
+    CHECK_EQ(stats.frame_issued, 1);
+    CHECK_EQ(stats.frame_filtered, 1);
+
+    gl_state_end_frame();
+    gl_state_get_stats(&stats);
+    CHECK_EQ(stats.frame_issued, 0);
+    CHECK_EQ(stats.frame_filtered, 3);
+    CHECK_EQ(stats.issued, 1);
+    CHECK_EQ(stats.filtered, 4);
+
+    gl_state_end_frame();
+    gl_state_get_stats(&stats);
+    CHECK_EQ(stats.frame_issued, 0);
+    CHECK_EQ(stats.frame_filtered, 0);
+}
+
+int main()
+{
+    repeated_binds();
+    vertex_array_forgets_element_buffer();
+    delete_then_regenerate();
+    polygon_mode_faces();
+    invalidate();
+    frame_counters();
+    return check_result("gl_state_test");
+}
@@ -0,0 +1,77 @@
+/*
+    mip builder test
+    ----------------------------
+    builds chains of noisy images at odd and non power of two sizes with
+    each SIMD path forced, and checks every level against the scalar
+    reference: at most one step apart, for both filters, linear and sRGB.
+    paths this CPU can't run are reported and skipped.
+*/
+
+#include "myTextures/mip_builder.h"
+#include "myCore/job_pool.h"
+#include "tests/check.h"
+
+#include <stdlib.h>
+
+static const int sizes[][2] = {
+    { 1, 1 }, { 3, 5 }, { 7, 1 }, { 1, 9 }, { 13, 9 }, { 33, 17 }, { 100, 60 }, { 257, 129 }
+};
+
+static void noise(std::vector<uint8_t>* rgba, int width, int height, unsigned seed)
+{
+    rgba->resize((size_t)width * height * 4);
+    for (size_t i = 0; i < rgba->size(); i++)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        (*rgba)[i] = (uint8_t)(seed >> 24);
+    }
+}
+
+static void compare(mip_simd simd, const char* name, job_pool* pool)
+{
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        int width = sizes[s][0], height = sizes[s][1];
+        std::vector<uint8_t> rgba;
+        noise(&rgba, width, height, (unsigned)(width * 131 + height));
+
+        for (int filter = MIP_FILTER_BOX; filter <= MIP_FILTER_KAISER; filter++)
+        {
+            for (int srgb = 0; srgb < 2; srgb++)
+            {
+                mip_chain reference, chain;
+                mip_build(&rgba[0], width, height, 0, (mip_filter)filter, srgb != 0, MIP_SIMD_SCALAR, NULL, &reference);
+                mip_build(&rgba[0], width, height, 0, (mip_filter)filter, srgb != 0, simd, pool, &chain);
+
+                int difference = mip_chain_max_difference(reference, chain);
+                if (difference > 1)
+                    printf("%s %dx%d %s %s: off by %d\n", name, width, height,
+                           filter == MIP_FILTER_BOX ? "box" : "kaiser", srgb ? "srgb" : "linear", difference);
+                CHECK(difference <= 1);
+                CHECK_EQ(chain.levels, mip_level_count(width, height));
+            }
+        }
+    }
+}
+
+int main()
+{
+    job_pool* pool = job_pool_create(4, "mip_test");
+
+    /* the scalar path split into bands across the pool is still the scalar path */
+    compare(MIP_SIMD_SCALAR, "scalar + pool", pool);
+
+    mip_simd best = mip_best_simd();
+    if (best >= MIP_SIMD_SSE2)
+        compare(MIP_SIMD_SSE2, "sse2", pool);
+    else
+        printf("mip_builder_test: no SSE2, skipped\n");
+
+    if (best >= MIP_SIMD_AVX2)
+        compare(MIP_SIMD_AVX2, "avx2", pool);
+    else
+        printf("mip_builder_test: no AVX2, skipped\n");
+
+    job_pool_destroy(pool);
+    return check_result("mip_builder_test");
+}
@@ -0,0 +1,144 @@
+/*
+    upload ring test
+    ----------------------------
+    runs the ring over a recording upload_ring_gl stub: the "buffer" is
+    client memory, fences are numbers, and the test decides when the GPU
+    has passed them. checks wraparound, that fences are waited on oldest
+    first, that only a reserve that catches the tail stalls, and that
+    everything retires.
+*/
+
+#include "myOpenGL/upload_ring.h"
+#include "tests/check.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define CAPACITY 4096
+#define SPAN 1024
+
+static struct
+{
+    std::vector<uint8_t> memory;
+    uint64_t next_fence;
+    uint64_t gpu_passed;            // fences up to this number have signalled
+    std::vector<uint64_t> waits;    // every fence client_wait_sync was asked about, in order
+    std::vector<uint64_t> deleted;
+    int blocking_waits;
+} g_gpu;
+
+static uint64_t fence_number(GLsync sync)
+{
+    return (uint64_t)(uintptr_t)sync;
+}
+
+static void GLAPIENTRY stub_gen_buffers(GLsizei, GLuint* buffers) { buffers[0] = 1; }
+static void GLAPIENTRY stub_delete_buffers(GLsizei, const GLuint*) {}
+static void GLAPIENTRY stub_bind_buffer(GLenum, GLuint) {}
+static void GLAPIENTRY stub_buffer_storage(GLenum, GLsizeiptr size, const void*, GLbitfield) { g_gpu.memory.resize(size); }
+static void* GLAPIENTRY stub_map_buffer_range(GLenum, GLintptr, GLsizeiptr, GLbitfield) { return &g_gpu.memory[0]; }
+static GLboolean GLAPIENTRY stub_unmap_buffer(GLenum) { return GL_TRUE; }
+
+static GLsync GLAPIENTRY stub_fence_sync(GLenum, GLbitfield)
+{
+    return (GLsync)(uintptr_t)g_gpu.next_fence++;
+}
+
+/* a wait with a timeout is the GPU catching up: the fence signals then */
+static GLenum GLAPIENTRY stub_client_wait_sync(GLsync sync, GLbitfield, GLuint64 timeout)
+{
+    uint64_t number = fence_number(sync);
+    g_gpu.waits.push_back(number);
+    if (number <= g_gpu.gpu_passed)
+        return GL_ALREADY_SIGNALED;
+    if (timeout == 0)
+        return GL_TIMEOUT_EXPIRED;
+
+    g_gpu.blocking_waits++;
+    g_gpu.gpu_passed = number;
+    return GL_CONDITION_SATISFIED;
+}
+
+static void GLAPIENTRY stub_delete_sync(GLsync sync) { g_gpu.deleted.push_back(fence_number(sync)); }
+
+static bool reserve(upload_ring_span* span)
+{
+    bool ok = upload_ring_reserve(SPAN, true, span);
+    if (ok)
+        memset(span->data, 0xAB, span->size);     // writable, and in bounds under ASan
+    return ok;
+}
+
+static bool ascending(const std::vector<uint64_t>& numbers)
+{
+    for (size_t i = 1; i < numbers.size(); i++)
+    {
+        if (numbers[i] < numbers[i - 1])
+            return false;
+    }
+    return true;
+}
+
+int main()
+{
+    upload_ring_gl stub = {
+        stub_gen_buffers, stub_delete_buffers, stub_bind_buffer, stub_buffer_storage, stub_map_buffer_range,
+        stub_unmap_buffer, stub_fence_sync, stub_client_wait_sync, stub_delete_sync
+    };
+    g_gpu.next_fence = 1;
+    CHECK(upload_ring_init(CAPACITY, &stub));
+
+    upload_ring_stats stats;
+    upload_ring_span spans[5];
+
+    /* three spans, released and fenced (fence 1) but not yet passed */
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(reserve(&spans[i]));
+        CHECK_EQ(spans[i].offset, i * SPAN);
+        upload_ring_release(spans[i]);
+    }
+    upload_ring_submit();
+
+    /* the fourth fills the ring to its end: room left, so no stall */
+    CHECK(reserve(&spans[3]));
+    CHECK_EQ(spans[3].offset, 3 * SPAN);
+    upload_ring_release(spans[3]);
+    upload_ring_get_stats(&stats);
+    CHECK_EQ(stats.stalls, 0);
+    CHECK_EQ(stats.used, CAPACITY);
+    CHECK_EQ(g_gpu.blocking_waits, 0);
+
+    /* the fifth finds the head at the tail: it waits on fence 1 (the oldest), then wraps to 0 */
+    CHECK(reserve(&spans[4]));
+    CHECK_EQ(spans[4].offset, 0);
+    upload_ring_get_stats(&stats);
+    CHECK_EQ(stats.stalls, 1);
+    CHECK_EQ(stats.wraps, 1);
+    CHECK_EQ(g_gpu.blocking_waits, 1);
+    CHECK(!g_gpu.waits.empty() && g_gpu.waits.back() == 1);
+    CHECK_EQ(stats.used, 2 * SPAN);     // spans 3 and 4: the first three retired with fence 1
+
+    /* with the GPU idle every fence passes, oldest first, and the ring empties */
+    upload_ring_release(spans[4]);
+    g_gpu.gpu_passed = ~0ull;
+    upload_ring_submit();
+    upload_ring_get_stats(&stats);
+    CHECK_EQ(stats.used, 0);
+    CHECK_EQ(stats.live_spans, 0);
+    CHECK_EQ(stats.pending_fences, 0);
+    CHECK_EQ(stats.stalls, 1);
+    CHECK_EQ(stats.fences, (int)g_gpu.next_fence - 1);
+    CHECK(ascending(g_gpu.waits));
+    CHECK(ascending(g_gpu.deleted));
+    CHECK_EQ(g_gpu.deleted.size(), g_gpu.next_fence - 1);
+
+    /* empty, so the next span starts over at the front */
+    CHECK(reserve(&spans[0]));
+    CHECK_EQ(spans[0].offset, 0);
+    upload_ring_release(spans[0]);
+
+    upload_ring_shutdown();
+    return check_result("upload_ring_test");
+}
@@ -0,0 +1,162 @@
+/*
+    asset packer: a directory tree -> one .gapk archive
+    ----------------------------
+    usage: asset_packer -o <archive> [--align n] [--no-compress] <directory>...
+
+    every file under each directory is stored under "<directory name>/<relative path>",
+    so packing ../../data gives keys like "data/textures/magic.png", the same
+    paths the engine asks for. files that shrink by at least an eighth are
+    stored compressed, the rest (PNGs, mostly) are stored as is.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "myAssets/asset_archive.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+static bool read_file(const std::string& path, std::vector<uint8_t>* out)
+{
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->resize(size > 0 ? (size_t)size : 0);
+    size_t got = size > 0 ? fread(&(*out)[0], 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    return size >= 0 && got == (size_t)size;
+}
+
+/* key is the archive path so far, dir the matching place on disk */
+static bool collect(const std::string& dir, const std::string& key, std::vector<asset_pack_input>* inputs)
+{
+    std::vector<std::string> names;
+    std::vector<bool> is_dir;
+
+#ifdef _WIN32
+    WIN32_FIND_DATAA found;
+    HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &found);
+    if (find == INVALID_HANDLE_VALUE)
+        return false;
+    do
+    {
+        names.push_back(found.cFileName);
+        is_dir.push_back((found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+    } while (FindNextFileA(find, &found));
+    FindClose(find);
+#else
+    DIR* d = opendir(dir.c_str());
+    if (!d)
+        return false;
+    while (struct dirent* entry = readdir(d))
+    {
+        struct stat st;
+        std::string full = dir + "/" + entry->d_name;
+        names.push_back(entry->d_name);
+        is_dir.push_back(stat(full.c_str(), &st) == 0 && S_ISDIR(st.st_mode));
+    }
+    closedir(d);
+#endif
+
+    for (size_t i = 0; i < names.size(); i++)
+    {
+        if (names[i] == "." || names[i] == "..")
+            continue;
+
+        std::string full = dir + "/" + names[i];
+        std::string child = key + "/" + names[i];
+
+        if (is_dir[i])
+        {
+            if (!collect(full, child, inputs))
+                return false;
+            continue;
+        }
+
+        asset_pack_input input;
+        input.path = child;
+        if (!read_file(full, &input.bytes))
+        {
+            printf("asset packer: can't read %s\n", full.c_str());
+            return false;
+        }
+        inputs->push_back(input);
+    }
+    return true;
+}
+
+static void usage()
+{
+    printf("usage: asset_packer -o <archive> [--align n] [--no-compress] <directory>...\n");
+}
+
+int main(int argc, const char** argv)
+{
+    std::string output;
+    uint32_t alignment = 64;
+    bool compress = true;
+    std::vector<asset_pack_input> inputs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output = argv[++i];
+        else if (arg == "--align" && i + 1 < argc)
+            alignment = (uint32_t)atoi(argv[++i]);
+        else if (arg == "--no-compress")
+            compress = false;
+        else if (arg[0] == '-')
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            /* strip trailing slashes, the last component becomes the key prefix */
+            while (arg.size() > 1 && (arg[arg.size() - 1] == '/' || arg[arg.size() - 1] == '\\'))
+                arg.resize(arg.size() - 1);
+            size_t slash = arg.find_last_of("/\\");
+            std::string key = slash == std::string::npos ? arg : arg.substr(slash + 1);
+
+            if (!collect(arg, key, &inputs))
+            {
+                printf("asset packer: can't read directory %s\n", arg.c_str());
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    if (output.empty() || inputs.empty())
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    asset_pack_stats stats;
+    if (!asset_archive_write(output.c_str(), inputs, alignment, compress, &stats))
+    {
+        printf("asset packer: can't write %s\n", output.c_str());
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %d files (%d compressed), %.1f KB -> %.1f KB\n", output.c_str(), (int)inputs.size(),
+           stats.compressed_entries, stats.raw_bytes / 1024.0, stats.stored_bytes / 1024.0);
+
+    return EXIT_SUCCESS;
+}
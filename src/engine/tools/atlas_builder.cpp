@@ -0,0 +1,305 @@
+/*
+    atlas builder: many small images -> a few atlas pages + a lookup table
+    ----------------------------
+    usage: atlas_builder [options] <image or directory>...
+
+      -o <dir>          where the pages and the table go (default: .)
+      --name <name>     pages are <name>_<n>.ktx, the table <name>.atlas (default atlas)
+      --page <n>        largest page side in texels (default 1024)
+      --padding <n>     empty texels between images (default 0)
+      --gutter <n>      edge texels repeated around each image (default 4)
+      --mip-levels <n>  levels kept free of bleeding, and written (default 5)
+
+    names ending in _nm are normal maps: they go on their own pages, filtered
+    without sRGB decoding, so colour and data never share a page. pages are
+    RGBA8 KTX files with a box filtered mip chain (a wider filter would reach
+    past the gutters), cut off at --mip-levels. the table lists each image
+    by file name without its extension (see myTextures/texture_atlas.h).
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDL_MAIN_HANDLED
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stb_image.h>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "myCore/inflate.h"
+#include "myTextures/ktx.h"
+#include "myTextures/mip_builder.h"
+#include "myTextures/pixel_convert.h"
+#include "myTextures/png_unfilter.h"
+#include "myTextures/texture_atlas.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct source_image
+{
+    std::string path, name;
+    int width, height;
+    uint8_t* rgba;
+    bool linear;
+};
+
+static bool has_image_extension(const std::string& name)
+{
+    static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd" };
+
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string ext = name.substr(dot);
+    for (size_t i = 0; i < ext.size(); i++)
+        ext[i] = (char)tolower(ext[i]);
+
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        if (ext == extensions[i])
+            return true;
+    }
+    return false;
+}
+
+/* adds path itself, or every image directly inside it */
+static void collect_inputs(const std::string& path, std::vector<std::string>* files)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        WIN32_FIND_DATAA found;
+        HANDLE find = FindFirstFileA((path + "\\*").c_str(), &found);
+        if (find == INVALID_HANDLE_VALUE)
+            return;
+        do
+        {
+            if (has_image_extension(found.cFileName))
+                files->push_back(path + "/" + found.cFileName);
+        } while (FindNextFileA(find, &found));
+        FindClose(find);
+        return;
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+            return;
+        while (struct dirent* entry = readdir(dir))
+        {
+            if (has_image_extension(entry->d_name))
+                files->push_back(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        return;
+    }
+#endif
+    files->push_back(path);
+}
+
+static std::string file_stem(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static bool write_page(const std::string& path, const std::vector<uint8_t>& rgba, const atlas_page& page,
+                       int levels, bool linear, const std::string& name)
+{
+    mip_chain mips;
+    mip_build(&rgba[0], page.width, page.height, levels, MIP_FILTER_BOX, !linear, MIP_SIMD_AUTO, NULL, &mips);
+
+    ktx_texture ktx;
+    ktx.gl_type = GL_UNSIGNED_BYTE;
+    ktx.gl_format = GL_RGBA;
+    ktx.gl_internal_format = linear ? GL_RGBA8 : GL_SRGB8_ALPHA8;
+    ktx.gl_base_internal_format = GL_RGBA;
+    ktx.width = page.width;
+    ktx.height = page.height;
+    ktx.levels = mips.levels;
+    for (int l = 0; l < mips.levels; l++)
+    {
+        ktx.level_data[l] = &mips.texels[mips.offset[l]];
+        ktx.level_size[l] = (size_t)mips.width[l] * mips.height[l] * 4;
+    }
+    ktx.key_values.push_back(std::make_pair(std::string("KTXorientation"), std::string("S=r,T=d")));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.atlas"), name));
+
+    return ktx_write_file(path.c_str(), ktx);
+}
+
+/* packs one class of images (colour or data) onto pages of their own, appending to table */
+static bool build_pages(const atlas_settings& settings, const std::string& output_dir, const std::string& name,
+                        std::vector<source_image*>& images, bool linear, atlas_table* table)
+{
+    if (images.empty())
+        return true;
+
+    std::vector<int> widths(images.size()), heights(images.size());
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        widths[i] = images[i]->width;
+        heights[i] = images[i]->height;
+    }
+
+    std::vector<atlas_rect> rects(images.size());
+    std::vector<atlas_page> pages;
+    if (!atlas_pack(settings, &widths[0], &heights[0], (int)images.size(), &rects[0], &pages))
+    {
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            if (rects[i].page < 0)
+                printf("%-24s %dx%d doesn't fit a %dx%d page\n", images[i]->path.c_str(),
+                       images[i]->width, images[i]->height, settings.page_width, settings.page_height);
+        }
+        return false;
+    }
+
+    int first_page = (int)table->pages.size();
+    for (size_t p = 0; p < pages.size(); p++)
+    {
+        std::vector<uint8_t> rgba((size_t)pages[p].width * pages[p].height * 4, 0);
+        size_t used = 0;
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            if (rects[i].page != (int)p)
+                continue;
+            atlas_blit(settings, &rgba[0], pages[p].width, images[i]->rgba, rects[i]);
+            used += (size_t)rects[i].width * rects[i].height;
+        }
+
+        char file[256];
+        snprintf(file, sizeof(file), "%s_%d.ktx", name.c_str(), first_page + (int)p);
+        if (!write_page(output_dir + "/" + file, rgba, pages[p], settings.mip_levels, linear, name))
+        {
+            printf("%-24s write error\n", file);
+            return false;
+        }
+
+        printf("%-24s %4dx%-4d %s  %5.1f%% used\n", file, pages[p].width, pages[p].height,
+               linear ? "linear" : "sRGB  ", 100.0 * used / ((double)pages[p].width * pages[p].height));
+
+        table->page_files.push_back(file);
+        table->pages.push_back(pages[p]);
+    }
+
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        rects[i].page += first_page;
+        table->entries.push_back(atlas_make_entry(images[i]->name.c_str(), rects[i], table->pages[rects[i].page]));
+    }
+    return true;
+}
+
+static void usage()
+{
+    printf("usage: atlas_builder [-o dir] [--name name] [--page n] [--padding n] [--gutter n] [--mip-levels n] <image or directory>...\n");
+}
+
+int main(int argc, const char** argv)
+{
+    std::string output_dir = ".";
+    std::string name = "atlas";
+    atlas_settings settings;
+    settings.page_width = settings.page_height = 1024;
+    settings.padding = 0;
+    settings.gutter = 4;
+    settings.mip_levels = 5;
+
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            output_dir = argv[++i];
+        else if (arg == "--name" && i + 1 < argc)
+            name = argv[++i];
+        else if (arg == "--page" && i + 1 < argc)
+            settings.page_width = settings.page_height = atoi(argv[++i]);
+        else if (arg == "--padding" && i + 1 < argc)
+            settings.padding = atoi(argv[++i]);
+        else if (arg == "--gutter" && i + 1 < argc)
+            settings.gutter = atoi(argv[++i]);
+        else if (arg == "--mip-levels" && i + 1 < argc)
+            settings.mip_levels = atoi(argv[++i]);
+        else if (arg[0] == '-')
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else
+            collect_inputs(arg, &files);
+    }
+
+    if (files.empty() || settings.mip_levels < 1 || settings.mip_levels > MIP_MAX_LEVELS)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    inflate_install_stb();
+    png_unfilter_install();
+    pixel_convert_install();
+
+    std::vector<source_image> images(files.size());
+    std::vector<source_image*> colour, data;
+    bool ok = true;
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        source_image& image = images[i];
+        int channels_in_file;
+        image.path = files[i];
+        image.name = file_stem(files[i]);
+        image.rgba = stbi_load(files[i].c_str(), &image.width, &image.height, &channels_in_file, 4);
+        image.linear = image.name.size() > 3 && image.name.compare(image.name.size() - 3, 3, "_nm") == 0;
+        if (!image.rgba)
+        {
+            printf("%-24s load error: %s\n", files[i].c_str(), stbi_failure_reason());
+            ok = false;
+            continue;
+        }
+        (image.linear ? data : colour).push_back(&image);
+    }
+
+    atlas_table table;
+    ok = ok && build_pages(settings, output_dir, name, colour, false, &table);
+    ok = ok && build_pages(settings, output_dir, name, data, true, &table);
+
+    if (ok)
+    {
+        std::string text = atlas_table_write(table);
+        std::string table_path = output_dir + "/" + name + ".atlas";
+        FILE* f = fopen(table_path.c_str(), "wb");
+        ok = f && fwrite(text.data(), 1, text.size(), f) == text.size();
+        if (f)
+            fclose(f);
+        if (!ok)
+            printf("%s: write error\n", table_path.c_str());
+        else
+            printf("%s: %d images on %d pages\n", table_path.c_str(), (int)table.entries.size(), (int)table.pages.size());
+    }
+
+    for (size_t i = 0; i < images.size(); i++)
+        stbi_image_free(images[i].rgba);
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,505 @@
+/*
+    image load benchmark: every decode path, across thread counts
+    ----------------------------
+    usage: decode_bench [options] <image or directory>...
+
+      --iterations <n>   timed passes over every image, per path and thread count (default 5)
+      --threads <list>   comma separated thread counts (default 1, 2, 4... up to the core count)
+      --json <file>      also write the results as JSON, - for stdout
+
+    paths, each loading every image to RGBA8 the way the engine would:
+
+      stb         file read into memory, stb_image with none of our hooks
+      simd        the same read, fast inflate + SIMD unfilter + in-place conversion
+      mmap        the simd decode straight from a memory mapped file
+      mmap_arena  that, with stb's scratch buffers in per-thread decode arenas
+      cache       the decoded texture cache: map the cached level and read it
+
+    one untimed pass warms the page cache (and the texture cache, and the
+    arenas) first, so the numbers are for files the OS already holds. every
+    path's pixels are checked against stb's, outside the timed part.
+
+    no window and no GL: runs anywhere SDL's timer does.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDL_MAIN_HANDLED
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "myCore/decode_arena.h"
+#define STBI_MALLOC(size) decode_arena_malloc(size)
+#define STBI_REALLOC(p, size) decode_arena_realloc(p, size)
+#define STBI_FREE(p) decode_arena_free(p)
+
+#include <stb_image.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "myCore/file_map.h"
+#include "myCore/hash.h"
+#include "myCore/inflate.h"
+#include "myCore/job_pool.h"
+#include "myCore/root_path.h"
+#include "myTextures/pixel_convert.h"
+#include "myTextures/png_unfilter.h"
+#include "myTextures/texture_cache.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#define CACHE_DIR "decode_bench_cache"
+#define CACHE_VARIANT 0x62656e63    // "benc": never one the engine uses
+
+/* texture_cache puts its directory under this (see myCore/root_path.h): empty, so decode_bench_cache/ lands in the working directory */
+char g_root_path[256] = "";
+
+enum bench_path
+{
+    PATH_STB,
+    PATH_SIMD,
+    PATH_MMAP,
+    PATH_MMAP_ARENA,
+    PATH_CACHE,
+    PATH_COUNT
+};
+
+static const char* path_names[PATH_COUNT] = { "stb", "simd", "mmap", "mmap_arena", "cache" };
+
+struct bench_image
+{
+    std::string path;
+    size_t source_bytes;
+    int width, height;
+    uint64_t reference;     // hash of stb's RGBA8
+};
+
+struct bench_job
+{
+    const bench_image* image;
+    bench_path path;
+    double ms;
+    uint64_t hash;
+};
+
+struct bench_result
+{
+    bench_path path;
+    int threads;
+    int images;
+    double seconds;
+    double source_mb, decoded_mb;
+    double p50_ms, p99_ms;
+    int mismatches;
+};
+
+static bool has_image_extension(const std::string& name)
+{
+    static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd" };
+
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string ext = name.substr(dot);
+    for (size_t i = 0; i < ext.size(); i++)
+        ext[i] = (char)tolower(ext[i]);
+
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        if (ext == extensions[i])
+            return true;
+    }
+    return false;
+}
+
+/* adds path itself, or every image directly inside it */
+static void collect_inputs(const std::string& path, std::vector<std::string>* files)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        WIN32_FIND_DATAA found;
+        HANDLE find = FindFirstFileA((path + "\\*").c_str(), &found);
+        if (find == INVALID_HANDLE_VALUE)
+            return;
+        do
+        {
+            if (has_image_extension(found.cFileName))
+                files->push_back(path + "/" + found.cFileName);
+        } while (FindNextFileA(find, &found));
+        FindClose(find);
+        return;
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+            return;
+        while (struct dirent* entry = readdir(dir))
+        {
+            if (has_image_extension(entry->d_name))
+                files->push_back(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        return;
+    }
+#endif
+    files->push_back(path);
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>* out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->resize(size > 0 ? (size_t)size : 0);
+    size_t got = size > 0 ? fread(&(*out)[0], 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    return size > 0 && got == (size_t)size;
+}
+
+static double ms_since(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) * 1000.0 / (double)SDL_GetPerformanceFrequency();
+}
+
+/* the hooks are global: set them for a whole run, never while one is going */
+static void install_hooks(bench_path path)
+{
+    bool ours = path != PATH_STB;
+    inflate_install_stb(ours);
+    png_unfilter_install(ours ? PNG_UNFILTER_AUTO : PNG_UNFILTER_SCALAR);
+    pixel_convert_install(ours ? PIXEL_CONVERT_AUTO : PIXEL_CONVERT_SCALAR);
+}
+
+static texture_cache_source cache_source(const bench_image& image)
+{
+    texture_cache_source source;
+    source.size = image.source_bytes;
+    source.mtime = 0;
+    source.hash = image.reference;  // stands in for the file hash: unique per image, all the key needs
+    source.hashed = true;
+    return source;
+}
+
+/* one image through one path; the latency is the load, the hash afterwards is only for checking */
+static void run_job(void* data)
+{
+    bench_job* job = (bench_job*)data;
+    const bench_image& image = *job->image;
+    const uint8_t* pixels = NULL;
+    uint8_t* decoded = NULL;
+    int w = 0, h = 0, n;
+
+    file_map map;
+    ktx_texture ktx;
+    memset(&map, 0, sizeof(map));
+
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    if (job->path == PATH_STB || job->path == PATH_SIMD)
+    {
+        std::vector<uint8_t> file;
+        if (read_file(image.path.c_str(), &file))
+            decoded = stbi_load_from_memory(&file[0], (int)file.size(), &w, &h, &n, 4);
+    }
+    else if (job->path == PATH_MMAP || job->path == PATH_MMAP_ARENA)
+    {
+        if (file_map_open(image.path.c_str(), &map))
+        {
+            file_map_advise(&map, FILE_MAP_SEQUENTIAL);
+            if (job->path == PATH_MMAP_ARENA)
+                decode_arena_begin();
+            decoded = stbi_load_from_memory(map.data, (int)map.size, &w, &h, &n, 4);
+            if (job->path == PATH_MMAP_ARENA)
+                decoded = (uint8_t*)decode_arena_end(decoded);
+            file_map_close(&map);
+        }
+    }
+    else
+    {
+        uint64_t key;
+        if (texture_cache_load(image.path.c_str(), CACHE_VARIANT, cache_source(image), &map, &ktx, &key))
+        {
+            /* the upload would read every page: so does the benchmark */
+            volatile uint8_t sink = 0;
+            for (size_t i = 0; i < ktx.level_size[0]; i += 4096)
+                sink += ktx.level_data[0][i];
+            (void)sink;
+            pixels = ktx.level_data[0];
+            w = ktx.width;
+            h = ktx.height;
+        }
+    }
+
+    job->ms = ms_since(start);
+
+    if (decoded)
+        pixels = decoded;
+    job->hash = pixels ? hash64(pixels, (size_t)w * h * 4) : 0;
+
+    stbi_image_free(decoded);
+    file_map_close(&map);
+}
+
+static double percentile(std::vector<double>& sorted, double p)
+{
+    size_t i = (size_t)(p * (sorted.size() - 1) + 0.5);
+    return sorted[i < sorted.size() ? i : sorted.size() - 1];
+}
+
+static bench_result run(bench_path path, int threads, int iterations, const std::vector<bench_image>& images)
+{
+    install_hooks(path);
+    job_pool* pool = threads > 1 ? job_pool_create(threads - 1, "decode_bench") : NULL;
+
+    bench_result result;
+    result.path = path;
+    result.threads = threads;
+    result.images = 0;
+    result.seconds = 0.0;
+    result.source_mb = result.decoded_mb = 0.0;
+    result.mismatches = 0;
+
+    std::vector<double> latencies;
+    std::vector<bench_job> jobs(images.size());
+
+    /* pass 0 warms up and isn't counted */
+    for (int pass = 0; pass <= iterations; pass++)
+    {
+        for (size_t i = 0; i < images.size(); i++)
+        {
+            jobs[i].image = &images[i];
+            jobs[i].path = path;
+        }
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        if (pool)
+        {
+            /* the waiting thread runs jobs too: threads - 1 workers plus this one */
+            job_counter counter = { 0 };
+            for (size_t i = 0; i < jobs.size(); i++)
+                job_pool_submit(pool, run_job, &jobs[i], &counter);
+            job_pool_wait(pool, &counter);
+        }
+        else
+        {
+            for (size_t i = 0; i < jobs.size(); i++)
+                run_job(&jobs[i]);
+        }
+        double seconds = ms_since(start) / 1000.0;
+
+        if (pass == 0)
+            continue;
+
+        result.seconds += seconds;
+        for (size_t i = 0; i < jobs.size(); i++)
+        {
+            latencies.push_back(jobs[i].ms);
+            result.images++;
+            result.source_mb += images[i].source_bytes / (1024.0 * 1024.0);
+            result.decoded_mb += (double)images[i].width * images[i].height * 4 / (1024.0 * 1024.0);
+            result.mismatches += jobs[i].hash != images[i].reference ? 1 : 0;
+        }
+    }
+
+    if (pool)
+        job_pool_destroy(pool);
+
+    std::sort(latencies.begin(), latencies.end());
+    result.p50_ms = latencies.empty() ? 0.0 : percentile(latencies, 0.50);
+    result.p99_ms = latencies.empty() ? 0.0 : percentile(latencies, 0.99);
+    return result;
+}
+
+static bool write_json(const char* file, const std::vector<bench_image>& images, int iterations,
+                       const std::vector<bench_result>& results)
+{
+    FILE* f = strcmp(file, "-") == 0 ? stdout : fopen(file, "w");
+    if (!f)
+        return false;
+
+    size_t source_bytes = 0, decoded_bytes = 0;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        source_bytes += images[i].source_bytes;
+        decoded_bytes += (size_t)images[i].width * images[i].height * 4;
+    }
+
+    fprintf(f, "{\n");
+    fprintf(f, "  \"benchmark\": \"decode_bench\",\n");
+    fprintf(f, "  \"cpu_count\": %d,\n", SDL_GetCPUCount());
+    fprintf(f, "  \"unfilter\": \"%s\",\n", png_unfilter_name(png_unfilter_best()));
+    fprintf(f, "  \"convert\": \"%s\",\n", pixel_convert_name(pixel_convert_best()));
+    fprintf(f, "  \"iterations\": %d,\n", iterations);
+    fprintf(f, "  \"image_count\": %d,\n", (int)images.size());
+    fprintf(f, "  \"source_bytes\": %llu,\n", (unsigned long long)source_bytes);
+    fprintf(f, "  \"decoded_bytes\": %llu,\n", (unsigned long long)decoded_bytes);
+    fprintf(f, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const bench_result& r = results[i];
+        fprintf(f, "    { \"path\": \"%s\", \"threads\": %d, \"images\": %d, \"seconds\": %.6f, "
+                   "\"images_per_s\": %.3f, \"source_mb_per_s\": %.3f, \"decoded_mb_per_s\": %.3f, "
+                   "\"p50_ms\": %.4f, \"p99_ms\": %.4f, \"mismatches\": %d }%s\n",
+                path_names[r.path], r.threads, r.images, r.seconds, r.images / r.seconds,
+                r.source_mb / r.seconds, r.decoded_mb / r.seconds, r.p50_ms, r.p99_ms, r.mismatches,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+
+    bool ok = !ferror(f);
+    if (f != stdout)
+        ok = fclose(f) == 0 && ok;
+    return ok;
+}
+
+static void usage()
+{
+    printf("usage: decode_bench [--iterations n] [--threads 1,2,4] [--json file] <image or directory>...\n");
+}
+
+int main(int argc, const char** argv)
+{
+    int iterations = 5;
+    const char* json = NULL;
+    std::vector<int> thread_counts;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+            iterations = atoi(argv[++i]);
+        else if (arg == "--json" && i + 1 < argc)
+            json = argv[++i];
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            for (const char* p = argv[++i]; *p; )
+            {
+                int count = atoi(p);
+                if (count > 0)
+                    thread_counts.push_back(count);
+                while (*p && *p != ',')
+                    p++;
+                if (*p)
+                    p++;
+            }
+        }
+        else if (arg[0] == '-' && arg != "-")
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else
+            collect_inputs(arg, &files);
+    }
+
+    if (files.empty() || iterations < 1)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0)
+    {
+        printf("Unable to initialize SDL: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    if (thread_counts.empty())
+    {
+        for (int t = 1; t < SDL_GetCPUCount(); t *= 2)
+            thread_counts.push_back(t);
+        thread_counts.push_back(SDL_GetCPUCount() > 1 ? SDL_GetCPUCount() : 1);
+    }
+
+    decode_arena_init();
+    texture_cache_init(CACHE_DIR);
+
+    /* stb's own decode is the reference; it also fills the texture cache the cache path reads */
+    install_hooks(PATH_STB);
+    std::vector<bench_image> images;
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        std::vector<uint8_t> file;
+        bench_image image;
+        int n;
+        uint8_t* pixels = read_file(files[i].c_str(), &file) ?
+            stbi_load_from_memory(&file[0], (int)file.size(), &image.width, &image.height, &n, 4) : NULL;
+        if (!pixels)
+        {
+            printf("%-32s load error: %s\n", files[i].c_str(), file.empty() ? "can't read file" : stbi_failure_reason());
+            continue;
+        }
+
+        image.path = files[i];
+        image.source_bytes = file.size();
+        image.reference = hash64(pixels, (size_t)image.width * image.height * 4);
+
+        const uint8_t* level = pixels;
+        size_t level_size = (size_t)image.width * image.height * 4;
+        if (!texture_cache_store(image.path.c_str(), CACHE_VARIANT, cache_source(image), image.width, image.height,
+                                 1, &level, &level_size, image.reference))
+            printf("%-32s couldn't store in %s/\n", files[i].c_str(), CACHE_DIR);
+
+        stbi_image_free(pixels);
+        images.push_back(image);
+    }
+
+    if (images.empty())
+    {
+        SDL_Quit();
+        return EXIT_FAILURE;
+    }
+
+    printf("%d images, %d passes each, unfilter %s, convert %s\n", (int)images.size(), iterations,
+           png_unfilter_name(png_unfilter_best()), pixel_convert_name(pixel_convert_best()));
+    printf("%-11s %7s %9s %11s %10s %10s\n", "path", "threads", "images/s", "MB/s (rgba)", "p50 ms", "p99 ms");
+
+    std::vector<bench_result> results;
+    bool all_match = true;
+    for (int p = 0; p < PATH_COUNT; p++)
+    {
+        for (size_t t = 0; t < thread_counts.size(); t++)
+        {
+            bench_result r = run((bench_path)p, thread_counts[t], iterations, images);
+            results.push_back(r);
+            all_match &= r.mismatches == 0;
+
+            printf("%-11s %7d %9.1f %11.1f %10.2f %10.2f%s\n", path_names[r.path], r.threads, r.images / r.seconds,
+                   r.decoded_mb / r.seconds, r.p50_ms, r.p99_ms, r.mismatches ? "  MISMATCH" : "");
+        }
+    }
+    install_hooks(PATH_STB);
+
+    if (json && !write_json(json, images, iterations, results))
+    {
+        printf("%s: write error\n", json);
+        all_match = false;
+    }
+
+    decode_arena_shutdown();
+    SDL_Quit();
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,312 @@
+/*
+    PNG decode benchmark: inflate and unfilter
+    ----------------------------
+    usage: png_bench [--iterations n] <png>...
+
+    times inflating each PNG's image data with stb_image's zlib decoder and
+    with myCore/inflate, checking the two agree byte for byte. then times undoing the row filters
+    with every unfilter level this CPU has (scalar is the baseline, the byte
+    loop stb_image uses), both keeping the file's channel count and expanding
+    to RGBA the way the engine loads. every level's output is compared with
+    scalar before its speed is reported. last, whole stbi_load_from_memory
+    calls are timed with and without both hooks installed.
+
+    only 8-bit, non-interlaced RGB and RGBA files are benchmarked, that is
+    all the SIMD kernels handle (and all data/textures ships).
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDL_MAIN_HANDLED
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stb_image.h>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "myCore/inflate.h"
+#include "myTextures/png_unfilter.h"
+
+struct png_rows
+{
+    int width, height, channels;
+    std::vector<uint8_t> idat;      // every IDAT chunk, joined: one zlib stream
+    std::vector<uint8_t> filtered;  // inflated IDAT: per row, a filter byte then the row
+};
+
+static uint32_t read_be32(const uint8_t* p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static bool read_file(const char* path, std::vector<uint8_t>* out)
+{
+    FILE* f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    out->resize(size > 0 ? (size_t)size : 0);
+    size_t got = size > 0 ? fread(&(*out)[0], 1, (size_t)size, f) : 0;
+    fclose(f);
+
+    return size > 0 && got == (size_t)size;
+}
+
+/* walks the chunks, keeps IHDR and the joined IDAT, inflates it with stb's zlib */
+static bool extract_rows(const std::vector<uint8_t>& file, png_rows* out, const char** error)
+{
+    static const uint8_t signature[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    if (file.size() < 8 || memcmp(&file[0], signature, 8) != 0)
+    {
+        *error = "not a PNG";
+        return false;
+    }
+
+    std::vector<uint8_t>& idat = out->idat;
+    int depth = 0, color = -1, interlace = 0;
+    out->width = out->height = out->channels = 0;
+    size_t pos = 8;
+
+    while (pos + 12 <= file.size())
+    {
+        uint32_t length = read_be32(&file[pos]);
+        const uint8_t* type = &file[pos + 4];
+        const uint8_t* data = &file[pos + 8];
+        if (pos + 12 + length > file.size())
+            break;
+
+        if (memcmp(type, "IHDR", 4) == 0 && length >= 13)
+        {
+            out->width = (int)read_be32(data);
+            out->height = (int)read_be32(data + 4);
+            depth = data[8];
+            color = data[9];
+            interlace = data[12];
+        }
+        else if (memcmp(type, "IDAT", 4) == 0)
+            idat.insert(idat.end(), data, data + length);
+        else if (memcmp(type, "IEND", 4) == 0)
+            break;
+
+        pos += 12 + length;
+    }
+
+    if (out->width <= 0 || out->height <= 0 || color < 0)
+    {
+        *error = "no usable IHDR chunk";
+        return false;
+    }
+    if (depth != 8 || (color != 2 && color != 6) || interlace != 0)
+    {
+        *error = "only 8-bit, non-interlaced RGB / RGBA is benchmarked";
+        return false;
+    }
+    out->channels = color == 6 ? 4 : 3;
+
+    int size = 0;
+    char* inflated = stbi_zlib_decode_malloc((const char*)&idat[0], (int)idat.size(), &size);
+    if (!inflated)
+    {
+        *error = "bad image data";
+        return false;
+    }
+    out->filtered.assign((uint8_t*)inflated, (uint8_t*)inflated + size);
+    free(inflated);
+
+    if (out->filtered.size() != ((size_t)out->width * out->channels + 1) * out->height)
+    {
+        *error = "image data is the wrong size";
+        return false;
+    }
+    return true;
+}
+
+static void unfilter_image(png_unfilter_simd simd, const png_rows& rows, int out_n, uint8_t* pixels)
+{
+    size_t in_stride = (size_t)rows.width * rows.channels + 1;
+    size_t out_stride = (size_t)rows.width * out_n;
+
+    for (int y = 0; y < rows.height; y++)
+    {
+        const uint8_t* raw = &rows.filtered[y * in_stride];
+        uint8_t* cur = pixels + y * out_stride;
+        png_unfilter_row(simd, raw[0], cur, raw + 1, y ? cur - out_stride : NULL, rows.width, rows.channels, out_n);
+    }
+}
+
+static double seconds_since(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+static void count_filters(const png_rows& rows, int counts[5])
+{
+    size_t in_stride = (size_t)rows.width * rows.channels + 1;
+    memset(counts, 0, 5 * sizeof(int));
+    for (int y = 0; y < rows.height; y++)
+    {
+        int filter = rows.filtered[y * in_stride];
+        if (filter <= 4)
+            counts[filter]++;
+    }
+}
+
+/* stb's decoder against ours, same call the PNG loader makes; false if they disagree */
+static bool bench_inflate(const png_rows& rows, int iterations)
+{
+    double seconds[2];
+    for (int fast = 0; fast < 2; fast++)
+    {
+        inflate_install_stb(fast != 0);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < iterations; i++)
+        {
+            int size = 0;
+            char* inflated = stbi_zlib_decode_malloc_guesssize_headerflag((const char*)&rows.idat[0], (int)rows.idat.size(),
+                                                                         (int)rows.filtered.size(), &size, 1);
+            bool match = inflated && size == (int)rows.filtered.size() && memcmp(inflated, &rows.filtered[0], size) == 0;
+            free(inflated);
+            if (!match)
+            {
+                inflate_install_stb(false);
+                printf("  inflate  %s MISMATCH\n", fast ? "fast" : "stb");
+                return false;
+            }
+        }
+        seconds[fast] = seconds_since(start);
+    }
+    inflate_install_stb(false);
+
+    double mb = rows.filtered.size() * (double)iterations / (1024.0 * 1024.0);
+    printf("  inflate  stb %8.1f MB/s  fast %8.1f MB/s  %5.2fx  exact\n",
+           mb / seconds[0], mb / seconds[1], seconds[0] / seconds[1]);
+    return true;
+}
+
+/* false if a SIMD level doesn't match scalar */
+static bool bench_file(const char* path, int iterations)
+{
+    std::vector<uint8_t> file;
+    png_rows rows = {};
+    const char* error = "can't read file";
+
+    /* nothing is timed for a file that doesn't parse: its sizes would be garbage */
+    if (!read_file(path, &file) || !extract_rows(file, &rows, &error))
+    {
+        printf("%s: %s, skipped\n", path, error);
+        return true;
+    }
+
+    int counts[5];
+    count_filters(rows, counts);
+    printf("%s: %dx%d, %d channels, rows none/sub/up/avg/paeth = %d/%d/%d/%d/%d\n", path, rows.width, rows.height,
+           rows.channels, counts[0], counts[1], counts[2], counts[3], counts[4]);
+
+    png_unfilter_simd best = png_unfilter_best();
+    bool all_match = bench_inflate(rows, iterations);
+
+    for (int out_n = rows.channels; out_n <= 4; out_n++)
+    {
+        size_t out_bytes = (size_t)rows.width * rows.height * out_n;
+        std::vector<uint8_t> reference(out_bytes), pixels(out_bytes);
+        unfilter_image(PNG_UNFILTER_SCALAR, rows, out_n, &reference[0]);
+
+        double scalar_rate = 0.0;
+        for (int level = PNG_UNFILTER_SCALAR; level <= best; level++)
+        {
+            png_unfilter_simd simd = (png_unfilter_simd)level;
+
+            Uint64 start = SDL_GetPerformanceCounter();
+            for (int i = 0; i < iterations; i++)
+                unfilter_image(simd, rows, out_n, &pixels[0]);
+            double seconds = seconds_since(start);
+
+            double rate = out_bytes * (double)iterations / (1024.0 * 1024.0) / seconds;
+            if (simd == PNG_UNFILTER_SCALAR)
+                scalar_rate = rate;
+
+            bool match = memcmp(&reference[0], &pixels[0], out_bytes) == 0;
+            all_match &= match;
+
+            printf("  %d -> %d  %-6s %8.1f MB/s  %5.2fx  %s\n", rows.channels, out_n, png_unfilter_name(simd),
+                   rate, rate / scalar_rate, match ? "exact" : "MISMATCH");
+        }
+        if (rows.channels == 4)
+            break;
+    }
+
+    /* the whole decode as the engine does it, inflate included */
+    double load_seconds[2];
+    for (int hooked = 0; hooked < 2; hooked++)
+    {
+        png_unfilter_install(hooked ? PNG_UNFILTER_AUTO : PNG_UNFILTER_SCALAR);
+        inflate_install_stb(hooked != 0);
+
+        Uint64 start = SDL_GetPerformanceCounter();
+        for (int i = 0; i < iterations; i++)
+        {
+            int w, h, n;
+            stbi_image_free(stbi_load_from_memory(&file[0], (int)file.size(), &w, &h, &n, 4));
+        }
+        load_seconds[hooked] = seconds_since(start) / iterations;
+    }
+    png_unfilter_install(PNG_UNFILTER_SCALAR);
+    inflate_install_stb(false);
+
+    printf("  stbi_load_from_memory: %.2f ms -> %.2f ms (fast inflate, %s unfilter)\n", load_seconds[0] * 1000.0,
+           load_seconds[1] * 1000.0, png_unfilter_name(best));
+
+    return all_match;
+}
+
+static void usage()
+{
+    printf("usage: png_bench [--iterations n] <png>...\n");
+}
+
+int main(int argc, const char** argv)
+{
+    int iterations = 20;
+    std::vector<const char*> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = atoi(argv[++i]);
+        else if (argv[i][0] == '-')
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    if (files.empty() || iterations < 1)
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0)
+    {
+        printf("Unable to initialize SDL: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    bool all_match = true;
+    for (size_t i = 0; i < files.size(); i++)
+        all_match &= bench_file(files[i], iterations);
+
+    SDL_Quit();
+    return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,319 @@
+/*
+    texture cooker: PNG (or anything stb_image reads) -> block compressed KTX
+    ----------------------------
+    usage: texture_cooker [options] <image or directory>...
+
+      -o <dir>          where the .ktx files go (default: next to the input)
+      --format <f>      auto | bc1 | bc3 | bc5 | bc7 (default auto)
+      --bc7             auto picks BC7 instead of BC1 / BC3 for colour
+      --threads <n>     worker threads, 0 = one per core (default 0)
+      --scalar          skip the SSE2 palette matching (for comparing)
+      --no-mips         only cook the top level
+
+    auto: names ending in _nm are normal maps (BC5, no sRGB mip filtering),
+    images with any alpha < 255 get BC3, everything else BC1.
+
+    for every image it prints the chosen format, the PSNR of the top level
+    against the source, and the encode throughput in source megabytes per
+    second, so quality and speed can be tracked on a machine without a GPU.
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SDL_MAIN_HANDLED
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <stb_image.h>
+#include <string>
+#include <vector>
+
+#include "SDL.h"
+
+#include "myCore/inflate.h"
+#include "myCore/job_pool.h"
+#include "myTextures/bc_codec.h"
+#include "myTextures/ktx.h"
+#include "myTextures/mip_builder.h"
+#include "myTextures/pixel_convert.h"
+#include "myTextures/png_unfilter.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+struct cook_options
+{
+    std::string output_dir;
+    int format;     // -1: auto, otherwise a bc_format
+    bool prefer_bc7;
+    int threads;
+    bool simd;
+    bool mips;
+};
+
+static bool has_image_extension(const std::string& name)
+{
+    static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd" };
+
+    size_t dot = name.rfind('.');
+    if (dot == std::string::npos)
+        return false;
+
+    std::string ext = name.substr(dot);
+    for (size_t i = 0; i < ext.size(); i++)
+        ext[i] = (char)tolower(ext[i]);
+
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++)
+    {
+        if (ext == extensions[i])
+            return true;
+    }
+    return false;
+}
+
+/* adds path itself, or every image directly inside it */
+static void collect_inputs(const std::string& path, std::vector<std::string>* files)
+{
+#ifdef _WIN32
+    DWORD attributes = GetFileAttributesA(path.c_str());
+    if (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        WIN32_FIND_DATAA found;
+        HANDLE find = FindFirstFileA((path + "\\*").c_str(), &found);
+        if (find == INVALID_HANDLE_VALUE)
+            return;
+        do
+        {
+            if (has_image_extension(found.cFileName))
+                files->push_back(path + "/" + found.cFileName);
+        } while (FindNextFileA(find, &found));
+        FindClose(find);
+        return;
+    }
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode))
+    {
+        DIR* dir = opendir(path.c_str());
+        if (!dir)
+            return;
+        while (struct dirent* entry = readdir(dir))
+        {
+            if (has_image_extension(entry->d_name))
+                files->push_back(path + "/" + entry->d_name);
+        }
+        closedir(dir);
+        return;
+    }
+#endif
+    files->push_back(path);
+}
+
+static std::string file_stem(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+static std::string file_dir(const std::string& path)
+{
+    size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+static bc_format choose_format(const cook_options& options, const std::string& stem, const uint8_t* rgba, int width, int height)
+{
+    if (options.format >= 0)
+        return (bc_format)options.format;
+
+    if (stem.size() > 3 && stem.compare(stem.size() - 3, 3, "_nm") == 0)
+        return BC_FORMAT_BC5;
+
+    bool alpha = false;
+    for (size_t i = 0; i < (size_t)width * height && !alpha; i++)
+        alpha = rgba[i * 4 + 3] != 255;
+
+    if (options.prefer_bc7)
+        return BC_FORMAT_BC7;
+    return alpha ? BC_FORMAT_BC3 : BC_FORMAT_BC1;
+}
+
+static double seconds_since(Uint64 start)
+{
+    return (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+}
+
+/* returns the source bytes encoded, 0 on failure */
+static size_t cook_file(const cook_options& options, job_pool* pool, const std::string& path, double* encode_seconds)
+{
+    int width, height, channels_in_file;
+    uint8_t* rgba = stbi_load(path.c_str(), &width, &height, &channels_in_file, 4);
+    if (!rgba)
+    {
+        printf("%-24s load error: %s\n", path.c_str(), stbi_failure_reason());
+        return 0;
+    }
+
+    std::string stem = file_stem(path);
+    bc_format format = choose_format(options, stem, rgba, width, height);
+
+    /* normal maps are data, filter them without the sRGB round trip */
+    mip_chain mips;
+    mip_build(rgba, width, height, options.mips ? 0 : 1, MIP_FILTER_KAISER,
+              format != BC_FORMAT_BC5, MIP_SIMD_AUTO, pool, &mips);
+    stbi_image_free(rgba);
+
+    std::vector<size_t> offsets(mips.levels);
+    size_t total = 0;
+    for (int l = 0; l < mips.levels; l++)
+    {
+        offsets[l] = total;
+        total += bc_image_bytes(format, mips.width[l], mips.height[l]);
+    }
+    std::vector<uint8_t> blocks(total);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int l = 0; l < mips.levels; l++)
+        bc_encode_image(format, &mips.texels[mips.offset[l]], mips.width[l], mips.height[l], &blocks[offsets[l]], pool, options.simd);
+    double seconds = seconds_since(start);
+
+    /* quality of the level that matters most */
+    std::vector<uint8_t> decoded((size_t)width * height * 4);
+    double psnr = 0.0;
+    if (bc_decode_image(format, &blocks[0], width, height, &decoded[0]))
+        psnr = bc_psnr(format, &mips.texels[0], &decoded[0], width, height);
+
+    ktx_texture ktx;
+    ktx.gl_type = 0;
+    ktx.gl_format = 0;
+    ktx.gl_internal_format = bc_gl_internal_format(format);
+    ktx.gl_base_internal_format = format == BC_FORMAT_BC5 ? GL_RG : (format == BC_FORMAT_BC1 ? GL_RGB : GL_RGBA);
+    ktx.width = width;
+    ktx.height = height;
+    ktx.levels = mips.levels;
+    for (int l = 0; l < mips.levels; l++)
+    {
+        ktx.level_data[l] = &blocks[offsets[l]];
+        ktx.level_size[l] = bc_image_bytes(format, mips.width[l], mips.height[l]);
+    }
+    ktx.key_values.push_back(std::make_pair(std::string("KTXorientation"), std::string("S=r,T=d")));
+    ktx.key_values.push_back(std::make_pair(std::string("ga.source"), path.substr(path.find_last_of("/\\") + 1)));
+
+    std::string dir = options.output_dir.empty() ? file_dir(path) : options.output_dir;
+    std::string out_path = dir + "/" + stem + ".ktx";
+    if (!ktx_write_file(out_path.c_str(), ktx))
+    {
+        printf("%-24s write error: %s\n", path.c_str(), out_path.c_str());
+        return 0;
+    }
+
+    double mb = mips.texels.size() / (1024.0 * 1024.0);
+    printf("%-24s %s %4dx%-4d %2d levels  %7.1f KB -> %7.1f KB  PSNR %6.2f dB  %8.1f MB/s\n",
+           (stem + ".ktx").c_str(), bc_format_name(format), width, height, mips.levels,
+           mips.texels.size() / 1024.0, total / 1024.0, psnr, seconds > 0.0 ? mb / seconds : 0.0);
+
+    *encode_seconds += seconds;
+    return mips.texels.size();
+}
+
+static void usage()
+{
+    printf("usage: texture_cooker [-o dir] [--format auto|bc1|bc3|bc5|bc7] [--bc7] [--threads n] [--scalar] [--no-mips] <image or directory>...\n");
+}
+
+int main(int argc, const char** argv)
+{
+    cook_options options;
+    options.format = -1;
+    options.prefer_bc7 = false;
+    options.threads = 0;
+    options.simd = true;
+    options.mips = true;
+
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc)
+            options.output_dir = argv[++i];
+        else if (arg == "--format" && i + 1 < argc)
+        {
+            std::string f = argv[++i];
+            if (f == "bc1") options.format = BC_FORMAT_BC1;
+            else if (f == "bc3") options.format = BC_FORMAT_BC3;
+            else if (f == "bc5") options.format = BC_FORMAT_BC5;
+            else if (f == "bc7") options.format = BC_FORMAT_BC7;
+            else if (f == "auto") options.format = -1;
+            else
+            {
+                usage();
+                return EXIT_FAILURE;
+            }
+        }
+        else if (arg == "--bc7")
+            options.prefer_bc7 = true;
+        else if (arg == "--threads" && i + 1 < argc)
+            options.threads = atoi(argv[++i]);
+        else if (arg == "--scalar")
+            options.simd = false;
+        else if (arg == "--no-mips")
+            options.mips = false;
+        else if (arg[0] == '-')
+        {
+            usage();
+            return EXIT_FAILURE;
+        }
+        else
+            collect_inputs(arg, &files);
+    }
+
+    if (files.empty())
+    {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if (SDL_Init(SDL_INIT_TIMER) != 0)
+    {
+        printf("Unable to initialize SDL: %s\n", SDL_GetError());
+        return EXIT_FAILURE;
+    }
+
+    inflate_install_stb();
+    png_unfilter_install();
+    pixel_convert_install();
+
+    job_pool* pool = options.threads == 1 ? NULL : job_pool_create(options.threads - 1, "cooker");
+
+    size_t bytes = 0;
+    double seconds = 0.0;
+    int failures = 0;
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        size_t cooked = cook_file(options, pool, files[i], &seconds);
+        if (!cooked)
+            failures++;
+        bytes += cooked;
+    }
+
+    printf("%d cooked, %d failed, %.1f MB encoded in %.3f s (%.1f MB/s, %d threads, %s)\n",
+           (int)files.size() - failures, failures, bytes / (1024.0 * 1024.0), seconds,
+           seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0,
+           job_pool_thread_count(pool) + 1, options.simd ? "sse2" : "scalar");
+
+    job_pool_destroy(pool);
+    SDL_Quit();
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}